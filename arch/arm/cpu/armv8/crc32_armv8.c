@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * CRC-32 and CRC-32C using the ARMv8 CRC32 instructions
+ */
+
+#include <common.h>
+#include <asm/system.h>
+#include <u-boot/crc.h>
+
+uint32_t crc32_armv8_le(uint32_t crc, const uint8_t *buf, unsigned int len);
+uint32_t crc32c_armv8_le(uint32_t crc, const uint8_t *buf, unsigned int len);
+
+static int crc32_armv8_probe(void)
+{
+	return (read_id_aa64isar0() >> ID_AA64ISAR0_CRC32_SHIFT) &
+		ID_AA64ISAR0_MASK;
+}
+
+const struct crc32_backend crc32_armv8 = {
+	.name	= "armv8",
+	.probe	= crc32_armv8_probe,
+	.crc32	= crc32_armv8_le,
+	.crc32c	= crc32c_armv8_le,
+};
@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Waking ARMv8 secondary CPUs to run work items
+ *
+ * The secondary CPUs are found from the /cpus node of the control FDT.
+ * With the "psci" enable method they are turned on with PSCI CPU_ON and
+ * turn themselves off again with CPU_OFF. With "spin-table" they are
+ * released from U-Boot's spin-table loop and go back into it when done,
+ * with the release address cleared, ready for the OS.
+ */
+
+#include <common.h>
+#include <cpu_func.h>
+#include <malloc.h>
+#include <mp_work.h>
+#include <dm/ofnode.h>
+#include <asm/mp_work.h>
+#include <asm/psci.h>
+#include <asm/spin_table.h>
+#include <asm/system.h>
+#include <asm/armv8/mmu.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* How long to wait for a CPU to start or park, in milliseconds */
+#define MP_WORK_TIMEOUT_MS	100
+
+enum mp_work_method {
+	MP_METHOD_NONE,
+	MP_METHOD_PSCI,
+	MP_METHOD_SPIN_TABLE,
+};
+
+struct mp_work_boot mp_work_boot __aligned(ARCH_DMA_MINALIGN);
+
+check_member(mp_work_boot, ttbr, MP_BOOT_TTBR);
+check_member(mp_work_boot, tcr, MP_BOOT_TCR);
+check_member(mp_work_boot, mair, MP_BOOT_MAIR);
+check_member(mp_work_boot, sctlr, MP_BOOT_SCTLR);
+check_member(mp_work_boot, el, MP_BOOT_EL);
+check_member(mp_work_boot, gd, MP_BOOT_GD);
+check_member(mp_work_boot, stacks, MP_BOOT_STACKS);
+check_member(mp_work_boot, park, MP_BOOT_PARK);
+check_member(mp_work_boot, count, MP_BOOT_COUNT);
+check_member(mp_work_boot, mpidr, MP_BOOT_MPIDR);
+
+static struct {
+	bool probed;
+	enum mp_work_method method;
+	int count;		/* CPUs in mp_work_boot.mpidr[] */
+	int boot_idx;		/* index of the boot CPU */
+	void *stacks;
+	bool started[MP_WORK_MAX_CPUS];
+} mp;
+
+static int mp_work_find_cpus(void)
+{
+	const char *method = NULL;
+	ofnode cpus, node;
+	u64 boot_mpidr;
+	int count = 0;
+
+	cpus = ofnode_path("/cpus");
+	if (!ofnode_valid(cpus))
+		return -ENOENT;
+
+	boot_mpidr = read_mpidr() & MP_WORK_MPIDR_MASK;
+	mp.boot_idx = -1;
+	ofnode_for_each_subnode(node, cpus) {
+		const char *type, *enable;
+
+		type = ofnode_read_string(node, "device_type");
+		if (!type || strcmp(type, "cpu"))
+			continue;
+		if (!ofnode_is_available(node))
+			continue;
+		enable = ofnode_read_string(node, "enable-method");
+		if (!enable)
+			enable = "";
+		if (method && strcmp(method, enable))
+			return -EINVAL;	/* mixed methods not supported */
+		method = enable;
+		if (count == MP_WORK_MAX_CPUS)
+			break;
+
+		mp_work_boot.mpidr[count] = ofnode_get_addr(node);
+		if (mp_work_boot.mpidr[count] == boot_mpidr)
+			mp.boot_idx = count;
+		count++;
+	}
+	if (count < 2 || mp.boot_idx < 0)
+		return -ENOENT;
+
+	if (!strcmp(method, "psci") && current_el() == 2)
+		mp.method = MP_METHOD_PSCI;
+	else if (IS_ENABLED(CONFIG_ARMV8_SPIN_TABLE) &&
+		 !strcmp(method, "spin-table"))
+		mp.method = MP_METHOD_SPIN_TABLE;
+	else
+		return -ENOSYS;
+	mp.count = count;
+	mp_work_boot.count = count;
+
+	return 0;
+}
+
+int arch_mp_work_max(void)
+{
+	int ret;
+
+	if (!(gd->flags & GD_FLG_RELOC) || !dcache_status())
+		return 0;
+	if (!mp.probed) {
+		mp.probed = true;
+		ret = mp_work_find_cpus();
+		if (ret) {
+			debug("%s: no secondary CPUs (err=%d)\n", __func__,
+			      ret);
+			mp.method = MP_METHOD_NONE;
+		}
+	}
+	if (mp.method == MP_METHOD_NONE)
+		return 0;
+
+	return mp.count - 1;
+}
+
+static u64 *mp_work_state(int idx)
+{
+	return mp.stacks + idx * MP_WORK_STACK_SIZE;
+}
+
+static ulong psci_call(ulong fn, ulong arg0, ulong arg1, ulong arg2)
+{
+	struct pt_regs regs;
+
+	regs.regs[0] = fn;
+	regs.regs[1] = arg0;
+	regs.regs[2] = arg1;
+	regs.regs[3] = arg2;
+	smc_call(&regs);
+
+	return regs.regs[0];
+}
+
+static bool psci_cpu_off(int idx)
+{
+	return psci_call(ARM_PSCI_0_2_FN64_AFFINITY_INFO,
+			 mp_work_boot.mpidr[idx], 0, 0) ==
+	       PSCI_AFFINITY_LEVEL_OFF;
+}
+
+static void mp_work_set_state(int idx, u64 state)
+{
+	u64 *ptr = mp_work_state(idx);
+
+	*ptr = state;
+	flush_dcache_range((ulong)ptr, (ulong)ptr + ARCH_DMA_MINALIGN);
+}
+
+static bool mp_work_running(int idx)
+{
+	/* A running CPU writes this with its caches on */
+	return READ_ONCE(*mp_work_state(idx)) != MP_CPU_IDLE;
+}
+
+static bool mp_work_parked(int idx)
+{
+	u64 *ptr = mp_work_state(idx);
+
+	/* A parked CPU writes this with its caches off */
+	invalidate_dcache_range((ulong)ptr, (ulong)ptr + ARCH_DMA_MINALIGN);
+
+	return READ_ONCE(*ptr) == MP_CPU_PARKED;
+}
+
+#ifdef CONFIG_ARMV8_SPIN_TABLE
+static void mp_work_write_release_addr(u64 *ptr, ulong addr)
+{
+	*ptr = addr;
+	flush_dcache_range(rounddown((ulong)ptr, ARCH_DMA_MINALIGN),
+			   roundup((ulong)(ptr + 1), ARCH_DMA_MINALIGN));
+}
+
+/*
+ * CPUs which have not been used yet are still in the spin-table loop of
+ * the pre-relocation image, so write the address there too. Once parked
+ * they wait in the relocated loop, which is the one given to the OS.
+ */
+static void mp_work_set_release_addr(ulong addr)
+{
+	mp_work_write_release_addr(&spin_table_cpu_release_addr, addr);
+	if (gd->reloc_off) {
+		void *orig = (void *)&spin_table_cpu_release_addr - gd->reloc_off;
+
+		mp_work_write_release_addr(orig, addr);
+	}
+	asm volatile("dsb sy\n\tsev");
+}
+
+/* Release every CPU from the spin table, then close it again */
+static int mp_work_release_spin_table(void)
+{
+	ulong start;
+	int started = 0;
+	int i;
+
+	mp_work_set_release_addr((ulong)mp_work_secondary_entry);
+	start = get_timer(0);
+	for (i = 0; i < mp.count; i++) {
+		if (i == mp.boot_idx)
+			continue;
+		while (!mp_work_running(i) &&
+		       get_timer(start) < MP_WORK_TIMEOUT_MS)
+			;
+		if (!mp_work_running(i))
+			continue;
+		mp.started[i] = true;
+		started++;
+	}
+	mp_work_set_release_addr(0);
+
+	return started;
+}
+#else
+static int mp_work_release_spin_table(void)
+{
+	return 0;
+}
+#endif
+
+int arch_mp_work_start(void)
+{
+	int el = current_el();
+	int started = 0;
+	int i;
+
+	if (!arch_mp_work_max())
+		return 0;
+	if (!mp.stacks) {
+		mp.stacks = memalign(ARCH_DMA_MINALIGN,
+				     mp.count * MP_WORK_STACK_SIZE);
+		if (!mp.stacks)
+			return 0;
+	}
+
+	mp_work_boot.ttbr = gd->arch.tlb_addr;
+	mp_work_boot.tcr = get_tcr(el, NULL, NULL);
+	mp_work_boot.mair = MEMORY_ATTRIBUTES;
+	mp_work_boot.sctlr = get_sctlr();
+	mp_work_boot.el = el << 2;
+	mp_work_boot.gd = (ulong)gd;
+	mp_work_boot.stacks = (ulong)mp.stacks;
+#ifdef CONFIG_ARMV8_SPIN_TABLE
+	if (mp.method == MP_METHOD_SPIN_TABLE)
+		mp_work_boot.park = (ulong)spin_table_secondary_jump;
+	else
+#endif
+		mp_work_boot.park = 0;
+	for (i = 0; i < mp.count; i++) {
+		mp.started[i] = false;
+		mp_work_set_state(i, MP_CPU_IDLE);
+	}
+	flush_dcache_range((ulong)&mp_work_boot,
+			   (ulong)&mp_work_boot + roundup(sizeof(mp_work_boot),
+							  ARCH_DMA_MINALIGN));
+
+	if (mp.method == MP_METHOD_PSCI) {
+		for (i = 0; i < mp.count; i++) {
+			if (i == mp.boot_idx)
+				continue;
+			if (psci_call(ARM_PSCI_0_2_FN64_CPU_ON,
+				      mp_work_boot.mpidr[i],
+				      (ulong)mp_work_secondary_entry, 0))
+				continue;
+			mp.started[i] = true;
+			started++;
+		}
+		return started;
+	}
+
+	return mp_work_release_spin_table();
+}
+
+void arch_mp_work_stop(void)
+{
+	ulong start = get_timer(0);
+	bool parked;
+	int i;
+
+	for (i = 0; i < mp.count; i++) {
+		if (!mp.started[i])
+			continue;
+		do {
+			if (mp.method == MP_METHOD_PSCI)
+				parked = psci_cpu_off(i);
+			else
+				parked = mp_work_parked(i);
+		} while (!parked && get_timer(start) < MP_WORK_TIMEOUT_MS);
+		if (!parked)
+			printf("CPU %llx did not park\n",
+			       mp_work_boot.mpidr[i]);
+	}
+}
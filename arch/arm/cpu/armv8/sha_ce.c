@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 and SHA-256 using the ARMv8 Crypto Extensions
+ */
+
+#include <common.h>
+#include <asm/system.h>
+#include <u-boot/sha-backend.h>
+
+void sha1_ce_transform(uint32_t *state, const uint8_t *data,
+		       unsigned int count);
+void sha256_ce_transform(uint32_t *state, const uint8_t *data,
+			 unsigned int count);
+
+static unsigned int read_isar0_field(int shift)
+{
+	return (read_id_aa64isar0() >> shift) & ID_AA64ISAR0_MASK;
+}
+
+static int sha1_ce_probe(void)
+{
+	return read_isar0_field(ID_AA64ISAR0_SHA1_SHIFT) != 0;
+}
+
+static int sha256_ce_probe(void)
+{
+	return read_isar0_field(ID_AA64ISAR0_SHA2_SHIFT) != 0;
+}
+
+const struct sha_backend sha1_armv8_ce = {
+	.name	= "armv8-ce",
+	.probe	= sha1_ce_probe,
+	.blocks	= sha1_ce_transform,
+};
+
+const struct sha_backend sha256_armv8_ce = {
+	.name	= "armv8-ce",
+	.probe	= sha256_ce_probe,
+	.blocks	= sha256_ce_transform,
+};
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Waking ARMv8 secondary CPUs to run work items
+ */
+
+#ifndef __ASM_ARM_MP_WORK_H
+#define __ASM_ARM_MP_WORK_H
+
+/* Largest number of CPUs supported, including the boot CPU */
+#define MP_WORK_MAX_CPUS	32
+
+/* Stack for each CPU. Its state word is at the bottom, in its own line */
+#define MP_WORK_STACK_SIZE	0x4000
+
+/* Affinity fields of MPIDR_EL1 */
+#define MP_WORK_MPIDR_MASK	0xff00ffffff
+
+/* Values of a CPU's state word */
+#define MP_CPU_IDLE		0
+#define MP_CPU_RUNNING		1
+#define MP_CPU_PARKED		2
+
+/* Offsets into struct mp_work_boot, for the entry code */
+#define MP_BOOT_TTBR		0
+#define MP_BOOT_TCR		8
+#define MP_BOOT_MAIR		16
+#define MP_BOOT_SCTLR		24
+#define MP_BOOT_EL		32
+#define MP_BOOT_GD		40
+#define MP_BOOT_STACKS		48
+#define MP_BOOT_PARK		56
+#define MP_BOOT_COUNT		64
+#define MP_BOOT_MPIDR		72
+
+#ifndef __ASSEMBLY__
+
+/**
+ * struct mp_work_boot - what a secondary CPU needs to join in
+ *
+ * The secondary CPUs read this with their MMU off, so it must be flushed
+ * to memory before they are woken.
+ *
+ * @ttbr:	translation table base, as used by the boot CPU
+ * @tcr:	translation control register value
+ * @mair:	memory attribute register value
+ * @sctlr:	system control register value, with the MMU and caches on
+ * @el:		CurrentEL value of the boot CPU; others must match it
+ * @gd:		global data pointer
+ * @stacks:	base of the stacks, MP_WORK_STACK_SIZE bytes for each CPU
+ * @park:	address to jump to once finished (the spin-table loop), or 0
+ *		to turn the CPU off with PSCI
+ * @count:	number of entries in @mpidr
+ * @mpidr:	affinity of each CPU, giving the index of its stack
+ */
+struct mp_work_boot {
+	u64 ttbr;
+	u64 tcr;
+	u64 mair;
+	u64 sctlr;
+	u64 el;
+	u64 gd;
+	u64 stacks;
+	u64 park;
+	u64 count;
+	u64 mpidr[MP_WORK_MAX_CPUS];
+};
+
+/* Entry point for secondary CPUs */
+void mp_work_secondary_entry(void);
+
+#endif /* __ASSEMBLY__ */
+
+#endif
@@ -7,6 +7,8 @@ extern u64 spin_table_cpu_release_addr;
 extern char spin_table_reserve_begin;
 extern char spin_table_reserve_end;
 
+void spin_table_secondary_jump(void);
+
 int spin_table_update_dt(void *fdt);
 
 #endif /* __ASM_SPIN_TABLE_H__ */
@@ -176,6 +176,21 @@ static inline unsigned long read_mpidr(void)
 	return val;
 }
 
+/* Instruction Set Attribute Register 0, listing the optional instructions */
+static inline unsigned long read_id_aa64isar0(void)
+{
+	unsigned long val;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (val));
+
+	return val;
+}
+
+#define ID_AA64ISAR0_SHA1_SHIFT		8
+#define ID_AA64ISAR0_SHA2_SHIFT		12
+#define ID_AA64ISAR0_CRC32_SHIFT	16
+#define ID_AA64ISAR0_MASK		0xf
+
 #define BSP_COREID	0
 
 void __asm_flush_dcache_all(void);
@@ -23,13 +23,13 @@ static inline unsigned long read_cr0(void)
 {
 	unsigned long val;
 
-	asm volatile ("movl %%cr0, %0" : "=r" (val) : : "memory");
+	asm volatile ("mov %%cr0, %0" : "=r" (val) : : "memory");
 	return val;
 }
 
 static inline void write_cr0(unsigned long val)
 {
-	asm volatile ("movl %0, %%cr0" : : "r" (val) : "memory");
+	asm volatile ("mov %0, %%cr0" : : "r" (val) : "memory");
 }
 
 static inline unsigned long read_cr2(void)
@@ -56,6 +56,11 @@ static inline unsigned long read_cr4(void)
 	return val;
 }
 
+static inline void write_cr4(unsigned long val)
+{
+	asm volatile("mov %0,%%cr4" : : "r" (val) : "memory");
+}
+
 static inline unsigned long get_debugreg(int regno)
 {
 	unsigned long val = 0;  /* Damn you, gcc! */
@@ -274,6 +274,18 @@ int cpu_jump_to_64bit(ulong setup_base, ulong target);
  */
 int cpu_jump_to_64bit_uboot(ulong target);
 
+/**
+ * cpu_enable_sse() - Allow SSE instructions to be used
+ *
+ * U-Boot itself is built without SSE, so nothing may have turned it on.
+ * This sets CR4.OSFXSR if needed. Callers must not rely on xmm registers
+ * being preserved between calls to their own code.
+ *
+ * @return 0 if SSE instructions may now be used, -ENOTSUPP if the FPU is
+ * being emulated or is not available
+ */
+int cpu_enable_sse(void);
+
 /**
  * cpu_get_family_model() - Get the family and model for the CPU
  *
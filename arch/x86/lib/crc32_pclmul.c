@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * CRC-32 using PCLMULQDQ, and CRC-32C using the SSE4.2 crc32 instruction
+ */
+
+#include <common.h>
+#include <asm/cpu.h>
+#include <u-boot/crc.h>
+
+asmlinkage uint32_t crc32_pclmul_le_16(uint32_t crc, const uint8_t *buf,
+				       unsigned int len);
+
+/* Shorter runs are quicker with the tables */
+#define CRC32_PCLMUL_MIN	64
+
+/* CPUID.1:ECX */
+#define CPUID1_ECX_PCLMULQDQ	BIT(1)
+#define CPUID1_ECX_SSE4_1	BIT(19)
+#define CPUID1_ECX_SSE4_2	BIT(20)
+
+static int crc32_pclmul_probe(void)
+{
+	const uint need = CPUID1_ECX_PCLMULQDQ | CPUID1_ECX_SSE4_1 |
+		CPUID1_ECX_SSE4_2;
+	static int supported = -1;
+
+	if (supported >= 0)
+		return supported;
+
+	supported = (cpuid_ecx(1) & need) == need && !cpu_enable_sse();
+
+	return supported;
+}
+
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t *buf, uint len)
+{
+	uint chunk;
+
+	if (len >= CRC32_PCLMUL_MIN) {
+		chunk = len & ~15;
+		crc = crc32_pclmul_le_16(crc, buf, chunk);
+		buf += chunk;
+		len -= chunk;
+	}
+
+	return len ? crc32_no_comp_generic(crc, buf, len) : crc;
+}
+
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *buf, uint len)
+{
+	for (; len && ((ulong)buf & 3); len--)
+		asm("crc32b %1, %0" : "+r" (crc) : "rm" (*buf++));
+	for (; len >= 4; len -= 4, buf += 4)
+		asm("crc32l %1, %0" : "+r" (crc) : "rm" (*(u32 *)buf));
+	for (; len; len--)
+		asm("crc32b %1, %0" : "+r" (crc) : "rm" (*buf++));
+
+	return crc;
+}
+
+const struct crc32_backend crc32_x86_pclmul = {
+	.name	= "pclmul",
+	.probe	= crc32_pclmul_probe,
+	.crc32	= crc32_pclmul,
+	.crc32c	= crc32c_sse42,
+};
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 and SHA-256 using the x86 SHA extensions
+ */
+
+#include <common.h>
+#include <asm/cpu.h>
+#include <u-boot/sha-backend.h>
+
+asmlinkage void sha1_ni_transform(uint32_t *state, const uint8_t *data,
+				  unsigned int count);
+asmlinkage void sha256_ni_transform(uint32_t *state, const uint8_t *data,
+				    unsigned int count);
+
+/* CPUID.1:ECX */
+#define CPUID1_ECX_SSSE3	BIT(9)
+#define CPUID1_ECX_SSE4_1	BIT(19)
+/* CPUID.(EAX=7,ECX=0):EBX */
+#define CPUID7_EBX_SHA		BIT(29)
+
+static int sha_ni_probe(void)
+{
+	static int supported = -1;
+	unsigned int ecx;
+
+	if (supported >= 0)
+		return supported;
+
+	supported = 0;
+	if (cpuid_eax(0) < 7)
+		return 0;
+	ecx = cpuid_ecx(1);
+	if (!(ecx & CPUID1_ECX_SSSE3) || !(ecx & CPUID1_ECX_SSE4_1))
+		return 0;
+	if (!(cpuid_ext(7, 0).ebx & CPUID7_EBX_SHA))
+		return 0;
+
+	if (cpu_enable_sse())
+		return 0;
+	supported = 1;
+
+	return 1;
+}
+
+/* The assembler functions take their arguments on the stack */
+static void sha1_ni_blocks(uint32_t *state, const uint8_t *data,
+			   unsigned int count)
+{
+	sha1_ni_transform(state, data, count);
+}
+
+static void sha256_ni_blocks(uint32_t *state, const uint8_t *data,
+			     unsigned int count)
+{
+	sha256_ni_transform(state, data, count);
+}
+
+const struct sha_backend sha1_x86_shani = {
+	.name	= "sha-ni",
+	.probe	= sha_ni_probe,
+	.blocks	= sha1_ni_blocks,
+};
+
+const struct sha_backend sha256_x86_shani = {
+	.name	= "sha-ni",
+	.probe	= sha_ni_probe,
+	.blocks	= sha256_ni_blocks,
+};
@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Turning on SSE, for code which uses the xmm registers
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <asm/control_regs.h>
+#include <asm/cpu.h>
+#include <asm/processor-flags.h>
+
+int cpu_enable_sse(void)
+{
+	if (read_cr0() & (X86_CR0_EM | X86_CR0_TS))
+		return -ENOTSUPP;
+	if (!(read_cr4() & X86_CR4_OSFXSR))
+		write_cr4(read_cr4() | X86_CR4_OSFXSR);
+
+	return 0;
+}
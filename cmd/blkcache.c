@@ -17,32 +17,42 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "read-aheads: %u (%u blocks)\n"
 	       "entries: %u\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache entries: %u\n"
+	       "max read-ahead blocks: %u\n",
+	       stats.hits, stats.misses, stats.readaheads,
+	       stats.readahead_blocks, stats.entries,
+	       stats.max_blocks_per_entry, stats.max_entries,
+	       stats.max_readahead);
 	return 0;
 }
 
 static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 			  int argc, char * const argv[])
 {
-	unsigned blocks_per_entry, max_entries;
-	if (argc != 3)
+	struct block_cache_stats stats;
+	unsigned blocks_per_entry, max_entries, max_readahead;
+	if (argc != 3 && argc != 4)
 		return CMD_RET_USAGE;
 
+	blkcache_stats(&stats);
 	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
 	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	max_readahead = argc == 4 ? simple_strtoul(argv[3], 0, 0) :
+		stats.max_readahead;
+	blkcache_configure(blocks_per_entry, max_entries, max_readahead);
+	blkcache_stats(&stats);
+	printf("changed to max of %u entries of %u blocks each, read-ahead %u blocks\n",
+	       stats.max_entries, stats.max_blocks_per_entry,
+	       stats.max_readahead);
 	return 0;
 }
 
 static cmd_tbl_t cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
-	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+	U_BOOT_CMD_MKENT(configure, 4, 0, blkc_configure, "", ""),
 };
 
 static __maybe_unused void blkc_reloc(void)
@@ -79,8 +89,10 @@ static int do_blkcache(cmd_tbl_t *cmdtp, int flag,
 }
 
 U_BOOT_CMD(
-	blkcache, 4, 0, do_blkcache,
+	blkcache, 5, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure blocks entries\n"
+	"blkcache configure blocks entries [readahead]\n"
+	"    - set blocks per entry (a power of two), entries in the cache\n"
+	"      and the maximum read-ahead in blocks (0 to disable)\n"
 );
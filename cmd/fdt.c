@@ -15,6 +15,7 @@
 #include <asm/global_data.h>
 #include <linux/libfdt.h>
 #include <fdt_support.h>
+#include <fdtdec.h>
 #include <mapmem.h>
 #include <asm/io.h>
 
@@ -109,9 +110,10 @@ static int fdt_get_header_value(int argc, char * const argv[])
 }
 
 /*
- * Flattened Device Tree command, see the help for parameter definitions.
+ * Run one subcommand of the fdt command
  */
-static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+static int fdt_subcmd(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
 {
 	if (argc < 2)
 		return CMD_RET_USAGE;
@@ -730,6 +732,21 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	return 0;
 }
 
+/*
+ * Flattened Device Tree command, see the help for parameter definitions.
+ */
+static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret;
+
+	ret = fdt_subcmd(cmdtp, flag, argc, argv);
+
+	/* The working tree may be the control tree, which has lookups cached */
+	fdtdec_cache_invalidate();
+
+	return ret;
+}
+
 /****************************************************************************/
 
 /**
@@ -40,6 +40,24 @@ U_BOOT_CMD(
 	"      If 'pos' is 0 or omitted, the file is read from the start."
 )
 
+#ifdef CONFIG_CMD_LOADZ
+static int do_loadz_wrapper(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	return do_loadz(cmdtp, flag, argc, argv, FS_TYPE_ANY);
+}
+
+U_BOOT_CMD(
+	loadz,	5,	0,	do_loadz_wrapper,
+	"load and decompress a gzip or zstd file from a filesystem",
+	"<interface> [<dev[:part]> [<addr> [<filename>]]]\n"
+	"    - Load compressed file 'filename' from partition 'part' on device\n"
+	"       type 'interface' instance 'dev' and decompress it to address\n"
+	"       'addr' in memory as it is read. The file is never held in\n"
+	"       memory in compressed form."
+)
+#endif
+
 static int do_save_wrapper(cmd_tbl_t *cmdtp, int flag, int argc,
 				char * const argv[])
 {
@@ -12,13 +12,125 @@
 #include <common.h>
 #include <command.h>
 #include <hash.h>
+#include <malloc.h>
+#include <time.h>
 #include <linux/ctype.h>
+#include <linux/sizes.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+#if defined(CONFIG_SHA1) || defined(CONFIG_SHA256)
+/* Size of the buffer hashed over and over by 'hash bench' */
+#define HASH_BENCH_BUF		SZ_1M
+#define HASH_BENCH_DEFAULT	SZ_64M
+
+/* Hashes @size bytes from @buf, returning the time taken in microseconds */
+typedef ulong (*hash_bench_f)(const struct sha_backend *backend,
+			      const u8 *buf, ulong size);
+
+#ifdef CONFIG_SHA1
+static ulong hash_bench_sha1(const struct sha_backend *backend,
+			     const u8 *buf, ulong size)
+{
+	u8 output[SHA1_SUM_LEN];
+	sha1_context ctx;
+	ulong start, done, len;
+
+	start = timer_get_us();
+	sha1_starts_backend(&ctx, backend);
+	for (done = 0; done < size; done += len) {
+		len = min_t(ulong, size - done, HASH_BENCH_BUF);
+		sha1_update(&ctx, buf, len);
+	}
+	sha1_finish(&ctx, output);
+
+	return timer_get_us() - start;
+}
+#endif
+
+#ifdef CONFIG_SHA256
+static ulong hash_bench_sha256(const struct sha_backend *backend,
+			       const u8 *buf, ulong size)
+{
+	u8 output[SHA256_SUM_LEN];
+	sha256_context ctx;
+	ulong start, done, len;
+
+	start = timer_get_us();
+	sha256_starts_backend(&ctx, backend);
+	for (done = 0; done < size; done += len) {
+		len = min_t(ulong, size - done, HASH_BENCH_BUF);
+		sha256_update(&ctx, buf, len);
+	}
+	sha256_finish(&ctx, output);
+
+	return timer_get_us() - start;
+}
+#endif
+
+static void hash_bench_algo(const char *name,
+			    const struct sha_backend *(*get_backend)(int),
+			    hash_bench_f bench, const u8 *buf, ulong size)
+{
+	const struct sha_backend *backend;
+	ulong us;
+	int i;
+
+	for (i = 0; (backend = get_backend(i)); i++) {
+		if (backend->probe && !backend->probe()) {
+			printf("%-8s %-10s not supported by this CPU\n", name,
+			       backend->name);
+			continue;
+		}
+		us = bench(backend, buf, size);
+		printf("%-8s %-10s %8lu us %6lu MB/s\n", name, backend->name,
+		       us, us ? size / us : 0);
+	}
+}
+
+/* Time each implementation of each algorithm over the same data */
+static int do_hash_bench(int argc, char * const argv[])
+{
+	ulong size = HASH_BENCH_DEFAULT;
+	u8 *buf;
+	int i;
+
+	if (argc > 1)
+		size = simple_strtoul(argv[1], NULL, 16);
+	if (!size)
+		return CMD_RET_USAGE;
+
+	buf = malloc(HASH_BENCH_BUF);
+	if (!buf) {
+		printf("Out of memory\n");
+		return CMD_RET_FAILURE;
+	}
+	for (i = 0; i < HASH_BENCH_BUF; i++)
+		buf[i] = i * 7 + (i >> 8);
+
+	printf("Hashing %#lx bytes\n", size);
+#ifdef CONFIG_SHA1
+	hash_bench_algo("sha1", sha1_get_backend, hash_bench_sha1, buf, size);
+#endif
+#ifdef CONFIG_SHA256
+	hash_bench_algo("sha256", sha256_get_backend, hash_bench_sha256, buf,
+			size);
+#endif
+	free(buf);
+
+	return CMD_RET_SUCCESS;
+}
+#endif
 
 static int do_hash(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	char *s;
 	int flags = HASH_FLAG_ENV;
 
+#if defined(CONFIG_SHA1) || defined(CONFIG_SHA256)
+	if (argc > 1 && !strcmp(argv[1], "bench"))
+		return do_hash_bench(argc - 1, argv + 1);
+#endif
 #ifdef CONFIG_HASH_VERIFY
 	if (argc < 4)
 		return CMD_RET_USAGE;
@@ -52,4 +164,8 @@ U_BOOT_CMD(
 		"    - verify message digest of memory area to immediate value, \n"
 		"      env var or *address"
 #endif
+#if defined(CONFIG_SHA1) || defined(CONFIG_SHA256)
+	"\nhash bench [size]\n"
+		"    - time each implementation of SHA1/SHA256 over size bytes"
+#endif
 );
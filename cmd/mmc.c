@@ -332,6 +332,14 @@ static lbaint_t mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t mmc_sparse_erase(struct sparse_storage *info,
+				 lbaint_t blk, lbaint_t blkcnt)
+{
+	struct blk_desc *dev_desc = info->priv;
+
+	return blk_derase(dev_desc, blk, blkcnt);
+}
+
 static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 			       int argc, char * const argv[])
 {
@@ -372,6 +380,8 @@ static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 	sparse.size = dev_desc->lba - blk;
 	sparse.write = mmc_sparse_write;
 	sparse.reserve = mmc_sparse_reserve;
+	sparse.erase = mmc_sparse_erase;
+	sparse.erase_grp = mmc_erased_is_zero(mmc) ? mmc->erase_grp_size : 0;
 	sparse.mssg = NULL;
 	sprintf(dest, "0x" LBAF, sparse.start * sparse.blksz);
 
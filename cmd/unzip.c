@@ -86,4 +86,5 @@ U_BOOT_CMD(
 	"\toutsize is the size of the expected output (hex bytes)\n"
 	"\t\tand is required for files with uncompressed lengths\n"
 	"\t\t4 GiB or larger\n"
+	"\tzstd-compressed data is also accepted, if enabled\n"
 );
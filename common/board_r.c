@@ -45,6 +45,7 @@
 #include <stdio_dev.h>
 #include <timer.h>
 #include <trace.h>
+#include <usb.h>
 #include <watchdog.h>
 #ifdef CONFIG_ADDR_MAP
 #include <asm/mmu.h>
@@ -304,6 +305,10 @@ static int initr_dm(void)
 	gd->dm_root = NULL;
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
+#endif
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+	/* The pre-relocation table is in the early malloc() area */
+	gd->compat_hash = NULL;
 #endif
 	bootstage_start(BOOTSTATE_ID_ACCUM_DM_R, "dm_r");
 	ret = dm_init_and_scan(false);
@@ -552,6 +557,16 @@ static int initr_status_led(void)
 }
 #endif
 
+#ifdef CONFIG_DM_USB_PROBE_EARLY
+static int initr_usb_probe_async(void)
+{
+	/* Any failure is reported by 'usb start' */
+	usb_probe_async();
+
+	return 0;
+}
+#endif
+
 #if defined(CONFIG_SCSI) && !defined(CONFIG_DM_SCSI)
 static int initr_scsi(void)
 {
@@ -805,6 +820,9 @@ static init_fnc_t init_sequence_r[] = {
 #ifdef CONFIG_BOARD_LATE_INIT
 	board_late_init,
 #endif
+#ifdef CONFIG_DM_USB_PROBE_EARLY
+	initr_usb_probe_async,
+#endif
 #if defined(CONFIG_SCSI) && !defined(CONFIG_DM_SCSI)
 	INIT_FUNC_WATCHDOG_RESET
 	initr_scsi,
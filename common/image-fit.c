@@ -1116,6 +1116,96 @@ int fit_set_timestamp(void *fit, int noffset, time_t timestamp)
 	return 0;
 }
 
+#ifndef USE_HOSTCC
+/*
+ * While an image is being verified we remember the digests we calculate, so
+ * that data covered by both a hash and a signature is hashed only once. The
+ * cache is keyed on the address of the data, not its contents, so nothing is
+ * remembered outside a single fit_verify_cache_begin()/end() pair: once that
+ * ends, the data may be changed and must be hashed again.
+ */
+#define FIT_DIGEST_CACHE_SIZE	8
+
+struct fit_digest {
+	char algo[16];
+	const void *data;
+	size_t size;
+	int value_len;
+	uint8_t value[FIT_MAX_HASH_LEN];
+};
+
+static struct fit_digest fit_digests[FIT_DIGEST_CACHE_SIZE];
+static int fit_digest_next;
+static int fit_cache_users;
+
+static void fit_verify_cache_clear(void)
+{
+	memset(fit_digests, '\0', sizeof(fit_digests));
+	fit_digest_next = 0;
+}
+
+void fit_verify_cache_begin(void)
+{
+	if (!fit_cache_users++)
+		fit_verify_cache_clear();
+}
+
+void fit_verify_cache_end(void)
+{
+	if (fit_cache_users && !--fit_cache_users)
+		fit_verify_cache_clear();
+}
+
+int fit_digest_cache_get(const char *algo, const void *data, size_t size,
+			 uint8_t *value)
+{
+	struct fit_digest *digest;
+	int i;
+
+	if (!fit_cache_users)
+		return -ENOENT;
+
+	for (i = 0; i < FIT_DIGEST_CACHE_SIZE; i++) {
+		digest = &fit_digests[i];
+		if (digest->data == data && digest->size == size &&
+		    !strcmp(digest->algo, algo)) {
+			memcpy(value, digest->value, digest->value_len);
+			return digest->value_len;
+		}
+	}
+
+	return -ENOENT;
+}
+
+void fit_digest_cache_put(const char *algo, const void *data, size_t size,
+			  const uint8_t *value, int value_len)
+{
+	struct fit_digest *digest;
+	int i;
+
+	if (!fit_cache_users || value_len > FIT_MAX_HASH_LEN ||
+	    strlen(algo) >= sizeof(digest->algo))
+		return;
+
+	for (i = 0; i < FIT_DIGEST_CACHE_SIZE; i++) {
+		digest = &fit_digests[i];
+		if (digest->data == data && digest->size == size &&
+		    !strcmp(digest->algo, algo))
+			break;
+	}
+	if (i == FIT_DIGEST_CACHE_SIZE) {
+		digest = &fit_digests[fit_digest_next];
+		fit_digest_next = (fit_digest_next + 1) %
+				  FIT_DIGEST_CACHE_SIZE;
+	}
+	strcpy(digest->algo, algo);
+	digest->data = data;
+	digest->size = size;
+	digest->value_len = value_len;
+	memcpy(digest->value, value, value_len);
+}
+#endif /* !USE_HOSTCC */
+
 /**
  * calculate_hash - calculate and return hash for provided input data
  * @data: pointer to the input data
@@ -1137,6 +1227,14 @@ int fit_set_timestamp(void *fit, int noffset, time_t timestamp)
 int calculate_hash(const void *data, int data_len, const char *algo,
 			uint8_t *value, int *value_len)
 {
+	int len;
+
+	len = fit_digest_cache_get(algo, data, data_len, value);
+	if (len > 0) {
+		*value_len = len;
+		return 0;
+	}
+
 	if (IMAGE_ENABLE_CRC32 && strcmp(algo, "crc32") == 0) {
 		*((uint32_t *)value) = crc32_wd(0, data, data_len,
 							CHUNKSZ_CRC32);
@@ -1157,6 +1255,8 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 		debug("Unsupported hash alogrithm\n");
 		return -1;
 	}
+	fit_digest_cache_put(algo, data, data_len, value, *value_len);
+
 	return 0;
 }
 
@@ -1216,6 +1316,8 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 	int verify_all = 1;
 	int ret;
 
+	fit_verify_cache_begin();
+
 	/* Verify all required signatures */
 	if (IMAGE_ENABLE_VERIFY &&
 	    fit_image_verify_required_sigs(fit, image_noffset, data, size,
@@ -1263,9 +1365,12 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		goto error;
 	}
 
+	fit_verify_cache_end();
+
 	return 1;
 
 error:
+	fit_verify_cache_end();
 	printf(" error!\n%s for '%s' hash node in '%s' image node\n",
 	       err_msg, fit_get_name(fit, noffset, NULL),
 	       fit_get_name(fit, image_noffset, NULL));
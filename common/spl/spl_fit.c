@@ -8,8 +8,11 @@
 #include <errno.h>
 #include <fpga.h>
 #include <gzip.h>
+#include <hash.h>
 #include <image.h>
+#include <malloc.h>
 #include <linux/libfdt.h>
+#include <linux/sizes.h>
 #include <spl.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -153,6 +156,92 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+#ifdef CONFIG_SPL_FIT_SIGNATURE
+/* Bytes read between hash updates when hashing an image as it loads */
+#define SPL_FIT_HASH_CHUNK	SZ_256K
+
+/*
+ * Find the progressive hash algorithm used by the first hash or signature
+ * node of an image, which is the one verification will need first
+ */
+static struct hash_algo *spl_fit_image_hash_algo(const void *fit, int node)
+{
+	struct hash_algo *algo;
+	char name[16];
+	const char *prop;
+	int noffset;
+	size_t len;
+
+	fdt_for_each_subnode(noffset, fit, node) {
+		prop = fdt_getprop(fit, noffset, FIT_ALGO_PROP, NULL);
+		if (!prop)
+			continue;
+		/* a signature algo names its checksum first, "sha256,rsa2048" */
+		len = strcspn(prop, ",");
+		if (len >= sizeof(name))
+			continue;
+		memcpy(name, prop, len);
+		name[len] = '\0';
+		if (!hash_progressive_lookup_algo(name, &algo))
+			return algo;
+	}
+
+	return NULL;
+}
+
+/*
+ * Read the external data of an image a chunk at a time, hashing each chunk
+ * while it is still in the cache. The digest is left for
+ * fit_image_verify_with_data(), so the image is not read from memory again
+ * just to hash it. Returns the number of sectors read, like info->read().
+ */
+static ulong spl_fit_read_hashed(struct spl_load_info *info, const void *fit,
+				 int node, ulong sector, ulong count,
+				 void *buf, ulong overhead, size_t length)
+{
+	uint8_t digest[FIT_MAX_HASH_LEN];
+	struct hash_algo *algo;
+	ulong done, chunk, n;
+	size_t end, hashed = 0;
+	void *ctx = NULL;
+
+	algo = spl_fit_image_hash_algo(fit, node);
+	if (algo && algo->hash_init(algo, &ctx))
+		algo = NULL;
+
+	chunk = max_t(ulong, SPL_FIT_HASH_CHUNK / info->bl_len, 1);
+	for (done = 0; done < count; done += n) {
+		n = min(count - done, chunk);
+		if (info->read(info, sector + done, n,
+			       buf + done * info->bl_len) != n) {
+			free(ctx);
+			return done;
+		}
+		if (!algo)
+			continue;
+
+		end = (done + n) * info->bl_len;
+		if (end <= overhead)
+			continue;
+		end = min_t(size_t, end - overhead, length);
+		if (end > hashed) {
+			algo->hash_update(algo, ctx, buf + overhead + hashed,
+					  end - hashed, end == length);
+			hashed = end;
+		}
+	}
+
+	if (algo && hashed < length)
+		free(ctx);
+	else if (algo &&
+		 !algo->hash_finish(algo, ctx, digest, algo->digest_size))
+		fit_digest_cache_put(algo->name, buf + overhead, length,
+				     digest, algo->digest_size);
+
+	return count;
+}
+#endif
+
 /**
  * spl_load_fit_image(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -186,6 +275,7 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	uint8_t image_comp = -1, type = -1;
 	const void *data;
 	bool external_data = false;
+	int __maybe_unused ret;
 
 	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) ||
 	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
@@ -223,10 +313,22 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
 
+#ifdef CONFIG_SPL_FIT_SIGNATURE
+		fit_verify_cache_begin();
+		if (spl_fit_read_hashed(info, fit, node,
+					sector + get_aligned_image_offset(info,
+									  offset),
+					nr_sectors, (void *)load_ptr, overhead,
+					length) != nr_sectors) {
+			fit_verify_cache_end();
+			return -EIO;
+		}
+#else
 		if (info->read(info,
 			       sector + get_aligned_image_offset(info, offset),
 			       nr_sectors, (void *)load_ptr) != nr_sectors)
 			return -EIO;
+#endif
 
 		debug("External data: dst=%lx, offset=%x, size=%lx\n",
 		      load_ptr, offset, (unsigned long)length);
@@ -245,8 +347,10 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 #ifdef CONFIG_SPL_FIT_SIGNATURE
 	printf("## Checking hash(es) for Image %s ... ",
 	       fit_get_name(fit, node, NULL));
-	if (!fit_image_verify_with_data(fit, node,
-					 src, length))
+	ret = fit_image_verify_with_data(fit, node, src, length);
+	if (external_data)
+		fit_verify_cache_end();
+	if (!ret)
 		return -EPERM;
 	puts("OK\n");
 #endif
@@ -954,9 +954,17 @@ static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 	 * Windows 7 limiting transfers to 128 sectors for both USB2 and USB3
 	 * and Apple Mac OS X 10.11 limiting transfers to 256 sectors for USB2
 	 * and 2048 for USB3 devices.
+	 *
+	 * SuperSpeed devices are recent enough not to have this problem and
+	 * small transfers leave them well short of their bandwidth, so follow
+	 * OS X and allow 2048 sectors for them. Either way, the transfer must
+	 * also fit within what the host controller can do in one go.
 	 */
 	unsigned short blk = 240;
 
+	if (udev->speed >= USB_SPEED_SUPER)
+		blk = 2048;
+
 #if CONFIG_IS_ENABLED(DM_USB)
 	size_t size;
 	int ret;
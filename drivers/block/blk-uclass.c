@@ -7,9 +7,11 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <watchdog.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
+#include <linux/err.h>
 
 static const char *if_typename_str[IF_TYPE_COUNT] = {
 	[IF_TYPE_IDE]		= "ide",
@@ -431,7 +433,9 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
+	lbaint_t ra_start, ra_cnt;
 	ulong blks_read;
+	void *ra_buf;
 
 	if (!ops->read)
 		return -ENOSYS;
@@ -439,6 +443,17 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
+
+	ra_cnt = blkcache_prefetch(block_dev, start, blkcnt, &ra_start,
+				   &ra_buf);
+	if (ra_cnt && ops->read(dev, ra_start, ra_cnt, ra_buf) == ra_cnt) {
+		blkcache_fill(block_dev->if_type, block_dev->devnum,
+			      ra_start, ra_cnt, block_dev->blksz, ra_buf);
+		memcpy(buffer, ra_buf + (start - ra_start) * block_dev->blksz,
+		       blkcnt * block_dev->blksz);
+		return blkcnt;
+	}
+
 	blks_read = ops->read(dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
@@ -473,6 +488,160 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	return ops->erase(dev, start, blkcnt);
 }
 
+lbaint_t blk_req_blkcnt(const struct blk_req *req)
+{
+	lbaint_t blkcnt = 0;
+	int i;
+
+	for (i = 0; i < req->sg_count; i++)
+		blkcnt += req->sg[i].blkcnt;
+
+	return blkcnt;
+}
+
+void blk_req_done(struct blk_req *req, int ret, lbaint_t done)
+{
+	struct blk_uc_priv *priv = dev_get_uclass_priv(req->dev);
+
+	priv->active--;
+	req->done = done;
+	req->ret = ret;
+	if (req->complete)
+		req->complete(req);
+}
+
+void blk_req_sync(struct blk_req *req)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(req->dev);
+	lbaint_t start = req->start;
+	lbaint_t done = 0;
+	int ret = 0;
+	ulong n;
+	int i;
+
+	for (i = 0; i < req->sg_count; i++) {
+		struct blk_sg *sg = &req->sg[i];
+
+		if (req->op == BLK_REQ_READ)
+			n = blk_dread(desc, start, sg->blkcnt, sg->buf);
+		else
+			n = blk_dwrite(desc, start, sg->blkcnt, sg->buf);
+		if (IS_ERR_VALUE(n)) {
+			ret = n;
+			break;
+		}
+		done += n;
+		if (n != sg->blkcnt) {
+			ret = -EIO;
+			break;
+		}
+		start += n;
+	}
+	blk_req_done(req, ret, done);
+}
+
+/* Pass waiting requests to the driver, in order, until it is full */
+static void blk_start_pending(struct udevice *dev)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_uc_priv *priv = dev_get_uclass_priv(dev);
+	struct blk_req *req;
+	int ret;
+
+	while (!list_empty(&priv->pending)) {
+		req = list_first_entry(&priv->pending, struct blk_req, node);
+		list_del(&req->node);
+		priv->queued--;
+		priv->active++;
+		ret = ops->submit(dev, req);
+		if (ret == -EBUSY) {
+			priv->active--;
+			priv->queued++;
+			list_add(&req->node, &priv->pending);
+			break;
+		}
+		if (ret == -ENOSYS)
+			blk_req_sync(req);
+		else if (ret)
+			blk_req_done(req, ret, 0);
+	}
+}
+
+int blk_submit(struct udevice *dev, struct blk_req *req)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct blk_uc_priv *priv;
+	int ret, i;
+
+	if (!req->sg_count)
+		return -EINVAL;
+	for (i = 0; i < req->sg_count; i++) {
+		if (!req->sg[i].blkcnt)
+			return -EINVAL;
+	}
+	if (req->start + blk_req_blkcnt(req) > desc->lba)
+		return -EINVAL;
+	if (!ops->submit && (req->op == BLK_REQ_READ ? !ops->read :
+			     !ops->write))
+		return -ENOSYS;
+	ret = device_probe(dev);
+	if (ret)
+		return ret;
+
+	priv = dev_get_uclass_priv(dev);
+	req->dev = dev;
+	req->ret = -EINPROGRESS;
+	req->done = 0;
+	if (req->op == BLK_REQ_WRITE)
+		blkcache_invalidate(desc->if_type, desc->devnum);
+
+	if (!ops->submit) {
+		priv->active++;
+		blk_req_sync(req);
+		return 0;
+	}
+	list_add_tail(&req->node, &priv->pending);
+	priv->queued++;
+	blk_start_pending(dev);
+
+	return 0;
+}
+
+int blk_poll(struct udevice *dev)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_uc_priv *priv = dev_get_uclass_priv(dev);
+	int ret;
+
+	if (!priv)
+		return 0;	/* not probed, so nothing submitted */
+	/* The driver may be busy with requests for another device */
+	if (ops->poll && (priv->active || priv->queued)) {
+		ret = ops->poll(dev);
+		if (ret)
+			return ret;
+	}
+	if (ops->submit)
+		blk_start_pending(dev);
+
+	return priv->active + priv->queued;
+}
+
+int blk_wait(struct udevice *dev, struct blk_req *req)
+{
+	int ret;
+
+	while (req->ret == -EINPROGRESS) {
+		ret = blk_poll(dev);
+		if (ret < 0)
+			return ret;
+		WATCHDOG_RESET();
+	}
+
+	return req->ret;
+}
+
 int blk_get_from_parent(struct udevice *parent, struct udevice **devp)
 {
 	struct udevice *dev;
@@ -640,18 +809,34 @@ int blk_unbind_all(int if_type)
 
 static int blk_post_probe(struct udevice *dev)
 {
+	struct blk_uc_priv *priv = dev_get_uclass_priv(dev);
 #if defined(CONFIG_PARTITIONS) && defined(CONFIG_HAVE_BLOCK_DEVICE)
 	struct blk_desc *desc = dev_get_uclass_platdata(dev);
 
 	part_init(desc);
 #endif
+	INIT_LIST_HEAD(&priv->pending);
 
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	int ret;
+
+	/* Don't let the driver go while it may still be doing DMA */
+	do {
+		ret = blk_poll(dev);
+	} while (ret > 0);
+
+	return ret;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
+	.per_device_auto_alloc_size = sizeof(struct blk_uc_priv),
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
 };
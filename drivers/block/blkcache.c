@@ -6,13 +6,27 @@
  */
 #include <config.h>
 #include <common.h>
+#include <blk.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 
+#define BLKCACHE_HASH_BITS	6
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
+#define BLKCACHE_STREAMS	4
+
+/*
+ * Each cache entry holds one 'line' of a device: a run of up to
+ * max_blocks_per_entry blocks starting at a multiple of max_blocks_per_entry.
+ * Entries sit on an MRU-ordered list used for eviction and on a hash chain
+ * keyed by (iftype, devnum, start) used for lookup.
+ */
 struct block_cache_node {
 	struct list_head lh;
+	struct hlist_node hn;
 	int iftype;
 	int devnum;
 	lbaint_t start;
@@ -21,25 +35,73 @@ struct block_cache_node {
 	char *cache;
 };
 
+/*
+ * A sequential reader of one device, used to size the read-ahead window
+ */
+struct block_cache_stream {
+	int iftype;
+	int devnum;
+	lbaint_t next;		/* block following the previous read */
+	lbaint_t window;	/* current read-ahead window, in blocks */
+	ulong last_use;		/* 0 if this slot is free */
+};
+
 static LIST_HEAD(block_cache);
+static struct hlist_head block_cache_hash[BLKCACHE_HASH_SIZE];
+static struct block_cache_stream streams[BLKCACHE_STREAMS];
+static ulong stream_clock;
+
+/*
+ * staging buffer for reads extended to whole lines and read-ahead; the driver
+ * reads into it directly, so it is cache-aligned for DMA
+ */
+static char *ra_buf;
+static unsigned long ra_size;
 
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_entries = 32,
+	.max_readahead = 64,
 };
 
+static inline lbaint_t line_start(lbaint_t blk)
+{
+	return blk & ~(lbaint_t)(_stats.max_blocks_per_entry - 1);
+}
+
+/*
+ * Reads larger than half the cache are passed straight through, since
+ * caching them would only evict more useful entries.
+ */
+static inline lbaint_t cache_limit(void)
+{
+	return (lbaint_t)_stats.max_entries * _stats.max_blocks_per_entry / 2;
+}
+
+static struct hlist_head *cache_bucket(int iftype, int devnum, lbaint_t start)
+{
+	u32 key;
+
+	key = (u32)(start >> ilog2(_stats.max_blocks_per_entry));
+	key ^= (iftype << 24) ^ (devnum << 16);
+
+	return &block_cache_hash[(key * 0x9e370001U) >>
+				 (32 - BLKCACHE_HASH_BITS)];
+}
+
 static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
+					   lbaint_t start,
 					   unsigned long blksz)
 {
 	struct block_cache_node *node;
+	struct hlist_node *pos;
 
-	list_for_each_entry(node, &block_cache, lh)
+	hlist_for_each_entry(node, pos, cache_bucket(iftype, devnum, start),
+			     hn) {
 		if ((node->iftype == iftype) &&
 		    (node->devnum == devnum) &&
 		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
+		    (node->start == start)) {
 			if (block_cache.next != &node->lh) {
 				/* maintain MRU ordering */
 				list_del(&node->lh);
@@ -47,24 +109,79 @@ static struct block_cache_node *cache_find(int iftype, int devnum,
 			}
 			return node;
 		}
+	}
 	return 0;
 }
 
+static void cache_drop(struct block_cache_node *node)
+{
+	list_del(&node->lh);
+	hlist_del(&node->hn);
+	_stats.entries--;
+	debug("drop: start " LBAF ", count " LBAFU "\n",
+	      node->start, node->blkcnt);
+}
+
+static void cache_free(struct block_cache_node *node)
+{
+	cache_drop(node);
+	free(node->cache);
+	free(node);
+}
+
+static struct block_cache_stream *stream_get(int iftype, int devnum)
+{
+	struct block_cache_stream *stream, *oldest = &streams[0];
+	int i;
+
+	for (i = 0; i < BLKCACHE_STREAMS; i++) {
+		stream = &streams[i];
+		if (stream->last_use && stream->iftype == iftype &&
+		    stream->devnum == devnum)
+			goto found;
+		if (stream->last_use < oldest->last_use)
+			oldest = stream;
+	}
+	stream = oldest;
+	stream->iftype = iftype;
+	stream->devnum = devnum;
+	stream->next = 0;
+	stream->window = 0;
+found:
+	stream->last_use = ++stream_clock;
+
+	return stream;
+}
+
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	struct block_cache_node *node;
+	lbaint_t blk, end = start + blkcnt;
+	lbaint_t count;
+	char *dst = buffer;
+
+	if (!_stats.max_entries || blkcnt > cache_limit())
+		goto miss;
+
+	for (blk = start; blk < end; blk += count) {
+		node = cache_find(iftype, devnum, line_start(blk), blksz);
+		if (!node || node->start + node->blkcnt <= blk)
+			goto miss;
+		count = min(end, node->start + node->blkcnt) - blk;
+		memcpy(dst, node->cache + (blk - node->start) * blksz,
+		       count * blksz);
+		dst += count * blksz;
 	}
 
+	debug("hit: start " LBAF ", count " LBAFU "\n",
+	      start, blkcnt);
+	stream_get(iftype, devnum)->next = end;
+	++_stats.hits;
+	return 1;
+
+miss:
 	debug("miss: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 	++_stats.misses;
@@ -75,93 +192,181 @@ void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
 	struct block_cache_node *node;
+	lbaint_t line, end = start + blkcnt;
+	lbaint_t count;
+	unsigned long bytes;
 
 	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
+	if (!_stats.max_entries || blkcnt > cache_limit())
 		return;
 
-	if (_stats.max_entries == 0)
-		return;
+	bytes = blksz * _stats.max_blocks_per_entry;
+
+	/* cache every line whose first block is part of the data */
+	for (line = line_start(start + _stats.max_blocks_per_entry - 1);
+	     line < end; line += _stats.max_blocks_per_entry) {
+		count = min(end - line, (lbaint_t)_stats.max_blocks_per_entry);
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
+		node = cache_find(iftype, devnum, line, blksz);
+		if (node) {
+			/* extend an existing line prefix in place */
+			if (node->blkcnt < count) {
+				memcpy(node->cache, (const char *)buffer +
+				       (line - start) * blksz, count * blksz);
+				node->blkcnt = count;
+			}
+			continue;
+		}
+
+		if (_stats.max_entries <= _stats.entries) {
+			/* pop LRU */
+			node = list_entry(block_cache.prev,
+					  struct block_cache_node, lh);
+			cache_drop(node);
+			if (node->blksz < blksz) {
+				free(node->cache);
+				node->cache = 0;
+			}
+		} else {
+			node = malloc(sizeof(*node));
+			if (!node)
+				return;
 			node->cache = 0;
 		}
+
+		if (!node->cache) {
+			node->cache = malloc(bytes);
+			if (!node->cache) {
+				free(node);
+				return;
+			}
+		}
+
+		debug("fill: start " LBAF ", count " LBAFU "\n",
+		      line, count);
+
+		node->iftype = iftype;
+		node->devnum = devnum;
+		node->start = line;
+		node->blkcnt = count;
+		node->blksz = blksz;
+		memcpy(node->cache, (const char *)buffer +
+		       (line - start) * blksz, count * blksz);
+		list_add(&node->lh, &block_cache);
+		hlist_add_head(&node->hn,
+			       cache_bucket(iftype, devnum, line));
+		_stats.entries++;
+	}
+}
+
+lbaint_t blkcache_prefetch(struct blk_desc *block_dev,
+			   lbaint_t start, lbaint_t blkcnt,
+			   lbaint_t *startp, void **bufp)
+{
+	struct block_cache_stream *stream;
+	lbaint_t limit = cache_limit();
+	lbaint_t bpe = _stats.max_blocks_per_entry;
+	lbaint_t end = start + blkcnt;
+	lbaint_t ra_start, ra_end, window;
+	unsigned long bytes;
+
+	if (!limit || blkcnt > limit || !block_dev->lba)
+		return 0;
+
+	stream = stream_get(block_dev->if_type, block_dev->devnum);
+	if (start == stream->next && _stats.max_readahead) {
+		/* sequential access: grow the window, up to the maximum */
+		window = stream->window ? stream->window * 2 : bpe;
+		if (window > _stats.max_readahead)
+			window = _stats.max_readahead;
 	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
+		window = 0;
 	}
+	stream->window = window;
+	stream->next = end;
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
+	ra_start = line_start(start);
+	ra_end = line_start(end + window + bpe - 1);
+	if (ra_end > ra_start + limit)
+		ra_end = ra_start + limit;
+	if (ra_end > block_dev->lba)
+		ra_end = block_dev->lba;
+	if (ra_end < end || (ra_start == start && ra_end == end))
+		return 0;
+
+	bytes = (ra_end - ra_start) * block_dev->blksz;
+	if (bytes > ra_size) {
+		free(ra_buf);
+		ra_buf = malloc_cache_aligned(bytes);
+		if (!ra_buf) {
+			ra_size = 0;
+			return 0;
 		}
+		ra_size = bytes;
 	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+	if (ra_end > line_start(end + bpe - 1)) {
+		_stats.readaheads++;
+		_stats.readahead_blocks += ra_end - end;
+	}
+	debug("prefetch: start " LBAF ", count " LBAFU "\n",
+	      ra_start, ra_end - ra_start);
+
+	*startp = ra_start;
+	*bufp = ra_buf;
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	return ra_end - ra_start;
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_node *node, *n;
+	int i;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
+	list_for_each_entry_safe(node, n, &block_cache, lh) {
 		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
-		}
+		    (node->devnum == devnum))
+			cache_free(node);
+	}
+
+	for (i = 0; i < BLKCACHE_STREAMS; i++) {
+		if (streams[i].iftype == iftype && streams[i].devnum == devnum)
+			streams[i].last_use = 0;
 	}
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+void blkcache_configure(unsigned blocks, unsigned entries,
+			unsigned readahead)
 {
 	struct block_cache_node *node;
+
+	/* lines are aligned, so keep their size a power of two */
+	blocks = blocks ? rounddown_pow_of_two(blocks) : 1;
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries)) {
 		/* invalidate cache */
 		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
+			node = list_first_entry(&block_cache,
+						struct block_cache_node, lh);
+			cache_free(node);
 		}
 		_stats.entries = 0;
+		memset(streams, '\0', sizeof(streams));
+		free(ra_buf);
+		ra_buf = NULL;
+		ra_size = 0;
 	}
 
 	_stats.max_blocks_per_entry = blocks;
 	_stats.max_entries = entries;
+	_stats.max_readahead = readahead;
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
+	_stats.readahead_blocks = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -169,4 +374,6 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
+	_stats.readahead_blocks = 0;
 }
@@ -87,6 +87,69 @@ static unsigned long host_block_write(struct blk_desc *block_dev,
 }
 
 #ifdef CONFIG_BLK
+/* Most asynchronous requests which can be in progress at once */
+#define HOST_MAX_REQS	4
+
+/*
+ * Asynchronous requests are queued and carried out one at a time by
+ * host_block_poll(), so that they finish some time after being submitted,
+ * as with real hardware
+ */
+static int host_block_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct host_block_dev *host_dev = dev_get_platdata(dev);
+
+	if (host_dev->req_count == HOST_MAX_REQS)
+		return -EBUSY;
+	list_add_tail(&req->node, &host_dev->reqs);
+	host_dev->req_count++;
+
+	return 0;
+}
+
+static int host_block_poll(struct udevice *dev)
+{
+	struct host_block_dev *host_dev = dev_get_platdata(dev);
+	lbaint_t start, done = 0;
+	struct blk_req *req;
+	ulong n;
+	int i;
+
+	if (list_empty(&host_dev->reqs))
+		return 0;
+	req = list_first_entry(&host_dev->reqs, struct blk_req, node);
+	list_del(&req->node);
+	host_dev->req_count--;
+
+	start = req->start;
+	for (i = 0; i < req->sg_count; i++) {
+		struct blk_sg *sg = &req->sg[i];
+
+		if (req->op == BLK_REQ_READ)
+			n = host_block_read(dev, start, sg->blkcnt, sg->buf);
+		else
+			n = host_block_write(dev, start, sg->blkcnt, sg->buf);
+		if (n != sg->blkcnt) {
+			blk_req_done(req, -EIO, done);
+			return 0;
+		}
+		done += n;
+		start += n;
+	}
+	blk_req_done(req, 0, done);
+
+	return 0;
+}
+
+static int host_block_probe(struct udevice *dev)
+{
+	struct host_block_dev *host_dev = dev_get_platdata(dev);
+
+	INIT_LIST_HEAD(&host_dev->reqs);
+
+	return 0;
+}
+
 int host_dev_bind(int devnum, char *filename)
 {
 	struct host_block_dev *host_dev;
@@ -221,12 +284,15 @@ int host_get_dev_err(int devnum, struct blk_desc **blk_devp)
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+	.submit	= host_block_submit,
+	.poll	= host_block_poll,
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
 	.name		= "sandbox_host_blk",
 	.id		= UCLASS_BLK,
 	.ops		= &sandbox_host_blk_ops,
+	.probe		= host_block_probe,
 	.platdata_auto_alloc_size = sizeof(struct host_block_dev),
 };
 #else
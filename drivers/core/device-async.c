@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Probing devices in the background
+ *
+ * Drivers with DM_FLAG_PROBE_ASYNC return -EAGAIN from probe() while they
+ * wait for their hardware. Devices passed to device_probe_async() are kept
+ * in a queue and their probe() method is called again each time the queue
+ * is polled, so that several slow devices can wait at the same time. There
+ * are no threads: everything happens when the queue is polled.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <watchdog.h>
+#include <dm/device-internal.h>
+#include <dm/util.h>
+#include <linux/list.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/*
+ * Check whether a device, or one of its parents, is still in the queue or
+ * being probed. @self is the device asking, which does not depend on itself.
+ */
+static bool device_async_waiting(struct udevice *dev, struct udevice *self)
+{
+	for (; dev && dev != self; dev = dev->parent) {
+		if (dev->flags & (DM_FLAG_PROBE_PENDING | DM_FLAG_PROBING))
+			return true;
+	}
+
+	return false;
+}
+
+static bool device_async_node_waiting(ofnode node, struct udevice *self)
+{
+	struct udevice *dev;
+
+	if (!ofnode_valid(node) || device_find_global_by_ofnode(node, &dev))
+		return false;
+
+	return device_async_waiting(dev, self);
+}
+
+/* Check whether the device for a phandle read from the tree is waiting */
+static bool device_async_phandle_waiting(const fdt32_t *val,
+					 struct udevice *self)
+{
+	ofnode node = ofnode_get_by_phandle(fdt32_to_cpu(*val));
+
+	return device_async_node_waiting(node, self);
+}
+
+static bool device_async_list_waiting(struct udevice *dev, const char *list,
+				      const char *cells_name)
+{
+	struct ofnode_phandle_args args;
+	int i;
+
+	for (i = 0; !dev_read_phandle_with_args(dev, list, cells_name, 0, i,
+						&args); i++) {
+		if (device_async_node_waiting(args.node, dev))
+			return true;
+	}
+
+	return false;
+}
+
+/* Check whether a property refers to a regulator */
+static bool device_async_is_supply(const char *name, int len)
+{
+	const char *suffix = "-supply";
+	int name_len = strlen(name);
+	int suffix_len = strlen(suffix);
+
+	return len == sizeof(fdt32_t) && name_len > suffix_len &&
+		!strcmp(name + name_len - suffix_len, suffix);
+}
+
+static bool device_async_supply_waiting(struct udevice *dev)
+{
+	ofnode node = dev_ofnode(dev);
+	const fdt32_t *val;
+
+	if (ofnode_is_np(node)) {
+		struct property *pp;
+
+		for (pp = ofnode_to_np(node)->properties; pp; pp = pp->next) {
+			val = pp->value;
+			if (!device_async_is_supply(pp->name, pp->length))
+				continue;
+			if (device_async_phandle_waiting(val, dev))
+				return true;
+		}
+	} else {
+		const void *blob = gd->fdt_blob;
+		const char *name;
+		int offset, len;
+
+		fdt_for_each_property_offset(offset, blob,
+					     ofnode_to_offset(node)) {
+			val = fdt_getprop_by_offset(blob, offset, &name, &len);
+			if (!val || !device_async_is_supply(name, len))
+				continue;
+			if (device_async_phandle_waiting(val, dev))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Check whether a device must wait for another device in the queue before
+ * it is started: its parents, clocks, resets and regulators.
+ */
+static bool device_async_blocked(struct udevice *dev)
+{
+	if (device_async_waiting(dev->parent, dev))
+		return true;
+	if (!dev_of_valid(dev))
+		return false;
+
+	return device_async_list_waiting(dev, "clocks", "#clock-cells") ||
+		device_async_list_waiting(dev, "resets", "#reset-cells") ||
+		device_async_supply_waiting(dev);
+}
+
+/*
+ * Start or continue probing a device in the queue, ignoring its
+ * dependencies if @force is true.
+ *
+ * @return 0 if it was probed, -EINPROGRESS if it is still in the queue,
+ *	other -ve if probing it failed
+ */
+static int device_async_step(struct udevice *dev, bool force)
+{
+	int ret;
+
+	if (!device_active(dev) && !force && device_async_blocked(dev)) {
+		list_move_tail(&dev->probe_node, &gd->probe_queue);
+		return -EINPROGRESS;
+	}
+
+	/*
+	 * Take it out of the queue so that probe() is not called recursively.
+	 * If probing it fails, it can then be removed like any other device.
+	 */
+	list_del_init(&dev->probe_node);
+	dev->flags &= ~DM_FLAG_PROBE_PENDING;
+	gd->probe_depth++;
+	if (device_active(dev))
+		ret = device_probe_continue(dev);
+	else
+		ret = device_probe_start(dev);
+	gd->probe_depth--;
+
+	if (ret == -EINPROGRESS) {
+		dev->flags |= DM_FLAG_PROBE_PENDING;
+		list_add_tail(&dev->probe_node, &gd->probe_queue);
+		return ret;
+	}
+	if (ret)
+		dm_warn("%s: Device '%s' failed to probe: %d\n", __func__,
+			dev->name, ret);
+
+	return ret;
+}
+
+/*
+ * Poll each device in the queue once
+ *
+ * @errp: Set to the first error, if not NULL and not already set
+ * @return number of devices still in the queue
+ */
+static int device_async_poll(int *errp)
+{
+	struct udevice *dev;
+	bool stuck = true;
+	int count = 0;
+	int ret, i;
+
+	list_for_each_entry(dev, &gd->probe_queue, probe_node)
+		count++;
+
+	/* Devices still waiting go back to the end of the queue */
+	for (i = 0; i < count && !list_empty(&gd->probe_queue); i++) {
+		dev = list_first_entry(&gd->probe_queue, struct udevice,
+				       probe_node);
+		ret = device_async_step(dev, false);
+		if (ret != -EINPROGRESS || device_active(dev))
+			stuck = false;
+		if (ret && ret != -EINPROGRESS && errp && !*errp)
+			*errp = ret;
+	}
+
+	/*
+	 * If every device is waiting for another one in the queue, they
+	 * depend on each other. Start the first one anyway: it probes the
+	 * others as it needs them.
+	 */
+	if (stuck && !gd->probe_depth && !list_empty(&gd->probe_queue)) {
+		dev = list_first_entry(&gd->probe_queue, struct udevice,
+				       probe_node);
+		ret = device_async_step(dev, true);
+		if (ret && ret != -EINPROGRESS && errp && !*errp)
+			*errp = ret;
+	}
+
+	count = 0;
+	list_for_each_entry(dev, &gd->probe_queue, probe_node)
+		count++;
+
+	return count;
+}
+
+int device_probe_async(struct udevice *dev)
+{
+	int ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if (dev->flags & (DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING))
+		return 0;
+
+	dev->flags |= DM_FLAG_PROBE_PENDING;
+	list_add_tail(&dev->probe_node, &gd->probe_queue);
+	ret = device_async_step(dev, false);
+
+	return ret == -EINPROGRESS ? 0 : ret;
+}
+
+int device_probe_async_wait(struct udevice *dev)
+{
+	int ret;
+
+	while (dev->flags & DM_FLAG_PROBE_PENDING) {
+		/* The caller needs the device now, so do not wait for others */
+		ret = device_async_step(dev, true);
+		if (ret != -EINPROGRESS)
+			return ret;
+		device_async_poll(NULL);
+		WATCHDOG_RESET();
+	}
+
+	return 0;
+}
+
+int device_probe_async_cancel(struct udevice *dev)
+{
+	if (!(dev->flags & DM_FLAG_PROBE_PENDING))
+		return 0;
+
+	if (device_active(dev))
+		return device_probe_async_wait(dev);
+
+	/* It has not been started, so just forget about it */
+	list_del_init(&dev->probe_node);
+	dev->flags &= ~DM_FLAG_PROBE_PENDING;
+
+	return 0;
+}
+
+int dm_probe_async_poll(void)
+{
+	return device_async_poll(NULL);
+}
+
+int dm_probe_async_wait(void)
+{
+	int err = 0;
+
+	/* Devices in the queue may be waiting for the caller */
+	if (gd->probe_depth)
+		return -EDEADLK;
+
+	while (device_async_poll(&err))
+		WATCHDOG_RESET();
+
+	return err;
+}
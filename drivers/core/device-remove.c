@@ -65,6 +65,10 @@ int device_unbind(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
+	ret = device_probe_async_cancel(dev);
+	if (ret)
+		return ret;
+
 	if (dev->flags & DM_FLAG_ACTIVATED)
 		return -EINVAL;
 
@@ -99,6 +103,7 @@ int device_unbind(struct udevice *dev)
 	ret = uclass_unbind_device(dev);
 	if (ret)
 		return ret;
+	device_index_remove(dev);
 
 	if (dev->parent)
 		list_del(&dev->sibling_node);
@@ -161,6 +166,11 @@ int device_remove(struct udevice *dev, uint flags)
 	if (!dev)
 		return -EINVAL;
 
+	/* Finish any probe in progress, or forget a device not yet started */
+	ret = device_probe_async_cancel(dev);
+	if (ret)
+		return ret;
+
 	if (!(dev->flags & DM_FLAG_ACTIVATED))
 		return 0;
 
@@ -28,9 +28,155 @@
 #include <linux/err.h>
 #include <linux/list.h>
 #include <power-domain.h>
+#include <watchdog.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(DM_DEVICE_INDEX)
+/* Number of chains in each table, as a power of two */
+#define DEVICE_INDEX_BITS_F	5
+#define DEVICE_INDEX_BITS	8
+
+static uint device_index_hash(ulong key, uint bits)
+{
+	return (u32)(key ^ (key >> 16)) * 0x9e3779b1U >> (32 - bits);
+}
+
+static struct hlist_head *device_index_node_head(struct dm_device_index *idx,
+						 ofnode node)
+{
+	return &idx->node_head[device_index_hash(node.of_offset, idx->bits)];
+}
+
+static struct hlist_head *
+device_index_phandle_head(struct dm_device_index *idx, uint phandle)
+{
+	return &idx->phandle_head[device_index_hash(phandle, idx->bits)];
+}
+
+/* Add a device to the end of a chain, to keep them in bind order */
+static void device_index_add_tail(struct hlist_node *n, struct hlist_head *h)
+{
+	struct hlist_node *last;
+
+	if (!h->first) {
+		hlist_add_head(n, h);
+		return;
+	}
+	for (last = h->first; last->next; last = last->next)
+		;
+	hlist_add_after(last, n);
+}
+
+void device_index_init(void)
+{
+	struct dm_device_index *idx;
+	uint bits, size;
+
+	bits = gd->flags & GD_FLG_RELOC ? DEVICE_INDEX_BITS :
+		DEVICE_INDEX_BITS_F;
+	size = sizeof(struct hlist_head) << bits;
+	idx = calloc(1, sizeof(*idx) + size * 2);
+	if (!idx)
+		log_debug("No memory for device index\n");
+	else {
+		idx->bits = bits;
+		idx->node_head = (struct hlist_head *)(idx + 1);
+		idx->phandle_head = (void *)idx->node_head + size;
+	}
+	gd->dm_index = idx;
+}
+
+void device_index_uninit(void)
+{
+	free(gd->dm_index);
+	gd->dm_index = NULL;
+}
+
+void device_index_add(struct udevice *dev)
+{
+	struct dm_device_index *idx = gd->dm_index;
+
+	if (!idx || !ofnode_valid(dev->node))
+		return;
+	device_index_add_tail(&dev->node_hash,
+			      device_index_node_head(idx, dev->node));
+	dev->phandle = dev_read_phandle(dev);
+	if (dev->phandle)
+		device_index_add_tail(&dev->phandle_hash,
+				      device_index_phandle_head(idx,
+								dev->phandle));
+	idx->count++;
+}
+
+void device_index_remove(struct udevice *dev)
+{
+	struct dm_device_index *idx = gd->dm_index;
+
+	if (!idx || hlist_unhashed(&dev->node_hash))
+		return;
+	hlist_del_init(&dev->node_hash);
+	hlist_del_init(&dev->phandle_hash);
+	dev->phandle = 0;
+	idx->count--;
+}
+
+int device_index_find_by_ofnode(enum uclass_id id, ofnode node,
+				struct udevice **devp)
+{
+	struct dm_device_index *idx = gd->dm_index;
+	struct hlist_node *pos;
+	struct udevice *dev;
+
+	*devp = NULL;
+	if (!idx)
+		return -ENOSYS;
+	idx->node_lookups++;
+	hlist_for_each_entry(dev, pos, device_index_node_head(idx, node),
+			     node_hash) {
+		if (ofnode_equal(dev->node, node) &&
+		    (id == UCLASS_INVALID || device_get_uclass_id(dev) == id)) {
+			*devp = dev;
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+
+int device_index_find_by_phandle(enum uclass_id id, uint phandle,
+				 struct udevice **devp)
+{
+	struct dm_device_index *idx = gd->dm_index;
+	struct hlist_node *pos;
+	struct udevice *dev;
+
+	*devp = NULL;
+	if (!idx)
+		return -ENOSYS;
+	idx->phandle_lookups++;
+	hlist_for_each_entry(dev, pos, device_index_phandle_head(idx, phandle),
+			     phandle_hash) {
+		if (dev->phandle == phandle &&
+		    (id == UCLASS_INVALID || device_get_uclass_id(dev) == id)) {
+			*devp = dev;
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+#endif
+
+void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	device_index_remove(dev);
+	dev->node = node;
+	/* A device which is not in its uclass yet is indexed when it is */
+	if (!list_empty(&dev->uclass_node))
+		device_index_add(dev);
+}
+
 static int device_bind_common(struct udevice *parent, const struct driver *drv,
 			      const char *name, void *platdata,
 			      ulong driver_data, ofnode node,
@@ -60,6 +206,9 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	INIT_LIST_HEAD(&dev->uclass_node);
 #ifdef CONFIG_DEVRES
 	INIT_LIST_HEAD(&dev->devres_head);
+#endif
+#if CONFIG_IS_ENABLED(DM_PROBE_ASYNC)
+	INIT_LIST_HEAD(&dev->probe_node);
 #endif
 	dev->platdata = platdata;
 	dev->driver_data = driver_data;
@@ -152,6 +301,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	ret = uclass_bind_device(dev);
 	if (ret)
 		goto fail_uclass_bind;
+	device_index_add(dev);
 
 	/* if we fail to bind we remove device from successors and free it */
 	if (drv->bind) {
@@ -190,6 +340,7 @@ fail_child_post_bind:
 	}
 
 fail_bind:
+	device_index_remove(dev);
 	if (CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)) {
 		if (uclass_unbind_device(dev)) {
 			dm_warn("Failed to unbind dev '%s' on error path\n",
@@ -311,7 +462,82 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+/* Undo the effects of a failed probe */
+static void device_probe_undo(struct udevice *dev)
+{
+	dev->flags &= ~(DM_FLAG_ACTIVATED | DM_FLAG_PROBING);
+
+	dev->seq = -1;
+	device_free(dev);
+}
+
+/* Finish probing a device once its driver's probe() method has succeeded */
+static int device_probe_finish(struct udevice *dev)
+{
+	int ret;
+
+	dev->flags &= ~DM_FLAG_PROBING;
+	ret = uclass_post_probe_device(dev);
+	if (ret)
+		goto fail_uclass;
+
+	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
+		pinctrl_select_state(dev, "default");
+
+	return 0;
+fail_uclass:
+	if (device_remove(dev, DM_REMOVE_NORMAL)) {
+		dm_warn("%s: Device '%s' failed to remove on error path\n",
+			__func__, dev->name);
+	}
+	device_probe_undo(dev);
+
+	return ret;
+}
+
+int device_probe_continue(struct udevice *dev)
+{
+	int ret;
+
+	ret = dev->driver->probe(dev);
+	if (ret == -EAGAIN)
+		return -EINPROGRESS;
+	if (ret) {
+		device_probe_undo(dev);
+		return ret;
+	}
+
+	return device_probe_finish(dev);
+}
+
+/*
+ * Call probe() again until the driver has finished waiting for its
+ * hardware, letting devices in the background make progress meanwhile
+ */
+static int device_probe_retry(struct udevice *dev)
+{
+	int ret;
+
+#if CONFIG_IS_ENABLED(DM_PROBE_ASYNC)
+	/* Queued devices may depend on this one, so none is forced to start */
+	gd->probe_depth++;
+#endif
+	do {
+		dev->flags |= DM_FLAG_PROBE_WAIT;
+		dm_probe_async_poll();
+		dev->flags &= ~DM_FLAG_PROBE_WAIT;
+		WATCHDOG_RESET();
+		ret = dev->driver->probe(dev);
+	} while (ret == -EAGAIN);
+#if CONFIG_IS_ENABLED(DM_PROBE_ASYNC)
+	gd->probe_depth--;
+#endif
+
+	return ret;
+}
+
+/* Probe a device, returning -EINPROGRESS if @async and probe() must wait */
+static int device_do_probe(struct udevice *dev, bool async)
 {
 	const struct driver *drv;
 	int size = 0;
@@ -382,7 +608,8 @@ int device_probe(struct udevice *dev)
 	}
 	dev->seq = seq;
 
-	dev->flags |= DM_FLAG_ACTIVATED;
+	/* Devices probed in the background which depend on it must wait */
+	dev->flags |= DM_FLAG_ACTIVATED | DM_FLAG_PROBING;
 
 	/*
 	 * Process pinctrl for everything except the root device, and
@@ -431,32 +658,42 @@ int device_probe(struct udevice *dev)
 
 	if (drv->probe) {
 		ret = drv->probe(dev);
-		if (ret) {
-			dev->flags &= ~DM_FLAG_ACTIVATED;
-			goto fail;
+		/* The driver is waiting for its hardware */
+		if (ret == -EAGAIN && (drv->flags & DM_FLAG_PROBE_ASYNC)) {
+			if (async)
+				return -EINPROGRESS;
+			ret = device_probe_retry(dev);
 		}
+		if (ret)
+			goto fail;
 	}
 
-	ret = uclass_post_probe_device(dev);
-	if (ret)
-		goto fail_uclass;
+	return device_probe_finish(dev);
+fail:
+	device_probe_undo(dev);
 
-	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
-		pinctrl_select_state(dev, "default");
+	return ret;
+}
 
-	return 0;
-fail_uclass:
-	if (device_remove(dev, DM_REMOVE_NORMAL)) {
-		dm_warn("%s: Device '%s' failed to remove on error path\n",
-			__func__, dev->name);
-	}
-fail:
-	dev->flags &= ~DM_FLAG_ACTIVATED;
+int device_probe_start(struct udevice *dev)
+{
+	return device_do_probe(dev, true);
+}
 
-	dev->seq = -1;
-	device_free(dev);
+int device_probe(struct udevice *dev)
+{
+	int ret;
 
-	return ret;
+	if (dev && (dev->flags & DM_FLAG_PROBE_PENDING)) {
+		ret = device_probe_async_wait(dev);
+		if (ret)
+			return ret;
+	}
+	/* Its probe() is waiting for the hardware further up the stack */
+	if (dev && (dev->flags & DM_FLAG_PROBE_WAIT))
+		return -EBUSY;
+
+	return device_do_probe(dev, false);
 }
 
 void *dev_get_platdata(const struct udevice *dev)
@@ -671,7 +908,11 @@ static struct udevice *_device_find_global_by_ofnode(struct udevice *parent,
 
 int device_find_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
-	*devp = _device_find_global_by_ofnode(gd->dm_root, ofnode);
+	int ret;
+
+	ret = device_index_find_by_ofnode(UCLASS_INVALID, ofnode, devp);
+	if (ret == -ENOSYS)
+		*devp = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 
 	return *devp ? 0 : -ENOENT;
 }
@@ -680,7 +921,7 @@ int device_get_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
 	struct udevice *dev;
 
-	dev = _device_find_global_by_ofnode(gd->dm_root, ofnode);
+	device_find_global_by_ofnode(ofnode, &dev);
 	return device_get_device_tail(dev, dev ? 0 : -ENOENT, devp);
 }
 
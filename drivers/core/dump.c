@@ -6,10 +6,13 @@
 #include <common.h>
 #include <dm.h>
 #include <mapmem.h>
+#include <dm/device-internal.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/uclass-internal.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static void show_devices(struct udevice *dev, int depth, int last_flag)
 {
 	int i, is_last;
@@ -96,3 +99,29 @@ void dm_dump_uclass(void)
 		puts("\n");
 	}
 }
+
+void dm_dump_stats(void)
+{
+#if CONFIG_IS_ENABLED(DM_DEVICE_INDEX)
+	struct dm_device_index *idx = gd->dm_index;
+	struct hlist_node *pos;
+	uint i, len, longest = 0;
+
+	if (!idx) {
+		puts("Device index not allocated\n");
+		return;
+	}
+	for (i = 0; i < 1U << idx->bits; i++) {
+		len = 0;
+		hlist_for_each(pos, &idx->node_head[i])
+			len++;
+		longest = max(longest, len);
+	}
+	printf("Device index: %u devices, %u chains, longest %u\n",
+	       idx->count, 1U << idx->bits, longest);
+	printf("Lookups by node:    %lu\n", idx->node_lookups);
+	printf("Lookups by phandle: %lu\n", idx->phandle_lookups);
+#else
+	puts("Device index not enabled\n");
+#endif
+}
@@ -17,7 +17,12 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <linux/compiler.h>
+#include <linux/err.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -124,11 +129,185 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+/**
+ * struct lists_compat_slot - Slot in the compatible-string hash table
+ *
+ * Indexes are used rather than pointers to keep the table small.
+ *
+ * @hash:	Hash of the compatible string, or 0 if the slot is empty
+ * @drv:	Index of the driver in the driver linker list
+ * @id:		Index of the string in the driver's of_match table
+ */
+struct lists_compat_slot {
+	u32 hash;
+	u16 drv;
+	u16 id;
+};
+
+/**
+ * struct lists_compat_hash - Hash table of driver compatible strings
+ *
+ * Only the first driver in the linker list with a particular compatible
+ * string is entered, since that is the one which a linear search finds.
+ * Collisions are resolved by linear probing. At most half of the slots are
+ * used, so a search always ends at an empty slot.
+ *
+ * @driver:	First driver in the linker list
+ * @mask:	Number of slots - 1 (the number of slots is a power of two)
+ * @slot:	Slots
+ */
+struct lists_compat_hash {
+	struct driver *driver;
+	uint mask;
+	struct lists_compat_slot slot[];
+};
+
+static u32 lists_compat_hash_str(const char *str)
+{
+	u32 hash = 2166136261U;
+
+	/* FNV-1a, avoiding 0 which marks an empty slot */
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 16777619U;
+
+	return hash ?: 1;
+}
+
+/* Find the slot for @compat, which may be empty */
+static struct lists_compat_slot *
+lists_compat_find(struct lists_compat_hash *tab, const char *compat)
+{
+	u32 hash = lists_compat_hash_str(compat);
+	struct lists_compat_slot *slot;
+	const struct udevice_id *id;
+	uint i;
+
+	for (i = hash & tab->mask;; i = (i + 1) & tab->mask) {
+		slot = &tab->slot[i];
+		if (!slot->hash)
+			return slot;
+		if (slot->hash != hash)
+			continue;
+		id = &tab->driver[slot->drv].of_match[slot->id];
+		if (!strcmp(id->compatible, compat))
+			return slot;
+	}
+}
+
+static struct lists_compat_hash *lists_compat_hash_build(void)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match;
+	struct lists_compat_hash *tab;
+	struct lists_compat_slot *slot;
+	struct driver *entry;
+	uint count = 0, size;
+	const char *compat;
+	size_t bytes;
+	int j;
+
+	if (n_ents > U16_MAX + 1)
+		return NULL;
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++)
+			count++;
+	}
+	size = roundup_pow_of_two(max(count * 2, 2U));
+	bytes = sizeof(*tab) + size * sizeof(tab->slot[0]);
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	/* Don't take more than the early malloc() pool has left */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    gd->malloc_ptr + bytes > gd->malloc_limit)
+		return NULL;
+#endif
+	tab = calloc(1, bytes);
+	if (!tab)
+		return NULL;
+	tab->driver = driver;
+	tab->mask = size - 1;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		of_match = entry->of_match;
+		for (j = 0; of_match && of_match[j].compatible; j++) {
+			if (j > U16_MAX) {
+				free(tab);
+				return NULL;
+			}
+			compat = of_match[j].compatible;
+			slot = lists_compat_find(tab, compat);
+			if (slot->hash)
+				continue;
+			slot->hash = lists_compat_hash_str(compat);
+			slot->drv = entry - driver;
+			slot->id = j;
+		}
+	}
+	log_debug("%u compatible strings in %u slots\n", count, size);
+
+	return tab;
+}
+
+/*
+ * Look up a compatible string in the hash table, building it if needed.
+ * Returns -ENOSYS if the table is not available.
+ */
+static int lists_compat_hash_lookup(const char *compat, struct driver **drvp,
+				    const struct udevice_id **idp)
+{
+	struct lists_compat_hash *tab = gd->compat_hash;
+	struct lists_compat_slot *slot;
+
+	if (!tab) {
+		tab = lists_compat_hash_build();
+		if (!tab) {
+			log_debug("No memory for compatible-string table\n");
+			tab = ERR_PTR(-ENOMEM);
+		}
+		gd->compat_hash = tab;
+	}
+	if (IS_ERR(tab))
+		return -ENOSYS;
+
+	slot = lists_compat_find(tab, compat);
+	if (!slot->hash)
+		return -ENOENT;
+	*drvp = &tab->driver[slot->drv];
+	*idp = &tab->driver[slot->drv].of_match[slot->id];
+
+	return 0;
+}
+#endif
+
+int lists_driver_lookup_compat(const char *compat, struct driver **drvp,
+			       const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+	int ret;
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+	ret = lists_compat_hash_lookup(compat, drvp, idp);
+	if (ret != -ENOSYS)
+		return ret;
+#endif
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		ret = driver_check_compatible(entry->of_match, idp, compat);
+		if (!ret) {
+			*drvp = entry;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -165,13 +344,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		log_debug("   - attempt to match compatible string '%s'\n",
 			  compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		ret = lists_driver_lookup_compat(compat, &entry, &id);
+		if (ret)
 			continue;
 
 		if (pre_reloc_only) {
@@ -20,11 +20,13 @@
  */
 
 #include <common.h>
+#include <malloc.h>
 #include <linux/libfdt.h>
 #include <dm/of_access.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/ioport.h>
+#include <linux/log2.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -37,6 +39,13 @@ static struct device_node *of_aliases;
 /* "/chosen" node */
 static struct device_node *of_chosen;
 
+/* Cache of nodes by phandle, see of_populate_phandle_cache() */
+static struct device_node **phandle_cache;
+static u32 phandle_cache_mask;
+
+/* Root of the tree which phandle_cache was set up for */
+static const struct device_node *phandle_cache_root;
+
 /* node pointed to by the stdout-path alias */
 static struct device_node *of_stdout;
 
@@ -119,6 +128,46 @@ int of_simple_size_cells(const struct device_node *np)
 	return 2;
 }
 
+static uint of_prop_hash_str(const char *name)
+{
+	uint hash = 2166136261U;
+
+	/* FNV-1a */
+	while (*name)
+		hash = (hash ^ (u8)*name++) * 16777619U;
+
+	return hash;
+}
+
+/* Find the slot for a property in a node's hash table, which may be empty */
+static struct property **of_prop_hash_slot(const struct device_node *np,
+					   const char *name)
+{
+	struct property **slot;
+	uint i;
+
+	for (i = of_prop_hash_str(name);; i++) {
+		slot = &np->prop_hash[i & np->prop_hash_mask];
+		if (!*slot || !strcmp((*slot)->name, name))
+			return slot;
+	}
+}
+
+void of_prop_hash_init(struct device_node *np, struct property **hash,
+		       uint mask)
+{
+	struct property *pp, **slot;
+
+	np->prop_hash = hash;
+	np->prop_hash_mask = mask;
+	for (pp = np->properties; pp; pp = pp->next) {
+		/* Keep the first property with each name, like the list */
+		slot = of_prop_hash_slot(np, pp->name);
+		if (!*slot)
+			*slot = pp;
+	}
+}
+
 struct property *of_find_property(const struct device_node *np,
 				  const char *name, int *lenp)
 {
@@ -127,15 +176,16 @@ struct property *of_find_property(const struct device_node *np,
 	if (!np)
 		return NULL;
 
-	for (pp = np->properties; pp; pp = pp->next) {
-		if (strcmp(pp->name, name) == 0) {
-			if (lenp)
-				*lenp = pp->length;
-			break;
+	if (np->prop_hash) {
+		pp = *of_prop_hash_slot(np, name);
+	} else {
+		for (pp = np->properties; pp; pp = pp->next) {
+			if (strcmp(pp->name, name) == 0)
+				break;
 		}
 	}
-	if (!pp && lenp)
-		*lenp = -FDT_ERR_NOTFOUND;
+	if (lenp)
+		*lenp = pp ? pp->length : -FDT_ERR_NOTFOUND;
 
 	return pp;
 }
@@ -403,17 +453,57 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 	return np;
 }
 
-struct device_node *of_find_node_by_phandle(phandle handle)
+void of_populate_phandle_cache(void)
 {
 	struct device_node *np;
+	u32 count = 0, size;
+
+	free(phandle_cache);
+	phandle_cache = NULL;
+	phandle_cache_root = NULL;
+
+	for_each_of_allnodes(np)
+		if (np->phandle)
+			count++;
+	if (!count)
+		return;
+
+	/* dtc numbers phandles from 1, so this usually has no collisions */
+	size = roundup_pow_of_two(count);
+	phandle_cache = calloc(size, sizeof(*phandle_cache));
+	if (!phandle_cache) {
+		debug("%s: No memory for %u phandles\n", __func__, count);
+		return;
+	}
+	phandle_cache_mask = size - 1;
+	phandle_cache_root = gd->of_root;
+
+	for_each_of_allnodes(np) {
+		if (np->phandle &&
+		    !phandle_cache[np->phandle & phandle_cache_mask])
+			phandle_cache[np->phandle & phandle_cache_mask] = np;
+	}
+}
+
+struct device_node *of_find_node_by_phandle(phandle handle)
+{
+	struct device_node *np, **slot = NULL;
 
 	if (!handle)
 		return NULL;
 
+	if (phandle_cache && phandle_cache_root == gd->of_root) {
+		slot = &phandle_cache[handle & phandle_cache_mask];
+		if (*slot && (*slot)->phandle == handle)
+			return of_node_get(*slot);
+	}
+
 	for_each_of_allnodes(np)
 		if (np->phandle == handle)
 			break;
 	(void)of_node_get(np);
+	if (np && slot)
+		*slot = np;
 
 	return np;
 }
@@ -26,8 +26,8 @@ int ofnode_read_u32(ofnode node, const char *propname, u32 *outp)
 		const fdt32_t *cell;
 		int len;
 
-		cell = fdt_getprop(gd->fdt_blob, ofnode_to_offset(node),
-				   propname, &len);
+		cell = fdtdec_getprop(gd->fdt_blob, ofnode_to_offset(node),
+				      propname, &len);
 		if (!cell || len < sizeof(int)) {
 			debug("(not found)\n");
 			return -EINVAL;
@@ -66,8 +66,8 @@ int ofnode_read_u64(ofnode node, const char *propname, u64 *outp)
 	if (ofnode_is_np(node))
 		return of_read_u64(ofnode_to_np(node), propname, outp);
 
-	cell = fdt_getprop(gd->fdt_blob, ofnode_to_offset(node), propname,
-			   &len);
+	cell = fdtdec_getprop(gd->fdt_blob, ofnode_to_offset(node), propname,
+			      &len);
 	if (!cell || len < sizeof(*cell)) {
 		debug("(not found)\n");
 		return -EINVAL;
@@ -118,8 +118,8 @@ const char *ofnode_read_string(ofnode node, const char *propname)
 			len = prop->length;
 		}
 	} else {
-		str = fdt_getprop(gd->fdt_blob, ofnode_to_offset(node),
-				  propname, &len);
+		str = fdtdec_getprop(gd->fdt_blob, ofnode_to_offset(node),
+				     propname, &len);
 	}
 	if (!str) {
 		debug("<not found>\n");
@@ -230,8 +230,8 @@ ofnode ofnode_get_by_phandle(uint phandle)
 	if (of_live_active())
 		node = np_to_ofnode(of_find_node_by_phandle(phandle));
 	else
-		node.of_offset = fdt_node_offset_by_phandle(gd->fdt_blob,
-							    phandle);
+		node.of_offset = fdtdec_node_offset_by_phandle(gd->fdt_blob,
+							       phandle);
 
 	return node;
 }
@@ -247,8 +247,8 @@ int ofnode_read_size(ofnode node, const char *propname)
 		if (prop)
 			return prop->length;
 	} else {
-		if (fdt_getprop(gd->fdt_blob, ofnode_to_offset(node), propname,
-				&len))
+		if (fdtdec_getprop(gd->fdt_blob, ofnode_to_offset(node),
+				   propname, &len))
 			return len;
 	}
 
@@ -416,7 +416,7 @@ ofnode ofnode_path(const char *path)
 	if (of_live_active())
 		return np_to_ofnode(of_find_node_by_path(path));
 	else
-		return offset_to_ofnode(fdt_path_offset(gd->fdt_blob, path));
+		return offset_to_ofnode(fdtdec_path_offset(gd->fdt_blob, path));
 }
 
 const char *ofnode_get_chosen_prop(const char *name)
@@ -532,8 +532,8 @@ const void *ofnode_get_property(ofnode node, const char *propname, int *lenp)
 	if (ofnode_is_np(node))
 		return of_get_property(ofnode_to_np(node), propname, lenp);
 	else
-		return fdt_getprop(gd->fdt_blob, ofnode_to_offset(node),
-				   propname, lenp);
+		return fdtdec_getprop(gd->fdt_blob, ofnode_to_offset(node),
+				      propname, lenp);
 }
 
 bool ofnode_is_available(ofnode node)
@@ -866,6 +866,9 @@ int ofnode_write_prop(ofnode node, const char *propname, int len,
 
 	pp_last->next = new;
 
+	/* The hash table does not have the new property, so stop using it */
+	((struct device_node *)np)->prop_hash = NULL;
+
 	return 0;
 }
 
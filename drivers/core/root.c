@@ -138,6 +138,11 @@ int dm_init(bool of_live)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+	device_index_init();
+#if CONFIG_IS_ENABLED(DM_PROBE_ASYNC)
+	INIT_LIST_HEAD(&gd->probe_queue);
+	gd->probe_depth = 0;
+#endif
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
@@ -151,10 +156,10 @@ int dm_init(bool of_live)
 #if CONFIG_IS_ENABLED(OF_CONTROL)
 # if CONFIG_IS_ENABLED(OF_LIVE)
 	if (of_live)
-		DM_ROOT_NON_CONST->node = np_to_ofnode(gd->of_root);
+		dev_set_ofnode(DM_ROOT_NON_CONST, np_to_ofnode(gd->of_root));
 	else
 #endif
-		DM_ROOT_NON_CONST->node = offset_to_ofnode(0);
+		dev_set_ofnode(DM_ROOT_NON_CONST, offset_to_ofnode(0));
 #endif
 	ret = device_probe(DM_ROOT_NON_CONST);
 	if (ret)
@@ -168,6 +173,7 @@ int dm_uninit(void)
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
 	device_unbind(dm_root());
 	gd->dm_root = NULL;
+	device_index_uninit();
 
 	return 0;
 }
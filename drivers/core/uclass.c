@@ -366,6 +366,9 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+	ret = device_index_find_by_ofnode(id, node, devp);
+	if (ret != -ENOSYS)
+		goto done;
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
@@ -399,6 +402,9 @@ int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 	if (ret)
 		return ret;
 
+	ret = device_index_find_by_phandle(id, find_phandle, devp);
+	if (ret != -ENOSYS)
+		return ret;
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
@@ -526,6 +532,9 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 	if (ret)
 		return ret;
 
+	ret = device_index_find_by_phandle(id, phandle_id, &dev);
+	if (ret != -ENOSYS)
+		return uclass_get_device_tail(dev, ret, devp);
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
@@ -97,6 +97,17 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	if (fastboot_progress_callback)
+		fastboot_progress_callback("erasing");
+
+	return blk_derase(sparse->dev_desc, blk, blkcnt);
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		u32 download_bytes, char *response)
@@ -405,15 +416,21 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	if (is_sparse_image(download_buffer)) {
 		struct fb_mmc_sparse sparse_priv;
 		struct sparse_storage sparse;
+		struct mmc *mmc;
 		int err;
 
 		sparse_priv.dev_desc = dev_desc;
+		mmc = find_mmc_device(dev_desc->devnum);
 
 		sparse.blksz = info.blksz;
 		sparse.start = info.start;
 		sparse.size = info.size;
 		sparse.write = fb_mmc_sparse_write;
 		sparse.reserve = fb_mmc_sparse_reserve;
+		sparse.erase = fb_mmc_sparse_erase;
+		/* Zero-filled chunks are erased if that leaves zeroes */
+		sparse.erase_grp = mmc && mmc_erased_is_zero(mmc) ?
+				   mmc->erase_grp_size : 0;
 		sparse.mssg = fastboot_fail;
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
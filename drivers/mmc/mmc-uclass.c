@@ -14,10 +14,15 @@
 int dm_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		    struct mmc_data *data)
 {
+	struct mmc_uclass_priv *upriv = dev_get_uclass_priv(dev);
 	struct mmc *mmc = mmc_get_mmc_dev(dev);
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
 	int ret;
 
+	/* Let any transfer started by dm_mmc_start_cmd() finish first */
+	while (upriv->async_data && dm_mmc_poll_cmd(dev) == -EBUSY)
+		;
+
 	mmmc_trace_before_send(mmc, cmd);
 	if (ops->send_cmd)
 		ret = ops->send_cmd(dev, cmd, data);
@@ -33,6 +38,70 @@ int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 	return dm_mmc_send_cmd(mmc->dev, cmd, data);
 }
 
+int dm_mmc_start_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+		     struct mmc_data *data)
+{
+	struct mmc_uclass_priv *upriv = dev_get_uclass_priv(dev);
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+	int ret;
+
+	if (!ops->start_cmd || !ops->poll_cmd)
+		return -ENOSYS;
+	while (upriv->async_data && dm_mmc_poll_cmd(dev) == -EBUSY)
+		;
+
+	/* Either pre-define the block count or stop the transfer after */
+	upriv->async_stop = false;
+	if (data->blocks > 1) {
+		if (mmc_use_set_block_count(mmc)) {
+			bool reliable = (data->flags & MMC_DATA_WRITE) &&
+				mmc_use_reliable_write(mmc);
+
+			ret = mmc_set_block_count(mmc, data->blocks, reliable);
+			if (ret)
+				return ret;
+		} else {
+			upriv->async_stop = true;
+		}
+	}
+
+	mmmc_trace_before_send(mmc, cmd);
+	ret = ops->start_cmd(dev, cmd, data);
+	mmmc_trace_after_send(mmc, cmd, ret);
+	if (ret)
+		return ret;
+	upriv->async_data = data;
+	upriv->async_ret = -EBUSY;
+
+	return 0;
+}
+
+int dm_mmc_poll_cmd(struct udevice *dev)
+{
+	struct mmc_uclass_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+	struct mmc_cmd cmd;
+	int ret;
+
+	if (!upriv->async_data)
+		return upriv->async_ret;
+	ret = ops->poll_cmd(dev, upriv->async_data);
+	if (ret == -EBUSY)
+		return ret;
+	upriv->async_data = NULL;
+
+	if (!ret && upriv->async_stop) {
+		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
+		cmd.cmdarg = 0;
+		cmd.resp_type = MMC_RSP_R1b;
+		ret = dm_mmc_send_cmd(dev, &cmd, NULL);
+	}
+	upriv->async_ret = ret;
+
+	return ret;
+}
+
 int dm_mmc_set_ios(struct udevice *dev)
 {
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
@@ -389,13 +458,194 @@ static int mmc_select_hwpart(struct udevice *bdev, int hwpart)
 	return ret;
 }
 
+/* Time allowed for the card to program the blocks of a write */
+#define MMC_BLK_PROG_TIMEOUT_MS	1000
+
+/**
+ * struct mmc_blk_priv - Asynchronous transfers in progress on an MMC device
+ *
+ * @reqs:	Requests not yet finished, oldest first
+ * @busy:	true if a transfer for the oldest request is in progress
+ * @programming: true if the card is still programming the blocks of the
+ *		last write
+ * @prog_start:	Time when the card started programming (ms)
+ * @blocks:	Number of blocks in that transfer
+ * @data:	Data for that transfer
+ */
+struct mmc_blk_priv {
+	struct list_head reqs;
+	bool busy;
+	bool programming;
+	ulong prog_start;
+	lbaint_t blocks;
+	struct mmc_data data;
+};
+
+/* Start the next transfer for the oldest request */
+static int mmc_blk_issue(struct udevice *dev)
+{
+	struct mmc_blk_priv *priv = dev_get_priv(dev);
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct udevice *mmc_dev = dev_get_parent(dev);
+	struct mmc *mmc = mmc_get_mmc_dev(mmc_dev);
+	struct blk_req *req = list_first_entry(&priv->reqs, struct blk_req,
+					       node);
+	lbaint_t start = req->start + req->drv_data;
+	lbaint_t skip = req->drv_data;
+	bool write = req->op == BLK_REQ_WRITE;
+	int bl_len = write ? mmc->write_bl_len : mmc->read_bl_len;
+	struct blk_sg *sg = req->sg;
+	struct mmc_cmd cmd;
+	int ret;
+
+	if (!req->drv_data) {
+		ret = blk_dselect_hwpart(desc, desc->hwpart);
+		if (ret)
+			return ret;
+		ret = mmc_set_blocklen(mmc, bl_len);
+		if (ret)
+			return ret;
+	}
+	while (skip >= sg->blkcnt) {
+		skip -= sg->blkcnt;
+		sg++;
+	}
+	priv->blocks = min_t(lbaint_t, sg->blkcnt - skip, mmc->cfg->b_max);
+
+	if (write)
+		cmd.cmdidx = priv->blocks > 1 ? MMC_CMD_WRITE_MULTIPLE_BLOCK :
+			MMC_CMD_WRITE_SINGLE_BLOCK;
+	else
+		cmd.cmdidx = priv->blocks > 1 ? MMC_CMD_READ_MULTIPLE_BLOCK :
+			MMC_CMD_READ_SINGLE_BLOCK;
+	cmd.cmdarg = mmc->high_capacity ? start : start * bl_len;
+	cmd.resp_type = MMC_RSP_R1;
+	if (write)
+		priv->data.src = sg->buf + skip * bl_len;
+	else
+		priv->data.dest = sg->buf + skip * bl_len;
+	priv->data.blocks = priv->blocks;
+	priv->data.blocksize = bl_len;
+	priv->data.flags = write ? MMC_DATA_WRITE : MMC_DATA_READ;
+	ret = dm_mmc_start_cmd(mmc_dev, &cmd, &priv->data);
+	if (ret)
+		return ret;
+	priv->busy = true;
+
+	return 0;
+}
+
+static int mmc_blk_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct mmc_blk_priv *priv = dev_get_priv(dev);
+	struct mmc *mmc __maybe_unused = mmc_get_mmc_dev(dev_get_parent(dev));
+	int ret;
+
+	/* SPI hosts need a stop token after multi-block writes */
+	if (req->op == BLK_REQ_WRITE && mmc_host_is_spi(mmc))
+		return -ENOSYS;
+	req->drv_data = 0;
+	list_add_tail(&req->node, &priv->reqs);
+	if (priv->busy || priv->programming)
+		return 0;
+	ret = mmc_blk_issue(dev);
+	if (ret) {
+		/* Let the uclass carry it out with mmc_bread()/mmc_bwrite() */
+		list_del(&req->node);
+		return -ENOSYS;
+	}
+
+	return 0;
+}
+
+/*
+ * Check whether the card has finished programming the blocks of a write,
+ * without waiting. Returns -EBUSY if not.
+ */
+static int mmc_blk_check_ready(struct udevice *dev)
+{
+	struct mmc_blk_priv *priv = dev_get_priv(dev);
+	struct mmc *mmc = mmc_get_mmc_dev(dev_get_parent(dev));
+	uint status;
+	int ret;
+
+	ret = mmc_send_status(mmc, &status);
+	if (ret)
+		return ret;
+	if ((status & MMC_STATUS_RDY_FOR_DATA) &&
+	    (status & MMC_STATUS_CURR_STATE) != MMC_STATE_PRG)
+		return 0;
+	if (status & MMC_STATUS_MASK)
+		return -ECOMM;
+	if (get_timer(priv->prog_start) > MMC_BLK_PROG_TIMEOUT_MS)
+		return -ETIMEDOUT;
+
+	return -EBUSY;
+}
+
+static int mmc_blk_poll(struct udevice *dev)
+{
+	struct mmc_blk_priv *priv = dev_get_priv(dev);
+	struct blk_req *req;
+	int ret;
+
+	if (priv->busy) {
+		ret = dm_mmc_poll_cmd(dev_get_parent(dev));
+		if (ret == -EBUSY)
+			return 0;
+		priv->busy = false;
+
+		/* The data is sent, but the card may still be writing it */
+		if (!ret && (priv->data.flags & MMC_DATA_WRITE)) {
+			priv->programming = true;
+			priv->prog_start = get_timer(0);
+		}
+	} else if (!priv->programming) {
+		return 0;
+	}
+	if (priv->programming) {
+		ret = mmc_blk_check_ready(dev);
+		if (ret == -EBUSY)
+			return 0;
+		priv->programming = false;
+	}
+
+	req = list_first_entry(&priv->reqs, struct blk_req, node);
+	if (!ret) {
+		req->drv_data += priv->blocks;
+		if (req->drv_data < blk_req_blkcnt(req))
+			ret = mmc_blk_issue(dev);
+		if (!ret && priv->busy)
+			return 0;
+	}
+	list_del(&req->node);
+	blk_req_done(req, ret, req->drv_data);
+
+	/*
+	 * Start on the next one, carrying out any which cannot be started
+	 * synchronously, as mmc_blk_submit() does. A completion may have
+	 * submitted a request, which is then already started.
+	 */
+	while (!priv->busy && !list_empty(&priv->reqs)) {
+		req = list_first_entry(&priv->reqs, struct blk_req, node);
+		if (!mmc_blk_issue(dev))
+			break;
+		list_del(&req->node);
+		blk_req_sync(req);
+	}
+
+	return 0;
+}
+
 static int mmc_blk_probe(struct udevice *dev)
 {
 	struct udevice *mmc_dev = dev_get_parent(dev);
 	struct mmc_uclass_priv *upriv = dev_get_uclass_priv(mmc_dev);
+	struct mmc_blk_priv *priv = dev_get_priv(dev);
 	struct mmc *mmc = upriv->mmc;
 	int ret;
 
+	INIT_LIST_HEAD(&priv->reqs);
 	ret = mmc_init(mmc);
 	if (ret) {
 		debug("%s: mmc_init() failed (err=%d)\n", __func__, ret);
@@ -425,6 +675,8 @@ static const struct blk_ops mmc_blk_ops = {
 	.erase	= mmc_berase,
 #endif
 	.select_hwpart	= mmc_select_hwpart,
+	.submit	= mmc_blk_submit,
+	.poll	= mmc_blk_poll,
 };
 
 U_BOOT_DRIVER(mmc_blk) = {
@@ -432,6 +684,7 @@ U_BOOT_DRIVER(mmc_blk) = {
 	.id		= UCLASS_BLK,
 	.ops		= &mmc_blk_ops,
 	.probe		= mmc_blk_probe,
+	.priv_auto_alloc_size = sizeof(struct mmc_blk_priv),
 #if CONFIG_IS_ENABLED(MMC_UHS_SUPPORT) || \
     CONFIG_IS_ENABLED(MMC_HS200_SUPPORT) || \
     CONFIG_IS_ENABLED(MMC_HS400_SUPPORT)
@@ -8,6 +8,7 @@
 
 #include <config.h>
 #include <common.h>
+#include <bloblist.h>
 #include <command.h>
 #include <dm.h>
 #include <dm/device-internal.h>
@@ -304,6 +305,32 @@ int mmc_set_blocklen(struct mmc *mmc, int len)
 	return err;
 }
 
+bool mmc_use_set_block_count(struct mmc *mmc)
+{
+	return !mmc_host_is_spi(mmc) &&
+		(mmc->card_caps & mmc->host_caps & MMC_CAP_CMD23);
+}
+
+bool mmc_use_reliable_write(struct mmc *mmc)
+{
+	return IS_ENABLED(CONFIG_MMC_RELIABLE_WRITE) && mmc->ext_csd &&
+		(mmc->ext_csd[EXT_CSD_WR_REL_PARAM] & EXT_CSD_EN_REL_WR);
+}
+
+int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt, bool reliable)
+{
+	struct mmc_cmd cmd;
+
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.resp_type = MMC_RSP_R1;
+	/* eMMC only has a 16-bit block count, with flags in the top bits */
+	cmd.cmdarg = IS_SD(mmc) ? blkcnt : blkcnt & 0xffff;
+	if (reliable && !IS_SD(mmc))
+		cmd.cmdarg |= 1 << 31;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
 #ifdef MMC_SUPPORTS_TUNING
 static const u8 tuning_blk_pattern_4bit[] = {
 	0xff, 0x0f, 0xff, 0x00, 0xff, 0xcc, 0xc3, 0xcc,
@@ -379,6 +406,11 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	bool sbc = blkcnt > 1 && mmc_use_set_block_count(mmc);
+
+	/* With CMD23 the card stops by itself, so no CMD12 is needed */
+	if (sbc && mmc_set_block_count(mmc, blkcnt, false))
+		return 0;
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -400,7 +432,7 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
 
-	if (blkcnt > 1) {
+	if (blkcnt > 1 && !sbc) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -896,6 +928,10 @@ static int mmc_get_capabilities(struct mmc *mmc)
 	if (mmc_host_is_spi(mmc))
 		return 0;
 
+	/* SET_BLOCK_COUNT is mandatory from version 3 of the spec */
+	if (mmc->version >= MMC_VERSION_3)
+		mmc->card_caps |= MMC_CAP_CMD23;
+
 	/* Only version 4 supports high-speed */
 	if (mmc->version < MMC_VERSION_4)
 		return 0;
@@ -1299,6 +1335,8 @@ retry_scr:
 
 	if (mmc->scr[0] & SD_DATA_4BIT)
 		mmc->card_caps |= MMC_MODE_4BIT;
+	if (mmc->scr[0] & SD_CMD23_SUPPORT)
+		mmc->card_caps |= MMC_CAP_CMD23;
 
 	/* Version 1.0 doesn't support switching */
 	if (mmc->version == SD_VERSION_1_0)
@@ -2152,6 +2190,92 @@ error:
 
 	return -ENOTSUPP;
 }
+
+#if CONFIG_IS_ENABLED(MMC_MODE_CACHE)
+/*
+ * Find the entry for this card in the mode cache. If @add is true, a new
+ * entry is set up if there is none, replacing the oldest.
+ */
+static struct mmc_mode_cache_entry *mmc_mode_cache_lookup(struct mmc *mmc,
+							  bool add)
+{
+	struct mmc_mode_cache_entry *entry;
+	struct mmc_mode_cache *cache;
+
+	cache = bloblist_find(BLOBLISTT_MMC_MODE, sizeof(*cache));
+	if (!cache && add) {
+		cache = bloblist_add(BLOBLISTT_MMC_MODE, sizeof(*cache));
+		if (cache)
+			memset(cache, '\0', sizeof(*cache));
+	}
+	if (!cache)
+		return NULL;
+
+	for (entry = cache->entry; entry < cache->entry + MMC_MODE_CACHE_SIZE;
+	     entry++) {
+		if (entry->bus_width &&
+		    !memcmp(entry->cid, mmc->cid, sizeof(mmc->cid)))
+			return entry;
+	}
+	if (!add)
+		return NULL;
+
+	entry = &cache->entry[cache->next++ % MMC_MODE_CACHE_SIZE];
+	memcpy(entry->cid, mmc->cid, sizeof(mmc->cid));
+
+	return entry;
+}
+
+static uint mmc_width_to_cap(uint bus_width)
+{
+	switch (bus_width) {
+	case 8:
+		return MMC_MODE_8BIT;
+	case 4:
+		return MMC_MODE_4BIT;
+	default:
+		return MMC_MODE_1BIT;
+	}
+}
+#endif
+
+/*
+ * Select the bus mode and width using @select. If a mode is cached for this
+ * card, try that alone first, then fall back to trying all of them.
+ */
+static int mmc_select_mode_cached(struct mmc *mmc,
+				  int (*select)(struct mmc *mmc, uint caps))
+{
+#if CONFIG_IS_ENABLED(MMC_MODE_CACHE)
+	struct mmc_mode_cache_entry *entry;
+	uint caps;
+	int err;
+
+	entry = mmc_mode_cache_lookup(mmc, false);
+	if (entry && entry->mode < MMC_MODES_END) {
+		caps = MMC_CAP(entry->mode) | mmc_width_to_cap(entry->bus_width);
+		if ((mmc->card_caps & mmc->host_caps & caps) == caps &&
+		    !select(mmc, caps) && mmc->selected_mode == entry->mode)
+			return 0;
+		pr_debug("cached mode %s not usable\n",
+			 mmc_mode_name(entry->mode));
+	}
+
+	err = select(mmc, mmc->card_caps);
+	if (err)
+		return err;
+
+	entry = mmc_mode_cache_lookup(mmc, true);
+	if (entry) {
+		entry->mode = mmc->selected_mode;
+		entry->bus_width = mmc->bus_width;
+	}
+
+	return 0;
+#else
+	return select(mmc, mmc->card_caps);
+#endif
+}
 #endif
 
 #if CONFIG_IS_ENABLED(MMC_TINY)
@@ -2556,12 +2680,12 @@ static int mmc_startup(struct mmc *mmc)
 		err = sd_get_capabilities(mmc);
 		if (err)
 			return err;
-		err = sd_select_mode_and_width(mmc, mmc->card_caps);
+		err = mmc_select_mode_cached(mmc, sd_select_mode_and_width);
 	} else {
 		err = mmc_get_capabilities(mmc);
 		if (err)
 			return err;
-		mmc_select_mode_and_width(mmc, mmc->card_caps);
+		mmc_select_mode_cached(mmc, mmc_select_mode_and_width);
 	}
 #endif
 	if (err)
@@ -2932,6 +3056,14 @@ int mmc_set_dsr(struct mmc *mmc, u16 val)
 	return 0;
 }
 
+bool mmc_erased_is_zero(struct mmc *mmc)
+{
+	if (IS_SD(mmc))
+		return !(mmc->scr[0] & SD_DATA_STAT_AFTER_ERASE);
+
+	return mmc->ext_csd && !mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT];
+}
+
 /* CPU-specific MMC initializations */
 __weak int cpu_mmc_init(bd_t *bis)
 {
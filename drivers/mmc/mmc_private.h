@@ -16,6 +16,36 @@ int mmc_send_status(struct mmc *mmc, unsigned int *status);
 int mmc_poll_for_busy(struct mmc *mmc, int timeout);
 
 int mmc_set_blocklen(struct mmc *mmc, int len);
+
+/**
+ * mmc_use_set_block_count() - Check whether to use CMD23 for transfers
+ *
+ * If both the host and the card support it, multi-block transfers are
+ * preceded by SET_BLOCK_COUNT (CMD23) and end without STOP_TRANSMISSION.
+ *
+ * @mmc:	MMC device
+ * @return true to use CMD23, false to use CMD12
+ */
+bool mmc_use_set_block_count(struct mmc *mmc);
+
+/**
+ * mmc_use_reliable_write() - Check whether to request reliable writes
+ *
+ * @mmc:	MMC device
+ * @return true if CONFIG_MMC_RELIABLE_WRITE is enabled and the card
+ * supports reliable writes of any size
+ */
+bool mmc_use_reliable_write(struct mmc *mmc);
+
+/**
+ * mmc_set_block_count() - Set the number of blocks in the next transfer
+ *
+ * @mmc:	MMC device
+ * @blkcnt:	Number of blocks in the next read or write
+ * @reliable:	true to request a reliable write (eMMC only)
+ * @return 0 if OK, -ve on error
+ */
+int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt, bool reliable);
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 void mmc_adapter_card_type_ident(void);
 #endif
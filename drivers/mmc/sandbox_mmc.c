@@ -11,20 +11,33 @@
 #include <mmc.h>
 #include <asm/test.h>
 
+/**
+ * struct sandbox_mmc_plat - Emulated SD card
+ *
+ * @cfg:	MMC configuration
+ * @mmc:	MMC device
+ * @block_count: Blocks in the next transfer, set by CMD23 (0 if not set)
+ * @open_ended:	true if a multi-block transfer must be ended by CMD12
+ */
 struct sandbox_mmc_plat {
 	struct mmc_config cfg;
 	struct mmc mmc;
+	uint block_count;
+	bool open_ended;
 };
 
 /**
  * sandbox_mmc_send_cmd() - Emulate SD commands
  *
  * This emulate an SD card version 2. Single-block reads result in zero data.
- * Multiple-block reads return a test string.
+ * Multiple-block reads return a test string. A multiple-block transfer must
+ * either be preceded by CMD23 or followed by CMD12, but not both.
  */
 static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 				struct mmc_data *data)
 {
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
 		memset(cmd->response, '\0', sizeof(cmd->response));
@@ -61,9 +74,19 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		memset(data->dest, '\0', data->blocksize);
 		break;
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
+		if (plat->block_count && plat->block_count != data->blocks)
+			return -EINVAL;
+		plat->open_ended = !plat->block_count;
+		plat->block_count = 0;
 		strcpy(data->dest, "this is a test");
 		break;
+	case MMC_CMD_SET_BLOCK_COUNT:
+		plat->block_count = cmd->cmdarg;
+		break;
 	case MMC_CMD_STOP_TRANSMISSION:
+		if (!plat->open_ended)
+			return -EINVAL;
+		plat->open_ended = false;
 		break;
 	case SD_CMD_APP_SEND_OP_COND:
 		cmd->response[0] = OCR_BUSY | OCR_HCS;
@@ -78,7 +101,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3, with CMD23 */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_CMD23_SUPPORT);
 		break;
 	}
 	default:
@@ -118,7 +142,8 @@ int sandbox_mmc_bind(struct udevice *dev)
 	struct mmc_config *cfg = &plat->cfg;
 
 	cfg->name = dev->name;
-	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
+	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT |
+			 MMC_CAP_CMD23;
 	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
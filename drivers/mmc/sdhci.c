@@ -77,7 +77,8 @@ static void sdhci_adma_desc(struct sdhci_host *host, char *buf, u16 len,
 	struct sdhci_adma_desc *desc;
 	u8 attr;
 
-	desc = &host->adma_desc_table[host->desc_slot];
+	desc = (void *)host->adma_desc_table +
+		host->desc_slot * host->desc_sz;
 
 	attr = ADMA_DESC_ATTR_VALID | ADMA_DESC_TRANSFER_DATA;
 	if (!end)
@@ -90,7 +91,8 @@ static void sdhci_adma_desc(struct sdhci_host *host, char *buf, u16 len,
 	desc->reserved = 0;
 	desc->addr_lo = (dma_addr_t)buf;
 #ifdef CONFIG_DMA_ADDR_T_64BIT
-	desc->addr_hi = (u64)buf >> 32;
+	if (host->flags & USE_ADMA64)
+		desc->addr_hi = (u64)buf >> 32;
 #endif
 }
 
@@ -118,8 +120,7 @@ static void sdhci_prepare_adma_table(struct sdhci_host *host,
 	sdhci_adma_desc(host, buf, trans_bytes, true);
 
 	flush_cache((dma_addr_t)host->adma_desc_table,
-		    ROUND(desc_count * sizeof(struct sdhci_adma_desc),
-			  ARCH_DMA_MINALIGN));
+		    ROUND(desc_count * host->desc_sz, ARCH_DMA_MINALIGN));
 }
 #elif defined(CONFIG_MMC_SDHCI_SDMA)
 static void sdhci_prepare_adma_table(struct sdhci_host *host,
@@ -244,22 +245,46 @@ static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data)
 #define SDHCI_CMD_MAX_TIMEOUT			3200
 #define SDHCI_CMD_DEFAULT_TIMEOUT		100
 #define SDHCI_READ_STATUS_TIMEOUT		1000
+#define SDHCI_DATA_TIMEOUT			10000
 
-#ifdef CONFIG_DM_MMC
-static int sdhci_send_command(struct udevice *dev, struct mmc_cmd *cmd,
-			      struct mmc_data *data)
+/* Clear up after a command, resetting the controller if it failed */
+static int sdhci_end_command(struct sdhci_host *host, struct mmc_data *data,
+			     int ret, int is_aligned)
 {
-	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	unsigned int stat;
 
-#else
-static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
-			      struct mmc_data *data)
+	if (host->quirks & SDHCI_QUIRK_WAIT_SEND_CMD)
+		udelay(1000);
+
+	stat = sdhci_readl(host, SDHCI_INT_STATUS);
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+	if (!ret) {
+		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
+				!is_aligned && (data->flags == MMC_DATA_READ))
+			memcpy(data->dest, aligned_buffer,
+			       data->blocks * data->blocksize);
+		return 0;
+	}
+
+	sdhci_reset(host, SDHCI_RESET_CMD);
+	sdhci_reset(host, SDHCI_RESET_DATA);
+	if (stat & SDHCI_INT_TIMEOUT)
+		return -ETIMEDOUT;
+	else
+		return -ECOMM;
+}
+
+/*
+ * Send a command and wait for its response. Any data transfer is left
+ * running. Returns 0 if OK, 1 if the command should be treated as complete
+ * (there is nothing more to do), -ve on error
+ */
+static int sdhci_issue_command(struct mmc *mmc, struct mmc_cmd *cmd,
+			       struct mmc_data *data, int *is_aligned)
 {
-#endif
 	struct sdhci_host *host = mmc->priv;
 	unsigned int stat = 0;
-	int ret = 0;
-	int trans_bytes = 0, is_aligned = 1;
+	int trans_bytes = 0;
 	u32 mask, flags, mode;
 	unsigned int time = 0;
 	int mmc_dev = mmc_get_blk_desc(mmc)->devnum;
@@ -333,7 +358,7 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 
 		if (host->flags & USE_DMA) {
 			mode |= SDHCI_TRNS_DMA;
-			sdhci_prepare_dma(host, data, &is_aligned, trans_bytes);
+			sdhci_prepare_dma(host, data, is_aligned, trans_bytes);
 		}
 
 		sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG,
@@ -355,7 +380,7 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 
 		if (get_timer(start) >= SDHCI_READ_STATUS_TIMEOUT) {
 			if (host->quirks & SDHCI_QUIRK_BROKEN_R1B) {
-				return 0;
+				return 1;
 			} else {
 				printf("%s: Timeout for status update!\n",
 				       __func__);
@@ -364,34 +389,85 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 		}
 	} while ((stat & mask) != mask);
 
-	if ((stat & (SDHCI_INT_ERROR | mask)) == mask) {
-		sdhci_cmd_done(host, cmd);
-		sdhci_writel(host, mask, SDHCI_INT_STATUS);
-	} else
-		ret = -1;
+	if ((stat & (SDHCI_INT_ERROR | mask)) != mask)
+		return sdhci_end_command(host, data, -1, *is_aligned);
+
+	sdhci_cmd_done(host, cmd);
+	sdhci_writel(host, mask, SDHCI_INT_STATUS);
+
+	return 0;
+}
 
-	if (!ret && data)
+#ifdef CONFIG_DM_MMC
+static int sdhci_send_command(struct udevice *dev, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+#else
+static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
+{
+#endif
+	struct sdhci_host *host = mmc->priv;
+	int is_aligned = 1;
+	int ret;
+
+	ret = sdhci_issue_command(mmc, cmd, data, &is_aligned);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
+	if (data)
 		ret = sdhci_transfer_data(host, data);
 
-	if (host->quirks & SDHCI_QUIRK_WAIT_SEND_CMD)
-		udelay(1000);
+	return sdhci_end_command(host, data, ret, is_aligned);
+}
+
+#if defined(CONFIG_DM_MMC) && CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
+static int sdhci_start_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+			   struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+	int is_aligned = 1;
+	int ret;
+
+	/* Without ADMA the CPU has to move the data */
+	if (!(host->flags & (USE_ADMA | USE_ADMA64)))
+		return -ENOSYS;
+
+	ret = sdhci_issue_command(mmc, cmd, data, &is_aligned);
+	if (ret > 0)
+		return -ETIMEDOUT;
+	host->data_start = get_timer(0);
+
+	return ret;
+}
+
+static int sdhci_poll_cmd(struct udevice *dev, struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+	unsigned int stat;
+	int ret;
 
 	stat = sdhci_readl(host, SDHCI_INT_STATUS);
-	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
-	if (!ret) {
-		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
-				!is_aligned && (data->flags == MMC_DATA_READ))
-			memcpy(data->dest, aligned_buffer, trans_bytes);
-		return 0;
+	if (stat & SDHCI_INT_ERROR) {
+		pr_debug("%s: Error detected in status(0x%X)!\n", __func__,
+			 stat);
+		ret = -EIO;
+	} else if (stat & SDHCI_INT_DATA_END) {
+		ret = 0;
+	} else if (get_timer(host->data_start) < SDHCI_DATA_TIMEOUT) {
+		return -EBUSY;
+	} else {
+		printf("%s: Transfer data timeout\n", __func__);
+		ret = -ETIMEDOUT;
 	}
 
-	sdhci_reset(host, SDHCI_RESET_CMD);
-	sdhci_reset(host, SDHCI_RESET_DATA);
-	if (stat & SDHCI_INT_TIMEOUT)
-		return -ETIMEDOUT;
-	else
-		return -ECOMM;
+	return sdhci_end_command(host, data, ret, 1);
 }
+#endif
 
 #if defined(CONFIG_DM_MMC) && defined(MMC_SUPPORTS_TUNING)
 static int sdhci_execute_tuning(struct udevice *dev, uint opcode)
@@ -698,6 +774,10 @@ const struct dm_mmc_ops sdhci_ops = {
 #ifdef MMC_SUPPORTS_TUNING
 	.execute_tuning	= sdhci_execute_tuning,
 #endif
+#if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
+	.start_cmd	= sdhci_start_cmd,
+	.poll_cmd	= sdhci_poll_cmd,
+#endif
 };
 #else
 static const struct mmc_ops sdhci_ops = {
@@ -737,19 +817,30 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 #endif
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	if (!(caps & SDHCI_CAN_DO_ADMA2)) {
-		printf("%s: Your controller doesn't support SDMA!!\n",
+		printf("%s: Your controller doesn't support ADMA!!\n",
 		       __func__);
 		return -EINVAL;
 	}
-	host->adma_desc_table = (struct sdhci_adma_desc *)
-				memalign(ARCH_DMA_MINALIGN, ADMA_TABLE_SZ);
-
-	host->adma_addr = (dma_addr_t)host->adma_desc_table;
 #ifdef CONFIG_DMA_ADDR_T_64BIT
-	host->flags |= USE_ADMA64;
+	/* Without 64-bit descriptors, buffers must be below 4GB */
+	if (caps & SDHCI_CAN_64BIT)
+		host->flags |= USE_ADMA64;
+	else
+		host->flags |= USE_ADMA;
 #else
 	host->flags |= USE_ADMA;
 #endif
+	host->desc_sz = host->flags & USE_ADMA64 ? ADMA64_DESC_LEN :
+		ADMA_DESC_LEN;
+
+	/* Allow for the largest transfer the controller can do */
+	host->desc_count = DIV_ROUND_UP(ADMA_MAX_BLK_COUNT * MMC_MAX_BLOCK_LEN,
+					ADMA_MAX_LEN);
+	host->adma_desc_table = memalign(ARCH_DMA_MINALIGN,
+					 host->desc_count * host->desc_sz);
+	if (!host->adma_desc_table)
+		return -ENOMEM;
+	host->adma_addr = (dma_addr_t)host->adma_desc_table;
 #endif
 	if (host->quirks & SDHCI_QUIRK_REG32_RW)
 		host->version =
@@ -815,7 +906,8 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	if (host->quirks & SDHCI_QUIRK_BROKEN_VOLTAGE)
 		cfg->voltages |= host->voltages;
 
-	cfg->host_caps |= MMC_MODE_HS | MMC_MODE_HS_52MHz | MMC_MODE_4BIT;
+	cfg->host_caps |= MMC_MODE_HS | MMC_MODE_HS_52MHz | MMC_MODE_4BIT |
+			  MMC_CAP_CMD23;
 
 	/* Since Host Controller Version3.0 */
 	if (SDHCI_GET_VERSION(host) >= SDHCI_SPEC_300) {
@@ -854,7 +946,12 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	if (host->host_caps)
 		cfg->host_caps |= host->host_caps;
 
+#if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
+	/* The descriptor table is sized for this */
+	cfg->b_max = ADMA_MAX_BLK_COUNT;
+#else
 	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
+#endif
 
 	return 0;
 }
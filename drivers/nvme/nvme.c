@@ -14,13 +14,12 @@
 #include <dm/device-internal.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		32
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
 
 enum nvme_queue_id {
 	NVME_ADMIN_Q,
@@ -67,16 +66,19 @@ static int nvme_wait_ready(struct nvme_dev *dev, bool enabled)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
+/*
+ * Set up PRP entries for a transfer, using @prp_list (which holds
+ * dev->prp_entry_num entries) if more than two pages are involved
+ */
+static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp_list, u64 *prp2,
 			   int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
+	u64 *prp_pool = prp_list;
 	int length = total_len;
 	int i, nprps;
 	u32 prps_per_page = (page_size >> 3) - 1;
-	u32 num_pages;
 
 	length -= (page_size - offset);
 
@@ -94,39 +96,28 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 	}
 
 	nprps = DIV_ROUND_UP(length, page_size);
-	num_pages = DIV_ROUND_UP(nprps, prps_per_page);
+	if (nprps > dev->prp_entry_num)
+		return -E2BIG;
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		/*
-		 * Always increase in increments of pages.  It doesn't waste
-		 * much memory and reduces the number of allocations.
-		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = prps_per_page * num_pages;
-	}
-
-	prp_pool = dev->prp_pool;
 	i = 0;
 	while (nprps) {
-		if (i == ((page_size >> 3) - 1)) {
+		/*
+		 * The last entry of a full list page points to the next
+		 * page, unless it is the last data entry itself
+		 */
+		if (i == prps_per_page && nprps > 1) {
 			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
 					page_size);
 			i = 0;
-			prp_pool += page_size;
+			prp_pool += page_size >> 3;
 		}
 		*(prp_pool + i++) = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)prp_list;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
-			   dev->prp_entry_num * sizeof(u64));
+	flush_dcache_range((ulong)prp_list, (ulong)(prp_pool + i));
 
 	return 0;
 }
@@ -149,12 +140,14 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 }
 
 /**
- * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ * nvme_queue_cmd() - copy a command into a queue
+ *
+ * The controller does not see it until nvme_ring_sq() is called.
  *
  * @nvmeq:	The queue to use
  * @cmd:	The command to send
  */
-static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+static void nvme_queue_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 {
 	u16 tail = nvmeq->sq_tail;
 
@@ -164,16 +157,80 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 
 	if (++tail == nvmeq->q_depth)
 		tail = 0;
-	writel(tail, nvmeq->q_db);
 	nvmeq->sq_tail = tail;
 }
 
+/* Tell the controller about commands added by nvme_queue_cmd() */
+static void nvme_ring_sq(struct nvme_queue *nvmeq)
+{
+	writel(nvmeq->sq_tail, nvmeq->q_db);
+}
+
+/**
+ * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send
+ */
+static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	nvme_queue_cmd(nvmeq, cmd);
+	nvme_ring_sq(nvmeq);
+}
+
+/**
+ * nvme_poll_cq() - check for a completion on a queue
+ *
+ * If there is one, this consumes it. Use nvme_ring_cq() to tell the
+ * controller.
+ *
+ * @nvmeq:	The queue to check
+ * @status:	Returns the status of the completed command (0 if OK)
+ * @result:	Returns the result of the completed command, if not NULL
+ * @cmdid:	Returns the ID of the completed command, if not NULL
+ * @return true if a command completed, false if not
+ */
+static bool nvme_poll_cq(struct nvme_queue *nvmeq, u16 *status, u32 *result,
+			 u16 *cmdid)
+{
+	u16 head = nvmeq->cq_head;
+	u16 phase = nvmeq->cq_phase;
+	u16 stat;
+
+	stat = nvme_read_completion_status(nvmeq, head);
+	if ((stat & 0x01) != phase)
+		return false;
+
+	stat >>= 1;
+	if (stat)
+		printf("ERROR: status = %x, phase = %d, head = %d\n",
+		       stat, phase, head);
+	else if (result)
+		*result = le32_to_cpu(readl(&(nvmeq->cqes[head].result)));
+	if (cmdid)
+		*cmdid = le16_to_cpu(readw(&nvmeq->cqes[head].command_id));
+
+	if (++head == nvmeq->q_depth) {
+		head = 0;
+		phase = !phase;
+	}
+	nvmeq->cq_head = head;
+	nvmeq->cq_phase = phase;
+	*status = stat;
+
+	return true;
+}
+
+/* Tell the controller about completions consumed by nvme_poll_cq() */
+static void nvme_ring_cq(struct nvme_queue *nvmeq)
+{
+	writel(nvmeq->cq_head, nvmeq->q_db + nvmeq->dev->db_stride);
+}
+
 static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 				struct nvme_command *cmd,
 				u32 *result, unsigned timeout)
 {
-	u16 head = nvmeq->cq_head;
-	u16 phase = nvmeq->cq_phase;
 	u16 status;
 	ulong start_time;
 	ulong timeout_us = timeout * 100000;
@@ -183,43 +240,14 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 
 	start_time = timer_get_us();
 
-	for (;;) {
-		status = nvme_read_completion_status(nvmeq, head);
-		if ((status & 0x01) == phase)
-			break;
+	while (!nvme_poll_cq(nvmeq, &status, result, NULL)) {
 		if (timeout_us > 0 && (timer_get_us() - start_time)
 		    >= timeout_us)
 			return -ETIMEDOUT;
 	}
+	nvme_ring_cq(nvmeq);
 
-	status >>= 1;
-	if (status) {
-		printf("ERROR: status = %x, phase = %d, head = %d\n",
-		       status, phase, head);
-		status = 0;
-		if (++head == nvmeq->q_depth) {
-			head = 0;
-			phase = !phase;
-		}
-		writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
-		nvmeq->cq_head = head;
-		nvmeq->cq_phase = phase;
-
-		return -EIO;
-	}
-
-	if (result)
-		*result = le32_to_cpu(readl(&(nvmeq->cqes[head].result)));
-
-	if (++head == nvmeq->q_depth) {
-		head = 0;
-		phase = !phase;
-	}
-	writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
-	nvmeq->cq_head = head;
-	nvmeq->cq_phase = phase;
-
-	return status;
+	return status ? -EIO : 0;
 }
 
 static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
@@ -706,64 +734,284 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
-static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
-			 lbaint_t blkcnt, void *buffer, bool read)
+/* Find where the next command for a request starts */
+static void *nvme_req_pos(struct blk_req *req, lbaint_t pos, int lba_shift,
+			  lbaint_t *leftp)
 {
-	struct nvme_ns *ns = dev_get_priv(udev);
-	struct nvme_dev *dev = ns->dev;
+	struct blk_sg *sg = req->sg;
+
+	while (pos >= sg->blkcnt) {
+		pos -= sg->blkcnt;
+		sg++;
+	}
+	*leftp = sg->blkcnt - pos;
+
+	return sg->buf + (pos << lba_shift);
+}
+
+/*
+ * Put the next command for a request into the I/O queue, without ringing
+ * the doorbell
+ */
+static int nvme_io_issue(struct nvme_dev *dev, struct nvme_io_req *ioreq,
+			 struct nvme_io_cmd *iocmd)
+{
+	struct blk_req *req = ioreq->req;
+	struct nvme_ns *ns = dev_get_priv(req->dev);
 	struct nvme_command c;
-	struct blk_desc *desc = dev_get_uclass_platdata(udev);
-	int status;
+	lbaint_t left;
+	void *buf;
 	u64 prp2;
-	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
-
-	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
+	u16 lbas;
+	int ret;
 
-	flush_dcache_range((unsigned long)buffer,
-			   (unsigned long)buffer + total_len);
+	buf = nvme_req_pos(req, ioreq->issued, ns->lba_shift, &left);
+	lbas = min_t(lbaint_t, left,
+		     1 << (dev->max_transfer_shift - ns->lba_shift));
+	ret = nvme_setup_prps(dev, iocmd->prp_list, &prp2,
+			      lbas << ns->lba_shift, (ulong)buf);
+	if (ret)
+		return ret;
+	flush_dcache_range((ulong)buf, (ulong)buf + (lbas << ns->lba_shift));
 
-	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
+	memset(&c, '\0', sizeof(c));
+	c.rw.opcode = req->op == BLK_REQ_READ ? nvme_cmd_read : nvme_cmd_write;
+	c.rw.command_id = cpu_to_le16(iocmd - dev->io_cmds);
 	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
+	c.rw.slba = cpu_to_le64(req->start + ioreq->issued);
+	c.rw.length = cpu_to_le16(lbas - 1);
+	c.rw.prp1 = cpu_to_le64((ulong)buf);
+	c.rw.prp2 = cpu_to_le64(prp2);
+	nvme_queue_cmd(dev->queues[NVME_IO_Q], &c);
+
+	iocmd->ioreq = ioreq;
+	iocmd->buf = buf;
+	iocmd->lbas = lbas;
+	iocmd->start = timer_get_us();
+	ioreq->issued += lbas;
+	ioreq->cmds++;
+	dev->io_busy++;
+
+	return 0;
+}
+
+/*
+ * Move the request to the @done list if nothing more is to be done for it.
+ * Its completion callback may submit more requests, so it is only called
+ * by nvme_io_finish() once the driver has finished with its own lists.
+ */
+static void nvme_io_check_done(struct nvme_io_req *ioreq,
+			       struct list_head *done)
+{
+	struct blk_req *req = ioreq->req;
+
+	if (ioreq->cmds || (!ioreq->ret && ioreq->issued < ioreq->total))
+		return;
+	list_move_tail(&req->node, done);
+}
+
+/* Report each request in the list as finished */
+static void nvme_io_finish(struct list_head *done)
+{
+	struct nvme_io_req *ioreq;
+	struct blk_req *req;
+
+	while (!list_empty(done)) {
+		req = list_first_entry(done, struct blk_req, node);
+		ioreq = (struct nvme_io_req *)req->drv_data;
+		list_del(&req->node);
+		ioreq->req = NULL;
+		blk_req_done(req, ioreq->ret, ioreq->done);
+	}
+}
+
+/*
+ * Fill the I/O queue with commands for the waiting requests, oldest first,
+ * then ring the doorbell once for them all
+ */
+static void nvme_io_start(struct nvme_dev *dev, struct list_head *done)
+{
+	struct nvme_io_req *ioreq;
+	struct blk_req *req, *next;
+	bool issued = false;
+	int slot = 0;
+	int ret;
+
+	list_for_each_entry_safe(req, next, &dev->async_reqs, node) {
+		ioreq = (struct nvme_io_req *)req->drv_data;
+		while (!ioreq->ret && ioreq->issued < ioreq->total) {
+			if (dev->io_busy < dev->io_cmd_count) {
+				while (dev->io_cmds[slot].ioreq ||
+				       dev->io_cmds[slot].aborted)
+					slot++;
+				ret = nvme_io_issue(dev, ioreq,
+						    &dev->io_cmds[slot]);
+			} else if (dev->io_aborted < dev->io_busy) {
+				goto out;
+			} else {
+				/* No slot comes back until a command does */
+				ret = -EIO;
+			}
+			if (ret) {
+				ioreq->ret = ret;
+				nvme_io_check_done(ioreq, done);
+				break;
+			}
+			issued = true;
 		}
+	}
+out:
+	if (issued)
+		nvme_ring_sq(dev->queues[NVME_IO_Q]);
+}
+
+static int nvme_blk_submit(struct udevice *udev, struct blk_req *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct nvme_io_req *ioreq;
+	LIST_HEAD(done);
+	int i;
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, (ulong)buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64((ulong)buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
+	/* The I/O queue is shared by all namespaces, so queue here */
+	for (i = 0, ioreq = dev->io_reqs; i < NVME_MAX_REQS; i++, ioreq++) {
+		if (!ioreq->req)
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		buffer += lbas << ns->lba_shift;
 	}
+	if (i == NVME_MAX_REQS)
+		return -EBUSY;
+
+	memset(ioreq, '\0', sizeof(*ioreq));
+	ioreq->req = req;
+	ioreq->total = blk_req_blkcnt(req);
+	req->drv_data = (ulong)ioreq;
+	list_add_tail(&req->node, &dev->async_reqs);
+	nvme_io_start(dev, &done);
+	nvme_io_finish(&done);
+
+	return 0;
+}
+
+/* Complete a command, invalidating the cache for any data read */
+static void nvme_io_complete(struct nvme_dev *dev, struct nvme_io_cmd *iocmd,
+			     int ret, struct list_head *done)
+{
+	struct nvme_io_req *ioreq = iocmd->ioreq;
+	struct blk_req *req = ioreq->req;
+	struct nvme_ns *ns = dev_get_priv(req->dev);
+
+	iocmd->ioreq = NULL;
+	dev->io_busy--;
+	ioreq->cmds--;
+	if (ret) {
+		if (!ioreq->ret)
+			ioreq->ret = ret;
+	} else {
+		if (req->op == BLK_REQ_READ)
+			invalidate_dcache_range((ulong)iocmd->buf,
+						(ulong)iocmd->buf +
+						(iocmd->lbas << ns->lba_shift));
+		/* Only count blocks up to the first failure */
+		if (!ioreq->ret)
+			ioreq->done += iocmd->lbas;
+	}
+	nvme_io_check_done(ioreq, done);
+}
+
+/*
+ * Fail a command which has not completed in time. The controller may still
+ * use its command ID and PRP list, so ask it to abort the command and keep
+ * the slot until the command completes.
+ */
+static void nvme_io_timeout(struct nvme_dev *dev, struct nvme_io_cmd *iocmd,
+			    struct list_head *done)
+{
+	struct nvme_io_req *ioreq = iocmd->ioreq;
+	struct nvme_command c;
+
+	memset(&c, '\0', sizeof(c));
+	c.abort.opcode = nvme_admin_abort_cmd;
+	c.abort.sqid = cpu_to_le16(NVME_IO_Q);
+	c.abort.cid = cpu_to_le16(iocmd - dev->io_cmds);
+	if (nvme_submit_admin_cmd(dev, &c, NULL))
+		printf("Error: cannot abort command %d\n",
+		       (int)(iocmd - dev->io_cmds));
+
+	iocmd->ioreq = NULL;
+	iocmd->aborted = true;
+	dev->io_aborted++;
+	ioreq->cmds--;
+	if (!ioreq->ret)
+		ioreq->ret = -ETIMEDOUT;
+	nvme_io_check_done(ioreq, done);
+}
+
+static int nvme_blk_poll(struct udevice *udev)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct nvme_io_cmd *iocmd;
+	bool found = false;
+	u16 status, cmdid;
+	LIST_HEAD(done);
+	int i;
+
+	while (nvme_poll_cq(nvmeq, &status, NULL, &cmdid)) {
+		found = true;
+		iocmd = cmdid < dev->io_cmd_count ? &dev->io_cmds[cmdid] : NULL;
+		if (iocmd && iocmd->aborted) {
+			/* Its request has already failed */
+			iocmd->aborted = false;
+			dev->io_aborted--;
+			dev->io_busy--;
+			continue;
+		}
+		if (!iocmd || !iocmd->ioreq) {
+			printf("Error: unexpected completion, id %d\n", cmdid);
+			continue;
+		}
+		nvme_io_complete(dev, iocmd, status ? -EIO : 0, &done);
+	}
+	if (found) {
+		nvme_ring_cq(nvmeq);
+	} else {
+		for (i = 0, iocmd = dev->io_cmds; i < dev->io_cmd_count;
+		     i++, iocmd++) {
+			if (iocmd->ioreq && timer_get_us() - iocmd->start >=
+			    IO_TIMEOUT * 100000)
+				nvme_io_timeout(dev, iocmd, &done);
+		}
+	}
+	nvme_io_start(dev, &done);
+	nvme_io_finish(&done);
 
-	if (read)
-		invalidate_dcache_range((unsigned long)buffer,
-					(unsigned long)buffer + total_len);
+	return 0;
+}
+
+static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
+			 lbaint_t blkcnt, void *buffer, bool read)
+{
+	struct blk_sg sg = {
+		.buf = buffer,
+		.blkcnt = blkcnt,
+	};
+	struct blk_req req = {
+		.op = read ? BLK_REQ_READ : BLK_REQ_WRITE,
+		.start = blknr,
+		.sg = &sg,
+		.sg_count = 1,
+	};
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	/*
+	 * Go through the asynchronous path so that the whole transfer can
+	 * be in the I/O queue at once
+	 */
+	if (!blkcnt || blk_submit(udev, &req))
+		return 0;
+	blk_wait(udev, &req);
+
+	return req.done;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -781,6 +1029,8 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 static const struct blk_ops nvme_blk_ops = {
 	.read	= nvme_blk_read,
 	.write	= nvme_blk_write,
+	.submit	= nvme_blk_submit,
+	.poll	= nvme_blk_poll,
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
@@ -791,6 +1041,37 @@ U_BOOT_DRIVER(nvme_blk) = {
 	.priv_auto_alloc_size = sizeof(struct nvme_ns),
 };
 
+/*
+ * Set up a slot for each command which can be in the I/O queue, with a PRP
+ * list from the pool big enough for the largest transfer
+ */
+static int nvme_alloc_io_cmds(struct nvme_dev *dev)
+{
+	u32 prps_per_page = (dev->page_size >> 3) - 1;
+	u32 pages;
+	int i;
+
+	dev->io_cmd_count = dev->queues[NVME_IO_Q]->q_depth - 1;
+	dev->io_cmds = calloc(dev->io_cmd_count, sizeof(struct nvme_io_cmd));
+	if (!dev->io_cmds)
+		return -ENOMEM;
+
+	dev->prp_entry_num = DIV_ROUND_UP(1 << dev->max_transfer_shift,
+					  dev->page_size);
+	pages = DIV_ROUND_UP(dev->prp_entry_num, prps_per_page);
+	dev->prp_pool = memalign(dev->page_size,
+				 dev->io_cmd_count * pages * dev->page_size);
+	if (!dev->prp_pool) {
+		free(dev->io_cmds);
+		return -ENOMEM;
+	}
+	for (i = 0; i < dev->io_cmd_count; i++)
+		dev->io_cmds[i].prp_list = dev->prp_pool +
+			i * pages * (dev->page_size >> 3);
+
+	return 0;
+}
+
 static int nvme_bind(struct udevice *udev)
 {
 	static int ndev_num;
@@ -809,6 +1090,7 @@ static int nvme_probe(struct udevice *udev)
 	ndev->instance = trailing_strtol(udev->name);
 
 	INIT_LIST_HEAD(&ndev->namespaces);
+	INIT_LIST_HEAD(&ndev->async_reqs);
 	ndev->bar = dm_pci_map_bar(udev, PCI_BASE_ADDRESS_0,
 			PCI_REGION_MEM);
 	if (readl(&ndev->bar->csts) == -1) {
@@ -834,21 +1116,19 @@ static int nvme_probe(struct udevice *udev)
 	if (ret)
 		goto free_queue;
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ret = nvme_setup_io_queues(ndev);
 	if (ret)
 		goto free_queue;
 
 	nvme_get_info_from_identify(ndev);
 
+	/* Allocate after the page size and maximum transfer size are known */
+	ret = nvme_alloc_io_cmds(ndev);
+	if (ret) {
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	return 0;
 
 free_queue:
@@ -602,6 +602,29 @@ enum {
 	NVME_CSTS_SHST_MASK	= 3 << 2,
 };
 
+/* Most asynchronous requests which the driver works on at once */
+#define NVME_MAX_REQS	16
+
+/* Progress of an asynchronous request */
+struct nvme_io_req {
+	struct blk_req *req;	/* the request, or NULL if this is free */
+	lbaint_t total;		/* number of blocks in the request */
+	lbaint_t issued;	/* number covered by commands issued so far */
+	lbaint_t done;		/* number transferred so far */
+	int cmds;		/* number of its commands in the I/O queue */
+	int ret;		/* first error, if any */
+};
+
+/* A read or write command in the I/O queue; its index is the command ID */
+struct nvme_io_cmd {
+	struct nvme_io_req *ioreq;	/* request, or NULL if this is free */
+	void *buf;		/* data buffer */
+	u16 lbas;		/* number of blocks */
+	ulong start;		/* time the command was issued (us) */
+	u64 *prp_list;		/* PRP list for this command, from the pool */
+	bool aborted;		/* timed out, maybe still in use */
+};
+
 /* Represents an NVM Express device. Each nvme_dev is a PCI function. */
 struct nvme_dev {
 	struct list_head node;
@@ -624,9 +647,16 @@ struct nvme_dev {
 	u32 stripe_size;
 	u32 page_size;
 	u8 vwc;
-	u64 *prp_pool;
-	u32 prp_entry_num;
+	u64 *prp_pool;		/* PRP lists for all entries in io_cmds */
+	u32 prp_entry_num;	/* number of entries in each PRP list */
 	u32 nn;
+	/* Asynchronous requests for all namespaces, oldest first */
+	struct list_head async_reqs;
+	struct nvme_io_req io_reqs[NVME_MAX_REQS];
+	struct nvme_io_cmd *io_cmds;
+	int io_cmd_count;	/* most commands in the I/O queue at once */
+	int io_busy;		/* number of commands in the I/O queue */
+	int io_aborted;		/* number of those which timed out */
 };
 
 /*
@@ -29,6 +29,9 @@
 #define MAX_DEVICE			16
 #define MAX_ENDPOINT			16
 
+/* Time for the host port to settle after it is reset */
+#define DWC2_HOST_SETTLE_MS		1000
+
 struct dwc2_priv {
 #if CONFIG_IS_ENABLED(DM_USB)
 	uint8_t aligned_buffer[DWC2_DATA_BUF_SIZE] __aligned(ARCH_DMA_MINALIGN);
@@ -36,6 +39,9 @@ struct dwc2_priv {
 #ifdef CONFIG_DM_REGULATOR
 	struct udevice *vbus_supply;
 #endif
+	/* The host port is settling after reset, since settle_start */
+	bool settling;
+	ulong settle_start;
 #else
 	uint8_t *aligned_buffer;
 	uint8_t *status_buffer;
@@ -1209,8 +1215,15 @@ static int dwc2_init_common(struct udevice *dev, struct dwc2_priv *priv)
 	 * is started (the bus is scanned) and  fixes the USB detection
 	 * problems with some problematic USB keys.
 	 */
-	if (readl(&regs->gintsts) & DWC2_GINTSTS_CURMODE_HOST)
-		mdelay(1000);
+	if (readl(&regs->gintsts) & DWC2_GINTSTS_CURMODE_HOST) {
+#if CONFIG_IS_ENABLED(DM_USB)
+		/* dwc2_usb_probe() waits, letting other devices probe */
+		priv->settling = true;
+		priv->settle_start = get_timer(0);
+#else
+		mdelay(DWC2_HOST_SETTLE_MS);
+#endif
+	}
 
 	return 0;
 }
@@ -1325,10 +1338,23 @@ static int dwc2_usb_probe(struct udevice *dev)
 {
 	struct dwc2_priv *priv = dev_get_priv(dev);
 	struct usb_bus_priv *bus_priv = dev_get_uclass_priv(dev);
+	int ret;
 
-	bus_priv->desc_before_addr = true;
+	/* After the first call, we are only waiting for the port to settle */
+	if (!priv->settling) {
+		bus_priv->desc_before_addr = true;
 
-	return dwc2_init_common(dev, priv);
+		ret = dwc2_init_common(dev, priv);
+		if (ret)
+			return ret;
+	}
+
+	if (priv->settling &&
+	    get_timer(priv->settle_start) < DWC2_HOST_SETTLE_MS)
+		return -EAGAIN;
+	priv->settling = false;
+
+	return 0;
 }
 
 static int dwc2_usb_remove(struct udevice *dev)
@@ -1369,6 +1395,6 @@ U_BOOT_DRIVER(usb_dwc2) = {
 	.remove = dwc2_usb_remove,
 	.ops	= &dwc2_usb_ops,
 	.priv_auto_alloc_size = sizeof(struct dwc2_priv),
-	.flags	= DM_FLAG_ALLOC_PRIV_DMA,
+	.flags	= DM_FLAG_ALLOC_PRIV_DMA | DM_FLAG_PROBE_ASYNC,
 };
 #endif
@@ -236,6 +236,28 @@ static void remove_inactive_children(struct uclass *uc, struct udevice *bus)
 	}
 }
 
+int usb_probe_async(void)
+{
+	struct udevice *bus;
+	struct uclass *uc;
+	int ret;
+
+	ret = uclass_get(UCLASS_USB, &uc);
+	if (ret)
+		return ret;
+
+	/*
+	 * Errors are reported when usb_init() probes the controller again,
+	 * so carry on with the others
+	 */
+	uclass_foreach_dev(bus, uc) {
+		if (bus->driver->flags & DM_FLAG_PROBE_ASYNC)
+			device_probe_async(bus);
+	}
+
+	return 0;
+}
+
 int usb_init(void)
 {
 	int controllers_initialized = 0;
@@ -253,6 +275,9 @@ int usb_init(void)
 
 	uc_priv = uc->priv;
 
+	/* Let slow controllers wait for their hardware at the same time */
+	usb_probe_async();
+
 	uclass_foreach_dev(bus, uc) {
 		/* init low_level USB */
 		printf("Bus %s: ", bus->name);
@@ -271,6 +296,7 @@ int usb_init(void)
 		}
 #endif
 
+		/* This waits for a controller started by usb_probe_async() */
 		ret = device_probe(bus);
 		if (ret == -ENODEV) {	/* No such device. */
 			puts("Port not available.\n");
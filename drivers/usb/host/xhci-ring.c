@@ -576,6 +576,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	int ret;
 	u32 trb_fields[4];
 	u64 val_64 = (uintptr_t)buffer;
+	bool v1_0;
 
 	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
 		udev, pipe, buffer, length);
@@ -636,6 +637,9 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 
 	total_packet_count = DIV_ROUND_UP(length, maxpacketsize);
 
+	/* Read the version once rather than for every TRB */
+	v1_0 = HC_VERSION(xhci_readl(&ctrl->hccr->cr_capbase)) >= 0x100;
+
 	/* How much data is in the first TRB? */
 	/*
 	 * How much data is (potentially) left before the 64KB boundary?
@@ -680,7 +684,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 			field |= TRB_ISP;
 
 		/* Set the TRB length, TD size, and interrupter fields. */
-		if (HC_VERSION(xhci_readl(&ctrl->hccr->cr_capbase)) < 0x100)
+		if (!v1_0)
 			remainder = xhci_td_remainder(length - running_total);
 		else
 			remainder = xhci_v1_0_td_remainder(running_total,
@@ -19,6 +19,7 @@
 #include <dm.h>
 #include <virtio_types.h>
 #include <virtio.h>
+#include <virtio_ring.h>
 #include <dm/lists.h>
 
 static const char *const virtio_drv_name[VIRTIO_ID_MAX_NUM] = {
@@ -329,10 +330,15 @@ static int virtio_uclass_child_pre_probe(struct udevice *vdev)
 		uc_priv->features = driver_features & device_features;
 	}
 
-	/* Transport features always preserved to pass to finalize_features */
+	/*
+	 * Transport features always preserved to pass to finalize_features,
+	 * along with the ring features that virtio_ring.c supports
+	 */
 	for (i = VIRTIO_TRANSPORT_F_START; i < VIRTIO_TRANSPORT_F_END; i++)
 		if ((device_features & (1ULL << i)) &&
-		    (i == VIRTIO_F_VERSION_1))
+		    (i == VIRTIO_F_VERSION_1 ||
+		     i == VIRTIO_RING_F_INDIRECT_DESC ||
+		     i == VIRTIO_RING_F_EVENT_IDX))
 			__virtio_set_bit(vdev->parent, i);
 
 	debug("(%s) final negotiated features supported %016llx\n",
@@ -10,64 +10,297 @@
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
+#include <linux/sizes.h>
 #include "virtio_blk.h"
 
+/* Most asynchronous requests which the driver works on at once */
+#define VIRTIO_BLK_MAX_REQS	16
+/* Most virtio-blk requests in the virtqueue at once */
+#define VIRTIO_BLK_MAX_CMDS	32
+/*
+ * Most bytes in one virtio-blk request. Larger transfers are split so that
+ * the device can work on the pieces in parallel.
+ */
+#define VIRTIO_BLK_MAX_XFER	SZ_1M
+/* Segments per request if the device does not say */
+#define VIRTIO_BLK_DEF_SEGS	16
+/* Most segments the driver puts in one request */
+#define VIRTIO_BLK_MAX_SEGS	128
+
+/**
+ * struct virtio_blk_io - progress of an asynchronous block request
+ *
+ * @req:	Block request, or NULL if this is free
+ * @total:	Number of blocks in the request
+ * @issued:	Number covered by virtio-blk requests issued so far
+ * @done:	Number transferred so far
+ * @cmds:	Number of its virtio-blk requests in the virtqueue
+ * @ret:	First error, if any
+ */
+struct virtio_blk_io {
+	struct blk_req *req;
+	lbaint_t total;
+	lbaint_t issued;
+	lbaint_t done;
+	int cmds;
+	int ret;
+};
+
+/**
+ * struct virtio_blk_cmd - a virtio-blk request in the virtqueue
+ *
+ * @out_hdr:	Request header. Its address identifies the request when
+ *		the device has finished with it.
+ * @status:	Status written by the device
+ * @io:		Block request this is part of, or NULL if this is free
+ * @blkcnt:	Number of blocks transferred by this request
+ */
+struct virtio_blk_cmd {
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+	struct virtio_blk_io *io;
+	lbaint_t blkcnt;
+};
+
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	struct list_head reqs;		/* requests not yet finished */
+	struct virtio_blk_io io[VIRTIO_BLK_MAX_REQS];
+	struct virtio_blk_cmd cmds[VIRTIO_BLK_MAX_CMDS];
+	int busy;			/* number of cmds in use */
+	uint max_segs;			/* most data segments per request */
+	ulong max_seg_size;		/* most bytes per segment */
+	/* Space to build a request, with its header and status */
+	struct virtio_sg sg[VIRTIO_BLK_MAX_SEGS + 2];
+	struct virtio_sg *sgs[VIRTIO_BLK_MAX_SEGS + 2];
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+/*
+ * Put the next virtio-blk request for a block request in the virtqueue,
+ * without kicking. Returns -ENOSPC if the virtqueue is full.
+ */
+static int virtio_blk_issue(struct udevice *dev, struct virtio_blk_io *io,
+			    struct virtio_blk_cmd *cmd)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
+	struct blk_req *req = io->req;
+	bool write = req->op == BLK_REQ_WRITE;
+	struct blk_sg *bsg = req->sg;
+	lbaint_t pos = io->issued;
+	ulong bytes = 0, len;
+	uint num = 1, i;
 	int ret;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
-
-	sgs[num_out++] = &hdr_sg;
+	while (pos >= bsg->blkcnt) {
+		pos -= bsg->blkcnt;
+		bsg++;
+	}
 
-	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
-	else
-		sgs[num_out + num_in++] = &data_sg;
-
-	sgs[num_out + num_in++] = &status_sg;
+	/* Use as many segments as allowed, within the transfer limit */
+	priv->sg[0].addr = &cmd->out_hdr;
+	priv->sg[0].length = sizeof(cmd->out_hdr);
+	while (num <= priv->max_segs && bytes < VIRTIO_BLK_MAX_XFER &&
+	       io->issued + bytes / 512 < io->total) {
+		len = min3((ulong)(bsg->blkcnt - pos) * 512, priv->max_seg_size,
+			   VIRTIO_BLK_MAX_XFER - bytes);
+		priv->sg[num].addr = bsg->buf + pos * 512;
+		priv->sg[num].length = len;
+		num++;
+		bytes += len;
+		pos += len / 512;
+		if (pos == bsg->blkcnt) {
+			pos = 0;
+			bsg++;
+		}
+	}
+	priv->sg[num].addr = &cmd->status;
+	priv->sg[num].length = sizeof(cmd->status);
+	num++;
+	for (i = 0; i < num; i++)
+		priv->sgs[i] = &priv->sg[i];
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
+	cmd->out_hdr.type = cpu_to_virtio32(dev, write ? VIRTIO_BLK_T_OUT :
+					    VIRTIO_BLK_T_IN);
+	cmd->out_hdr.ioprio = 0;
+	cmd->out_hdr.sector = cpu_to_virtio64(dev, req->start + io->issued);
+	ret = virtqueue_add(priv->vq, priv->sgs, write ? num - 1 : 1,
+			    write ? 1 : num - 1);
 	if (ret)
 		return ret;
 
-	virtqueue_kick(priv->vq);
+	cmd->io = io;
+	cmd->blkcnt = bytes / 512;
+	io->issued += cmd->blkcnt;
+	io->cmds++;
+	priv->busy++;
 
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
+	return 0;
+}
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+/*
+ * Move a block request to the @done list if nothing more is to be done for
+ * it. Its completion callback may submit more requests, so it is only
+ * called by virtio_blk_finish() once the driver has finished with its own
+ * lists.
+ */
+static void virtio_blk_check_done(struct virtio_blk_io *io,
+				  struct list_head *done)
+{
+	struct blk_req *req = io->req;
+
+	if (io->cmds || (!io->ret && io->issued < io->total))
+		return;
+	list_move_tail(&req->node, done);
+}
+
+/* Report each block request in the list as finished */
+static void virtio_blk_finish(struct list_head *done)
+{
+	struct virtio_blk_io *io;
+	struct blk_req *req;
+
+	while (!list_empty(done)) {
+		req = list_first_entry(done, struct blk_req, node);
+		io = (struct virtio_blk_io *)req->drv_data;
+		list_del(&req->node);
+		io->req = NULL;
+		blk_req_done(req, io->ret, io->done);
+	}
+}
+
+/*
+ * Fill the virtqueue with requests for the waiting block requests, oldest
+ * first, then kick the device once for them all
+ */
+static void virtio_blk_start(struct udevice *dev, struct list_head *done)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_cmd *cmd = priv->cmds;
+	struct blk_req *req, *next;
+	struct virtio_blk_io *io;
+	bool issued = false;
+	int ret;
+
+	list_for_each_entry_safe(req, next, &priv->reqs, node) {
+		io = (struct virtio_blk_io *)req->drv_data;
+		while (!io->ret && io->issued < io->total) {
+			if (priv->busy == VIRTIO_BLK_MAX_CMDS)
+				goto out;
+			while (cmd->io)
+				cmd++;
+			ret = virtio_blk_issue(dev, io, cmd);
+			if (ret == -ENOSPC)
+				goto out;
+			if (ret) {
+				io->ret = ret;
+				virtio_blk_check_done(io, done);
+				break;
+			}
+			issued = true;
+		}
+	}
+out:
+	if (issued)
+		virtqueue_kick(priv->vq);
+}
+
+static int virtio_blk_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_io *io;
+	LIST_HEAD(done);
+	int i;
+
+	for (i = 0, io = priv->io; i < VIRTIO_BLK_MAX_REQS; i++, io++) {
+		if (!io->req)
+			break;
+	}
+	if (i == VIRTIO_BLK_MAX_REQS)
+		return -EBUSY;
+
+	memset(io, '\0', sizeof(*io));
+	io->req = req;
+	io->total = blk_req_blkcnt(req);
+	req->drv_data = (ulong)io;
+	list_add_tail(&req->node, &priv->reqs);
+	virtio_blk_start(dev, &done);
+	virtio_blk_finish(&done);
+
+	return 0;
+}
+
+static int virtio_blk_poll(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_cmd *cmd;
+	struct virtio_blk_io *io;
+	LIST_HEAD(done);
+	void *hdr;
+
+	while ((hdr = virtqueue_get_buf(priv->vq, NULL))) {
+		cmd = container_of(hdr, struct virtio_blk_cmd, out_hdr);
+		io = cmd->io;
+		cmd->io = NULL;
+		priv->busy--;
+		io->cmds--;
+		if (cmd->status != VIRTIO_BLK_S_OK) {
+			if (!io->ret)
+				io->ret = -EIO;
+		} else if (!io->ret) {
+			/* Only count blocks up to the first failure */
+			io->done += cmd->blkcnt;
+		}
+		virtio_blk_check_done(io, &done);
+	}
+	virtio_blk_start(dev, &done);
+	virtio_blk_finish(&done);
+
+	return 0;
+}
+
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, bool write)
+{
+	struct blk_sg sg = {
+		.buf = buffer,
+		.blkcnt = blkcnt,
+	};
+	struct blk_req req = {
+		.op = write ? BLK_REQ_WRITE : BLK_REQ_READ,
+		.start = sector,
+		.sg = &sg,
+		.sg_count = 1,
+	};
+
+	/*
+	 * Go through the asynchronous path so that a large transfer is split
+	 * into requests which are all in the virtqueue at once
+	 */
+	if (!blkcnt || blk_submit(dev, &req))
+		return 0;
+	if (blk_wait(dev, &req))
+		return -EIO;
+
+	return blkcnt;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
 			     lbaint_t blkcnt, void *buffer)
 {
-	return virtio_blk_do_req(dev, start, blkcnt, buffer,
-				 VIRTIO_BLK_T_IN);
+	return virtio_blk_do_req(dev, start, blkcnt, buffer, false);
 }
 
 static ulong virtio_blk_write(struct udevice *dev, lbaint_t start,
 			      lbaint_t blkcnt, const void *buffer)
 {
-	return virtio_blk_do_req(dev, start, blkcnt, (void *)buffer,
-				 VIRTIO_BLK_T_OUT);
+	return virtio_blk_do_req(dev, start, blkcnt, (void *)buffer, true);
 }
 
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+};
+
 static int virtio_blk_bind(struct udevice *dev)
 {
 	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(dev->parent);
@@ -97,7 +330,8 @@ static int virtio_blk_bind(struct udevice *dev)
 	desc->bdev = dev;
 
 	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    NULL, 0);
 
 	return 0;
 }
@@ -107,6 +341,7 @@ static int virtio_blk_probe(struct udevice *dev)
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_platdata(dev);
 	u64 cap;
+	u32 val;
 	int ret;
 
 	ret = virtio_find_vqs(dev, 1, &priv->vq);
@@ -117,12 +352,35 @@ static int virtio_blk_probe(struct udevice *dev)
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
 	desc->lba = cap;
 
+	/*
+	 * Each request needs a descriptor for its header and status as well
+	 * as the data, unless they go in an indirect table
+	 */
+	priv->max_segs = VIRTIO_BLK_DEF_SEGS;
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SEG_MAX)) {
+		virtio_cread(dev, struct virtio_blk_config, seg_max, &val);
+		if (val)
+			priv->max_segs = min_t(uint, val, VIRTIO_BLK_MAX_SEGS);
+	}
+	if (!priv->vq->indirect)
+		priv->max_segs = min(priv->max_segs, priv->vq->vring.num - 2);
+	priv->max_seg_size = VIRTIO_BLK_MAX_XFER;
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SIZE_MAX)) {
+		virtio_cread(dev, struct virtio_blk_config, size_max, &val);
+		if (val >= 512)
+			priv->max_seg_size = min_t(ulong, val & ~511,
+						   VIRTIO_BLK_MAX_XFER);
+	}
+	INIT_LIST_HEAD(&priv->reqs);
+
 	return 0;
 }
 
 static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
+	.submit	= virtio_blk_submit,
+	.poll	= virtio_blk_poll,
 };
 
 U_BOOT_DRIVER(virtio_blk) = {
@@ -13,21 +13,62 @@
 #include <virtio.h>
 #include <virtio_ring.h>
 
+static struct vring_desc *alloc_indirect(struct virtqueue *vq,
+					 unsigned int total_sg)
+{
+	struct vring_desc *desc;
+	unsigned int i;
+
+	desc = malloc(total_sg * sizeof(struct vring_desc));
+	if (!desc)
+		return NULL;
+
+	for (i = 0; i < total_sg; i++)
+		desc[i].next = cpu_to_virtio16(vq->vdev, i + 1);
+
+	return desc;
+}
+
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		  unsigned int out_sgs, unsigned int in_sgs)
 {
 	struct vring_desc *desc;
 	unsigned int total_sg = out_sgs + in_sgs;
 	unsigned int i, n, avail, descs_used, uninitialized_var(prev);
+	bool indirect;
 	int head;
 
 	WARN_ON(total_sg == 0);
 
 	head = vq->free_head;
 
-	desc = vq->vring.desc;
-	i = head;
-	descs_used = total_sg;
+	/*
+	 * With more than one buffer, put them in a separate table so that
+	 * they only take up one entry in the ring
+	 */
+	if (vq->indirect && total_sg > 1 && vq->num_free)
+		desc = alloc_indirect(vq, total_sg);
+	else
+		desc = NULL;
+
+	/* A chain longer than the ring only fits with an indirect table */
+	if (!desc && total_sg > vq->vring.num) {
+		if (!vq->indirect)
+			return -EINVAL;
+		if (vq->num_free)
+			return -ENOMEM;
+	}
+
+	if (desc) {
+		indirect = true;
+		i = 0;
+		descs_used = 1;
+	} else {
+		indirect = false;
+		desc = vq->vring.desc;
+		i = head;
+		descs_used = total_sg;
+	}
 
 	if (vq->num_free < descs_used) {
 		debug("Can't add buf len %i - avail = %i\n",
@@ -67,11 +108,25 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	/* Last one doesn't continue */
 	desc[prev].flags &= cpu_to_virtio16(vq->vdev, ~VRING_DESC_F_NEXT);
 
+	if (indirect) {
+		/* Now that the indirect table is filled in, point to it */
+		vq->vring.desc[head].flags = cpu_to_virtio16(vq->vdev,
+						VRING_DESC_F_INDIRECT);
+		vq->vring.desc[head].addr = cpu_to_virtio64(vq->vdev,
+						(u64)(uintptr_t)desc);
+		vq->vring.desc[head].len = cpu_to_virtio32(vq->vdev,
+					total_sg * sizeof(struct vring_desc));
+	}
+
 	/* We're using some buffers from the free list. */
 	vq->num_free -= descs_used;
 
 	/* Update free pointer */
-	vq->free_head = i;
+	if (indirect)
+		vq->free_head = virtio16_to_cpu(vq->vdev,
+						vq->vring.desc[head].next);
+	else
+		vq->free_head = i;
 
 	/*
 	 * Put entry in available array (but don't update avail->idx
@@ -159,8 +214,10 @@ static inline bool more_used(const struct virtqueue *vq)
 
 void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 {
+	struct vring_desc *indir;
 	unsigned int i;
 	u16 last_used;
+	u64 addr;
 
 	if (!more_used(vq)) {
 		debug("(%s.%d): No more buffers in queue\n",
@@ -197,8 +254,16 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
-	return (void *)(uintptr_t)virtio64_to_cpu(vq->vdev,
-						  vq->vring.desc[i].addr);
+	/* Return the first buffer, as passed to virtqueue_add() */
+	addr = virtio64_to_cpu(vq->vdev, vq->vring.desc[i].addr);
+	if (vq->vring.desc[i].flags &
+	    cpu_to_virtio16(vq->vdev, VRING_DESC_F_INDIRECT)) {
+		indir = (struct vring_desc *)(uintptr_t)addr;
+		addr = virtio64_to_cpu(vq->vdev, indir[0].addr);
+		free(indir);
+	}
+
+	return (void *)(uintptr_t)addr;
 }
 
 static struct virtqueue *__vring_new_virtqueue(unsigned int index,
@@ -224,6 +289,7 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->num_added = 0;
 	list_add_tail(&vq->list, &uc_priv->vqs);
 
+	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC);
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
 
 	/* Tell other side not to bother us */
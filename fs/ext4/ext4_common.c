@@ -1639,6 +1639,90 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	return 1;
 }
 
+/*
+ * Look up fileblock in the extent tree of an inode. Returns the physical block
+ * number (0 for a hole) and sets *countp to the number of following file
+ * blocks, up to its original value, which are physically contiguous with it
+ * (or which are also part of the hole).
+ */
+static long int read_extent_blocks(struct ext2_inode *inode, int fileblock,
+				   int *countp, struct ext_block_cache *cache)
+{
+	long int startblock, endblock;
+	struct ext_block_cache *c, cd;
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	unsigned long long start;
+	int log2_blksz;
+	long int blknr = 0;
+	int i;
+
+	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
+		- get_fs()->dev_desc->log2blksz;
+
+	if (cache) {
+		c = cache;
+	} else {
+		c = &cd;
+		ext_cache_init(c);
+	}
+	ext_block =
+		ext4fs_get_extent_block(ext4fs_root, c,
+					(struct ext4_extent_header *)
+					inode->b.blocks.dir_blocks,
+					fileblock, log2_blksz);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		if (!cache)
+			ext_cache_fini(c);
+		return -EINVAL;
+	}
+
+	extent = (struct ext4_extent *)(ext_block + 1);
+
+	for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
+		startblock = le32_to_cpu(extent[i].ee_block);
+		endblock = startblock + le16_to_cpu(extent[i].ee_len);
+
+		if (startblock > fileblock) {
+			/* Sparse file */
+			if (*countp > startblock - fileblock)
+				*countp = startblock - fileblock;
+			break;
+
+		} else if (fileblock < endblock) {
+			start = le16_to_cpu(extent[i].ee_start_hi);
+			start = (start << 32) +
+				le32_to_cpu(extent[i].ee_start_lo);
+			if (*countp > endblock - fileblock)
+				*countp = endblock - fileblock;
+			blknr = (fileblock - startblock) + start;
+			break;
+		}
+	}
+
+	/*
+	 * Past the last extent of this leaf, the following blocks may belong
+	 * to the next leaf, so only report this one as a hole
+	 */
+	if (i == le16_to_cpu(ext_block->eh_entries))
+		*countp = 1;
+
+	if (!cache)
+		ext_cache_fini(c);
+	return blknr;
+}
+
+long int read_allocated_blocks(struct ext2_inode *inode, int fileblock,
+			       int *countp, struct ext_block_cache *cache)
+{
+	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL)
+		return read_extent_blocks(inode, fileblock, countp, cache);
+
+	*countp = 1;
+	return read_allocated_block(inode, fileblock, cache);
+}
+
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache)
 {
@@ -1649,62 +1733,15 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	long int rblock;
 	long int perblock_parent;
 	long int perblock_child;
-	unsigned long long start;
 	/* get the blocksize of the filesystem */
 	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		long int startblock, endblock;
-		struct ext_block_cache *c, cd;
-		struct ext4_extent_header *ext_block;
-		struct ext4_extent *extent;
-		int i;
-
-		if (cache) {
-			c = cache;
-		} else {
-			c = &cd;
-			ext_cache_init(c);
-		}
-		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, c,
-						(struct ext4_extent_header *)
-						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
-		if (!ext_block) {
-			printf("invalid extent block\n");
-			if (!cache)
-				ext_cache_fini(c);
-			return -EINVAL;
-		}
-
-		extent = (struct ext4_extent *)(ext_block + 1);
-
-		for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
-			startblock = le32_to_cpu(extent[i].ee_block);
-			endblock = startblock + le16_to_cpu(extent[i].ee_len);
-
-			if (startblock > fileblock) {
-				/* Sparse file */
-				if (!cache)
-					ext_cache_fini(c);
-				return 0;
+		int count = 1;
 
-			} else if (fileblock < endblock) {
-				start = le16_to_cpu(extent[i].ee_start_hi);
-				start = (start << 32) +
-					le32_to_cpu(extent[i].ee_start_lo);
-				if (!cache)
-					ext_cache_fini(c);
-				return (fileblock - startblock) + start;
-			}
-		}
-
-		if (!cache)
-			ext_cache_fini(c);
-		return 0;
+		return read_extent_blocks(inode, fileblock, &count, cache);
 	}
 
 	/* Direct blocks. */
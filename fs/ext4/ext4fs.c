@@ -25,6 +25,7 @@
 #include <ext4fs.h>
 #include "ext4_common.h"
 #include <div64.h>
+#include <linux/sizes.h>
 
 int ext4fs_symlinknest;
 struct ext_filesystem ext_fs;
@@ -44,12 +45,15 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
  * reads into one potentially more efficient larger sequential read action
+ *
+ * File blocks are looked up a run at a time, so a file made of a few large
+ * extents is read with a few large device reads straight into the buffer.
  */
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
+	int i, run;
 	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
@@ -61,7 +65,6 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 	lbaint_t delayed_skipfirst = 0;
 	lbaint_t delayed_next = 0;
 	char *delayed_buf = NULL;
-	char *start_buf = buf;
 	short status;
 	struct ext_block_cache cache;
 
@@ -78,12 +81,15 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
+	for (i = lldiv(pos, blocksize); i < blockcnt; i += run) {
 		long int blknr;
 		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
+		int blockend;
 		int skipfirst = 0;
-		blknr = read_allocated_block(&node->inode, i, &cache);
+
+		/* fs_devread() takes an int length, so keep runs below 1GiB */
+		run = min(blockcnt - i, (lbaint_t)(SZ_1G / blocksize));
+		blknr = read_allocated_blocks(&node->inode, i, &run, &cache);
 		if (blknr < 0) {
 			ext_cache_fini(&cache);
 			return -1;
@@ -91,13 +97,11 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 
 		blknr = blknr << log2_fs_blocksize;
 
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
-
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
+		if (i + run == blockcnt) {
+			/* Last run ends with the data */
+			blockend = (len + pos) - (blocksize * (lbaint_t)i);
+		} else {
+			blockend = blocksize * run;
 		}
 
 		/* First block. */
@@ -108,11 +112,14 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		if (blknr) {
 			int status;
 
-			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
-					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
-				} else {	/* spill */
+			if (previous_block_number != -1 &&
+			    delayed_next == blknr &&
+			    delayed_extent + blockend <= SZ_1G) {
+				delayed_extent += blockend;
+				delayed_next += run << log2_fs_blocksize;
+			} else {
+				if (previous_block_number != -1) {
+					/* spill */
 					status = ext4fs_devread(delayed_start,
 							delayed_skipfirst,
 							delayed_extent,
@@ -121,26 +128,16 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 						ext_cache_fini(&cache);
 						return -1;
 					}
-					previous_block_number = blknr;
-					delayed_start = blknr;
-					delayed_extent = blockend;
-					delayed_skipfirst = skipfirst;
-					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
 				}
-			} else {
 				previous_block_number = blknr;
 				delayed_start = blknr;
 				delayed_extent = blockend;
 				delayed_skipfirst = skipfirst;
 				delayed_buf = buf;
 				delayed_next = blknr +
-					(blockend >> log2blksz);
+					(run << log2_fs_blocksize);
 			}
 		} else {
-			int n;
-			int n_left;
 			if (previous_block_number != -1) {
 				/* spill */
 				status = ext4fs_devread(delayed_start,
@@ -153,14 +150,10 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 				}
 				previous_block_number = -1;
 			}
-			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			n_left = len - ( buf - start_buf );
-			if (n > n_left)
-				n = n_left;
-			memset(buf, 0, n);
+			/* Holes read as zeroes */
+			memset(buf, 0, blockend);
 		}
-		buf += blocksize - skipfirst;
+		buf += blockend;
 	}
 	if (previous_block_number != -1) {
 		/* spill */
@@ -301,6 +301,63 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/* A run of consecutive clusters in a cluster chain */
+struct fat_extent {
+	__u32 start;	/* first cluster */
+	__u32 count;	/* number of clusters */
+};
+
+#define FAT_EXTENTS	16
+
+/**
+ * get_extents() - walk a cluster chain ahead of reading it
+ *
+ * Follow the cluster chain from 'clust', collecting runs of consecutive
+ * clusters, until the clusters found cover 'size' bytes or FAT_EXTENTS runs
+ * have been collected. Doing this before reading any data keeps the FAT
+ * accesses together and lets each run be read with a single disk_read().
+ *
+ * @mydata:	file system description
+ * @clust:	first cluster of the chain
+ * @size:	number of bytes wanted from the chain
+ * @ext:	returns the runs found, FAT_EXTENTS entries
+ * @nextp:	returns the cluster following the last run, if 'size' is not
+ *		covered
+ * Return:	number of runs found, -1 on an invalid FAT entry
+ */
+static int get_extents(fsdata *mydata, __u32 clust, loff_t size,
+		       struct fat_extent *ext, __u32 *nextp)
+{
+	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
+	__u32 next;
+	int n = 0;
+
+	ext[0].start = clust;
+	ext[0].count = 1;
+	while (size > bytesperclust) {
+		next = get_fatent(mydata, clust);
+		if (CHECK_CLUST(next, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", next);
+			printf("Invalid FAT entry\n");
+			return -1;
+		}
+		size -= bytesperclust;
+		if (next == clust + 1) {
+			ext[n].count++;
+		} else {
+			if (++n == FAT_EXTENTS) {
+				*nextp = next;
+				return n;
+			}
+			ext[n].start = next;
+			ext[n].count = 1;
+		}
+		clust = next;
+	}
+
+	return n + 1;
+}
+
 /**
  * get_contents() - read from file
  *
@@ -322,7 +379,6 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
 	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
 	loff_t actsize;
 
 	*gotsize = 0;
@@ -389,50 +445,107 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 		}
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
+	while (filesize > 0) {
+		struct fat_extent ext[FAT_EXTENTS];
+		int i, n;
+
+		n = get_extents(mydata, curclust, filesize, ext, &curclust);
+		if (n < 0)
+			return -1;
+
+		for (i = 0; i < n; i++) {
+			actsize = min(filesize,
+				      (loff_t)ext[i].count * bytesperclust);
+			if (get_cluster(mydata, ext[i].start, buffer,
+					actsize) != 0) {
+				printf("Error reading cluster\n");
 				return -1;
 			}
-			endclust = newclust;
-			actsize += bytesperclust;
+			*gotsize += actsize;
+			filesize -= actsize;
+			buffer += actsize;
 		}
+	}
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
+	return 0;
+}
+
+/**
+ * get_contents_stream() - read a file a chunk at a time
+ *
+ * Unlike calling get_contents() for each chunk, this follows the cluster
+ * chain once for the whole file, so each chunk takes the same time to find
+ * however far into the file it is.
+ *
+ * @mydata:	file system description
+ * @dentptr:	directory entry pointer
+ * @buffer:	buffer into which to read each chunk
+ * @chunk:	size of @buffer
+ * @func:	function to call for each chunk
+ * @priv:	private data for @func
+ * @gotsize:	number of bytes actually read
+ * Return:	-1 on error reading the file, -ve error from @func, else 0
+ */
+static int get_contents_stream(fsdata *mydata, dir_entry *dentptr,
+			       __u8 *buffer, loff_t chunk,
+			       fs_read_stream_fn func, void *priv,
+			       loff_t *gotsize)
+{
+	loff_t filesize = FAT2CPU32(dentptr->size);
+	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
+	__u32 curclust = START(dentptr);
+	struct fat_extent ext[FAT_EXTENTS];
+	loff_t want, len, actsize;
+	__u32 last = 0;
+	int i, n, ret;
+
+	*gotsize = 0;
+
+	/* Each chunk holds whole clusters, so that the next one is aligned */
+	chunk -= chunk % bytesperclust;
+	if (!chunk)
+		return -EINVAL;
+
+	while (filesize > 0) {
+		want = min(chunk, filesize);
+		for (len = 0; len < want;) {
+			n = get_extents(mydata, curclust, want - len, ext,
+					&curclust);
+			if (n < 0)
+				return -1;
+
+			for (i = 0; i < n; i++) {
+				actsize = min(want - len,
+					      (loff_t)ext[i].count *
+					      bytesperclust);
+				if (get_cluster(mydata, ext[i].start,
+						buffer + len, actsize) != 0) {
+					printf("Error reading cluster\n");
+					return -1;
+				}
+				len += actsize;
+			}
+			last = ext[n - 1].start + ext[n - 1].count - 1;
 		}
-		*gotsize += (int)actsize;
-		filesize -= actsize;
-		buffer += actsize;
+		*gotsize += len;
+		filesize -= len;
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
+		ret = func(priv, buffer, len);
+		if (ret)
+			return ret < 0 ? ret : 0;
+
+		/* carry on from the cluster after this chunk */
+		if (filesize) {
+			curclust = get_fatent(mydata, last);
+			if (CHECK_CLUST(curclust, mydata->fatsize)) {
+				debug("curclust: 0x%x\n", curclust);
+				printf("Invalid FAT entry\n");
+				return -1;
+			}
 		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	}
+
+	return 0;
 }
 
 /*
@@ -1248,6 +1361,36 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	return ret;
 }
 
+int fat_read_stream(const char *filename, void *buf, loff_t chunk,
+		    fs_read_stream_fn func, void *priv, loff_t *actread)
+{
+	fsdata fsdata;
+	fat_itr *itr;
+	int ret;
+
+	itr = malloc_cache_aligned(sizeof(fat_itr));
+	if (!itr)
+		return -ENOMEM;
+	ret = fat_itr_root(itr, &fsdata);
+	if (ret)
+		goto out_free_itr;
+
+	ret = fat_itr_resolve(itr, filename, TYPE_FILE);
+	if (ret)
+		goto out_free_both;
+
+	ret = get_contents_stream(&fsdata, itr->dent, buf, chunk, func, priv,
+				  actread);
+	if (ret == -1)
+		printf("** Unable to read file %s **\n", filename);
+
+out_free_both:
+	free(fsdata.fatbuf);
+out_free_itr:
+	free(itr);
+	return ret;
+}
+
 typedef struct {
 	struct fs_dir_stream parent;
 	struct fs_dirent dirent;
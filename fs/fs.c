@@ -6,8 +6,13 @@
 #include <config.h>
 #include <errno.h>
 #include <common.h>
+#include <decomp_stream.h>
 #include <env.h>
+#include <image.h>
+#include <lmb.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <memalign.h>
 #include <part.h>
 #include <ext4fs.h>
 #include <fat.h>
@@ -18,6 +23,7 @@
 #include <asm/io.h>
 #include <div64.h>
 #include <linux/math64.h>
+#include <linux/sizes.h>
 #include <efi_loader.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -141,6 +147,14 @@ struct fstype_info {
 	int (*size)(const char *filename, loff_t *size);
 	int (*read)(const char *filename, void *buf, loff_t offset,
 		    loff_t len, loff_t *actread);
+	/*
+	 * Read a file a chunk at a time without looking up the position of
+	 * each chunk from the start of the file. See fs_read_stream(). If
+	 * NULL, .read() is called for each chunk instead.
+	 */
+	int (*read_stream)(const char *filename, void *buf, loff_t chunk,
+			   fs_read_stream_fn func, void *priv,
+			   loff_t *actread);
 	int (*write)(const char *filename, void *buf, loff_t offset,
 		     loff_t len, loff_t *actwrite);
 	void (*close)(void);
@@ -176,6 +190,7 @@ static struct fstype_info fstypes[] = {
 		.exists = fat_exists,
 		.size = fat_size,
 		.read = fat_read_file,
+		.read_stream = fat_read_stream,
 #if CONFIG_IS_ENABLED(FAT_WRITE)
 		.write = file_fat_write,
 		.unlink = fat_unlink,
@@ -529,6 +544,56 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	return _fs_read(filename, addr, offset, len, 0, actread);
 }
 
+/* Read a file a chunk at a time, using the filesystem's read() method */
+static int fs_read_stream_generic(struct fstype_info *info,
+				  const char *filename, void *buf, loff_t chunk,
+				  fs_read_stream_fn func, void *priv,
+				  loff_t *actread)
+{
+	loff_t size, pos, len;
+	int ret;
+
+	ret = info->size(filename, &size);
+	if (ret)
+		return ret;
+
+	for (pos = 0; pos < size; pos += len) {
+		ret = info->read(filename, buf, pos, min(chunk, size - pos),
+				 &len);
+		if (ret)
+			return ret;
+		if (!len)
+			break;
+		*actread += len;
+		ret = func(priv, buf, len);
+		if (ret)
+			return ret < 0 ? ret : 0;
+	}
+
+	return 0;
+}
+
+int fs_read_stream(const char *filename, ulong addr, loff_t chunk,
+		   fs_read_stream_fn func, void *priv, loff_t *actread)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	void *buf;
+	int ret;
+
+	*actread = 0;
+	buf = map_sysmem(addr, chunk);
+	if (info->read_stream)
+		ret = info->read_stream(filename, buf, chunk, func, priv,
+					actread);
+	else
+		ret = fs_read_stream_generic(info, filename, buf, chunk, func,
+					     priv, actread);
+	unmap_sysmem(buf);
+	fs_close();
+
+	return ret;
+}
+
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite)
 {
@@ -736,6 +801,140 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	return 0;
 }
 
+#ifdef CONFIG_CMD_LOADZ
+/* Number of bytes of the compressed file read at a time by loadz */
+#define LOADZ_CHUNK_SIZE	SZ_1M
+
+struct loadz_state {
+	struct decomp_stream ds;
+	void *dst;
+	ulong max_size;
+	int comp;
+};
+
+/* Decompress each chunk of the file as soon as it has been read */
+static int loadz_chunk(void *priv, void *buf, loff_t len)
+{
+	struct loadz_state *state = priv;
+	int ret;
+
+	if (state->comp == IH_COMP_NONE) {
+		state->comp = decomp_stream_detect(buf, len);
+		ret = decomp_stream_init(&state->ds, state->comp, state->dst,
+					 state->max_size);
+		if (ret) {
+			printf("** Unknown or unsupported compression **\n");
+			state->comp = IH_COMP_NONE;
+			return ret;
+		}
+	}
+
+	ret = decomp_stream_write(&state->ds, buf, len);
+	if (ret)
+		return ret;
+
+	return state->ds.done ? 1 : 0;
+}
+
+int do_loadz(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
+	     int fstype)
+{
+	struct loadz_state state;
+	const char *dev_part;
+	const char *filename;
+	unsigned long addr;
+	unsigned long time;
+	ulong max_size;
+	loff_t len_read;
+	long len;
+	void *buf;
+	char *ep;
+	int ret;
+
+	if (argc < 2 || argc > 5)
+		return CMD_RET_USAGE;
+
+	dev_part = (argc >= 3) ? argv[2] : NULL;
+	if (argc >= 4) {
+		addr = simple_strtoul(argv[3], &ep, 16);
+		if (ep == argv[3] || *ep != '\0')
+			return CMD_RET_USAGE;
+	} else {
+		addr = env_get_hex("loadaddr", CONFIG_SYS_LOAD_ADDR);
+	}
+	if (argc >= 5) {
+		filename = argv[4];
+	} else {
+		filename = env_get("bootfile");
+		if (!filename) {
+			puts("** No boot file defined **\n");
+			return 1;
+		}
+	}
+
+#ifdef CONFIG_LMB
+	{
+		struct lmb lmb;
+
+		lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+		max_size = lmb_get_free_size(&lmb, addr);
+		if (!max_size) {
+			printf("** Loading file would overwrite reserved memory **\n");
+			return 1;
+		}
+	}
+#else
+	max_size = ~0UL - addr;
+#endif
+
+	buf = malloc_cache_aligned(LOADZ_CHUNK_SIZE);
+	if (!buf)
+		return 1;
+
+	/*
+	 * Read the file a chunk at a time, decompressing each chunk to its
+	 * final place before reading the next, so the compressed file is
+	 * never held in memory as a whole
+	 */
+	state.dst = map_sysmem(addr, max_size);
+	state.max_size = max_size;
+	state.comp = IH_COMP_NONE;
+	time = get_timer(0);
+	if (fs_set_blk_dev(argv[1], dev_part, fstype))
+		ret = -ENODEV;
+	else
+		ret = fs_read_stream(filename, map_to_sysmem(buf),
+				     LOADZ_CHUNK_SIZE, loadz_chunk, &state,
+				     &len_read);
+	time = get_timer(time);
+	free(buf);
+	unmap_sysmem(state.dst);
+	if (state.comp == IH_COMP_NONE)
+		return 1;
+	len = decomp_stream_end(&state.ds);
+	if (ret == -ENOSPC)
+		printf("** Loading file would overwrite reserved memory **\n");
+	if (ret || len < 0) {
+		printf("** Error decompressing '%s' **\n", filename);
+		return 1;
+	}
+
+	printf("%llu bytes read, %ld bytes decompressed (%s) in %lu ms",
+	       len_read, len, genimg_get_comp_name(state.comp), time);
+	if (time > 0) {
+		puts(" (");
+		print_size(div_u64(len, time) * 1000, "/s");
+		puts(")");
+	}
+	puts("\n");
+
+	env_set_hex("fileaddr", addr);
+	env_set_hex("filesize", len);
+
+	return 0;
+}
+#endif
+
 int do_ls(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	int fstype)
 {
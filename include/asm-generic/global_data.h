@@ -21,6 +21,7 @@
 
 #ifndef __ASSEMBLY__
 #include <fdtdec.h>
+#include <fdtdec_cache.h>
 #include <membuff.h>
 #include <linux/list.h>
 
@@ -68,6 +69,16 @@ typedef struct global_data {
 	struct udevice	*dm_root_f;	/* Pre-relocation root instance */
 	struct list_head uclass_root;	/* Head of core tree */
 #endif
+#if CONFIG_IS_ENABLED(DM_DEVICE_INDEX)
+	struct dm_device_index *dm_index;	/* Devices by node / phandle */
+#endif
+#if CONFIG_IS_ENABLED(DM_PROBE_ASYNC)
+	struct list_head probe_queue;	/* Devices probing in background */
+	int probe_depth;		/* Nesting of queued probe() calls */
+#endif
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+	struct lists_compat_hash *compat_hash;	/* Driver compatible strings */
+#endif
 #ifdef CONFIG_TIMER
 	struct udevice	*timer;		/* Timer instance for Driver Model */
 #endif
@@ -75,6 +86,9 @@ typedef struct global_data {
 	const void *fdt_blob;		/* Our device tree, NULL if none */
 	void *new_fdt;			/* Relocated FDT */
 	unsigned long fdt_size;		/* Space reserved for relocated FDT */
+#if CONFIG_IS_ENABLED(OF_FDT_CACHE)
+	struct fdtdec_cache fdt_cache;	/* Recent lookups in fdt_blob */
+#endif
 #ifdef CONFIG_OF_LIVE
 	struct device_node *of_root;
 #endif
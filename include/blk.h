@@ -8,6 +8,7 @@
 #define BLK_H
 
 #include <efi.h>
+#include <linux/list.h>
 
 #ifdef CONFIG_SYS_64BIT_LBA
 typedef uint64_t lbaint_t;
@@ -145,6 +146,27 @@ void blkcache_fill(int iftype, int dev,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer);
 
+/**
+ * blkcache_prefetch() - work out how to extend a read that missed the cache
+ *
+ * Small reads are widened to whole cache lines so that they can be cached,
+ * and reads which continue a sequential stream on the same device are
+ * extended by a read-ahead window which doubles on each sequential miss, up
+ * to the configured maximum.
+ *
+ * @param block_dev - block device being read
+ * @param start - starting block number of the request
+ * @param blkcnt - number of blocks requested
+ * @param startp - returns the first block to read
+ * @param bufp - returns a buffer, owned by the cache, to read into
+ *
+ * @return - number of blocks to read from *startp into *bufp, or 0 if the
+ * request should be passed to the device unchanged
+ */
+lbaint_t blkcache_prefetch(struct blk_desc *block_dev,
+			   lbaint_t start, lbaint_t blkcnt,
+			   lbaint_t *startp, void **bufp);
+
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
@@ -157,10 +179,15 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
+ * The memory used by the cache is bounded by blocks * entries device blocks,
+ * plus a staging buffer of at most half that size for read-ahead.
+ *
+ * @param blocks - blocks per entry, rounded down to a power of two
  * @param entries - maximum entries in cache
+ * @param readahead - maximum read-ahead window in blocks, 0 to disable
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(unsigned blocks, unsigned entries,
+			unsigned readahead);
 
 /*
  * statistics of the block cache
@@ -171,6 +198,9 @@ struct block_cache_stats {
 	unsigned entries; /* current entry count */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned max_readahead;
+	unsigned readaheads; /* reads extended by read-ahead */
+	unsigned readahead_blocks; /* blocks read ahead of requests */
 };
 
 /**
@@ -193,6 +223,13 @@ static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
 
+static inline lbaint_t blkcache_prefetch(struct blk_desc *block_dev,
+					 lbaint_t start, lbaint_t blkcnt,
+					 lbaint_t *startp, void **bufp)
+{
+	return 0;
+}
+
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
@@ -200,6 +237,84 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 #if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
+/**
+ * struct blk_sg - one buffer of an asynchronous block request
+ *
+ * @buf:	Buffer to read into or write from. Drivers which use DMA may
+ *		need this to be cache-aligned.
+ * @blkcnt:	Number of blocks to transfer to or from @buf
+ */
+struct blk_sg {
+	void *buf;
+	lbaint_t blkcnt;
+};
+
+/* Operations for an asynchronous block request */
+enum blk_req_op {
+	BLK_REQ_READ,
+	BLK_REQ_WRITE,
+};
+
+struct blk_req;
+
+/**
+ * blk_req_complete_t - called when an asynchronous request is finished
+ *
+ * This is called from blk_submit() or blk_poll(), so it may submit further
+ * requests but must not wait for them.
+ *
+ * @req:	The request, with @ret and @done filled in
+ */
+typedef void (*blk_req_complete_t)(struct blk_req *req);
+
+/**
+ * struct blk_req - an asynchronous block request
+ *
+ * This is filled in by the caller and passed to blk_submit(). The caller
+ * must not change it, or touch its buffers, until it is finished.
+ *
+ * @op:		Operation to perform
+ * @start:	First block to transfer
+ * @sg:		Buffers to transfer, in order starting at block @start
+ * @sg_count:	Number of entries in @sg
+ * @complete:	Function to call when finished, or NULL
+ * @priv:	Private data for the caller
+ * @ret:	Result: -EINPROGRESS until finished, then 0 or -ve error
+ * @done:	Number of blocks transferred, valid once finished
+ * @dev:	Block device (set by blk_submit())
+ * @node:	Used by the uclass and then the driver while the request is
+ *		in progress
+ * @drv_data:	Private data for the driver while the request is in progress
+ */
+struct blk_req {
+	enum blk_req_op op;
+	lbaint_t start;
+	struct blk_sg *sg;
+	int sg_count;
+	blk_req_complete_t complete;
+	void *priv;
+
+	int ret;
+	lbaint_t done;
+	struct udevice *dev;
+	struct list_head node;
+	ulong drv_data;
+};
+
+/**
+ * struct blk_uc_priv - uclass-private data for each block device
+ *
+ * @pending:	Requests waiting for the driver to accept them
+ * @queued:	Number of requests in @pending
+ * @active:	Number of requests accepted by the driver and not yet
+ *		finished
+ */
+struct blk_uc_priv {
+	struct list_head pending;
+	int queued;
+	int active;
+};
+
 /* Operations on block devices */
 struct blk_ops {
 	/**
@@ -258,6 +373,39 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+	/**
+	 * submit() - start an asynchronous request
+	 *
+	 * This should start the transfer and return without waiting for it.
+	 * When it finishes the driver calls blk_req_done(), normally from
+	 * its poll() method, though it may also do this from here. Drivers
+	 * without this method are handled by the uclass, which carries out
+	 * each request with read() or write() in blk_submit().
+	 *
+	 * @dev:	Device to use
+	 * @req:	Request to start. @req->sg_count and each @blkcnt are
+	 *		non-zero.
+	 * @return 0 if OK, -EBUSY if the driver cannot take more requests
+	 * until some finish, perhaps on another device it looks after (the
+	 * uclass tries again from blk_poll()), -ENOSYS
+	 * if this device cannot handle asynchronous requests (the uclass
+	 * carries out the request synchronously), other -ve error to fail
+	 * the request
+	 */
+	int (*submit)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * poll() - check for finished asynchronous requests
+	 *
+	 * Calls blk_req_done() for each request which has finished. This is
+	 * also called while requests are waiting for submit(), so that a
+	 * driver shared between devices can finish requests for the others.
+	 *
+	 * @dev:	Device to check
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*poll)(struct udevice *dev);
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
@@ -275,6 +423,77 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_submit() - start an asynchronous block request
+ *
+ * The request is queued and the function returns, normally before the
+ * transfer is finished. Use blk_poll() to make progress and find out when
+ * it is done, at which point @req->complete is called. With drivers which
+ * do not support asynchronous requests, the transfer is carried out here
+ * and the request is finished before this returns.
+ *
+ * Reads by drivers which support asynchronous requests do not use the
+ * block cache. Writes invalidate it.
+ *
+ * @dev:	Block device to use
+ * @req:	Request to start, with @op, @start, @sg, @sg_count,
+ *		@complete and @priv filled in
+ * @return 0 if the request was accepted, in which case @req->complete is
+ * called once it finishes (successfully or not), -EINVAL if it is invalid,
+ * -ENOSYS if the operation is not supported
+ */
+int blk_submit(struct udevice *dev, struct blk_req *req);
+
+/**
+ * blk_poll() - make progress on asynchronous block requests
+ *
+ * This checks for finished requests, calling their completion functions,
+ * and passes any that are waiting to the driver.
+ *
+ * @dev:	Block device to check
+ * @return number of requests not yet finished, or -ve on error
+ */
+int blk_poll(struct udevice *dev);
+
+/**
+ * blk_wait() - wait for an asynchronous block request to finish
+ *
+ * @dev:	Block device the request was submitted to
+ * @req:	Request to wait for
+ * @return result of the request (0 if OK, -ve on error)
+ */
+int blk_wait(struct udevice *dev, struct blk_req *req);
+
+/**
+ * blk_req_done() - report that an asynchronous request has finished
+ *
+ * This is called by block drivers, typically from their poll() method.
+ *
+ * @req:	Request which has finished
+ * @ret:	0 if OK, -ve on error
+ * @done:	Number of blocks transferred
+ */
+void blk_req_done(struct blk_req *req, int ret, lbaint_t done);
+
+/**
+ * blk_req_sync() - carry out a request with the read() or write() method
+ *
+ * This is for drivers which accepted a request in submit() but then find
+ * that they cannot start it. It waits for the transfer and then calls
+ * blk_req_done().
+ *
+ * @req:	Request to carry out
+ */
+void blk_req_sync(struct blk_req *req);
+
+/**
+ * blk_req_blkcnt() - get the total number of blocks in a request
+ *
+ * @req:	Request to check
+ * @return total of the block counts in @req->sg
+ */
+lbaint_t blk_req_blkcnt(const struct blk_req *req);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -429,6 +648,9 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
 	ulong blks_read;
+	lbaint_t ra_start, ra_cnt;
+	void *ra_buf;
+
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
@@ -438,6 +660,17 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	 * bloats the code slightly (cause some board to fail to build), and
 	 * it would be an error to try an operation that does not exist.
 	 */
+	ra_cnt = blkcache_prefetch(block_dev, start, blkcnt, &ra_start,
+				   &ra_buf);
+	if (ra_cnt && block_dev->block_read(block_dev, ra_start, ra_cnt,
+					    ra_buf) == ra_cnt) {
+		blkcache_fill(block_dev->if_type, block_dev->devnum,
+			      ra_start, ra_cnt, block_dev->blksz, ra_buf);
+		memcpy(buffer, ra_buf + (start - ra_start) * block_dev->blksz,
+		       blkcnt * block_dev->blksz);
+		return blkcnt;
+	}
+
 	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Streaming decompression into a fixed output buffer
+ *
+ * This lets compressed data be decompressed as it arrives (e.g. chunk by
+ * chunk from a filesystem), so there is no need to hold the whole of the
+ * compressed image in memory first.
+ */
+
+#ifndef __DECOMP_STREAM_H
+#define __DECOMP_STREAM_H
+
+#include <linux/types.h>
+
+/**
+ * struct decomp_stream - state of a streaming decompression
+ *
+ * @comp:	compression type (IH_COMP_...)
+ * @dst:	output buffer
+ * @dst_size:	size of the output buffer in bytes
+ * @out_len:	number of bytes written to @dst so far
+ * @done:	true once the end of the compressed stream has been seen
+ * @priv:	private data for the decompressor
+ */
+struct decomp_stream {
+	int comp;
+	void *dst;
+	ulong dst_size;
+	ulong out_len;
+	bool done;
+	void *priv;
+};
+
+/**
+ * decomp_stream_detect() - work out the compression type from the data
+ *
+ * @src:	start of the compressed data
+ * @len:	number of bytes at @src
+ * @return compression type (IH_COMP_GZIP or IH_COMP_ZSTD), or IH_COMP_NONE
+ * if the data is not recognised
+ */
+int decomp_stream_detect(const void *src, ulong len);
+
+/**
+ * decomp_stream_init() - start a streaming decompression
+ *
+ * @ds:		stream to set up
+ * @comp:	compression type (IH_COMP_...)
+ * @dst:	output buffer
+ * @dst_size:	size of the output buffer in bytes
+ * @return 0 if OK, -ENOSYS if @comp is not supported, -ENOMEM if out of
+ * memory
+ */
+int decomp_stream_init(struct decomp_stream *ds, int comp, void *dst,
+		       ulong dst_size);
+
+/**
+ * decomp_stream_write() - pass the next piece of compressed data
+ *
+ * The data may be split at any point. Anything after the end of the
+ * compressed stream is ignored, except that zstd data may be made up of
+ * several frames, one after the other.
+ *
+ * @ds:		stream to use
+ * @src:	compressed data
+ * @len:	number of bytes at @src
+ * @return 0 if OK, -ENOSPC if the output buffer is too small, -EINVAL if
+ * the data is corrupt
+ */
+int decomp_stream_write(struct decomp_stream *ds, const void *src, ulong len);
+
+/**
+ * decomp_stream_end() - finish a streaming decompression
+ *
+ * This frees the decompressor state. It must be called once for each
+ * successful decomp_stream_init(), even after an error.
+ *
+ * @ds:		stream to finish
+ * @return number of bytes decompressed if OK, -EINVAL if the compressed
+ * stream is incomplete
+ */
+long decomp_stream_end(struct decomp_stream *ds);
+
+/**
+ * decomp_stream_buf() - decompress a buffer in one go
+ *
+ * @comp:	compression type (IH_COMP_...)
+ * @dst:	output buffer
+ * @dst_size:	size of the output buffer in bytes
+ * @src:	compressed data
+ * @src_len:	number of bytes at @src
+ * @lenp:	returns the number of bytes decompressed
+ * @return 0 if OK, -ve on error
+ */
+int decomp_stream_buf(int comp, void *dst, ulong dst_size, const void *src,
+		      ulong src_len, ulong *lenp);
+
+#endif
@@ -11,6 +11,8 @@
 #define _DM_DEVICE_INTERNAL_H
 
 #include <dm/ofnode.h>
+#include <dm/uclass-id.h>
+#include <linux/errno.h>
 
 struct device_node;
 struct udevice;
@@ -90,7 +92,8 @@ int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
  * first.
  *
  * @dev: Pointer to device to probe
- * @return 0 if OK, -ve on error
+ * @return 0 if OK, -EBUSY if its driver is waiting for the hardware in an
+ *	outer call to device_probe(), other -ve on error
  */
 int device_probe(struct udevice *dev);
 
@@ -216,4 +219,218 @@ static inline void devres_release_all(struct udevice *dev)
 }
 
 #endif /* ! CONFIG_DEVRES */
+
+#if CONFIG_IS_ENABLED(DM_DEVICE_INDEX)
+/**
+ * struct dm_device_index - Devices indexed by device tree node and phandle
+ *
+ * Each hash chain holds its devices in the order they were bound. This is
+ * also the order of each uclass's list of devices, so the first match in a
+ * chain is the device which a walk of the uclass would find.
+ *
+ * @bits:	log2 of the number of chains in each table
+ * @count:	Number of devices in the index
+ * @node_lookups: Number of lookups by node answered from the index
+ * @phandle_lookups: Number of lookups by phandle answered from the index
+ * @node_head:	Chains of devices by node
+ * @phandle_head: Chains of devices by phandle, for devices which have one
+ */
+struct dm_device_index {
+	uint bits;
+	uint count;
+	ulong node_lookups;
+	ulong phandle_lookups;
+	struct hlist_head *node_head;
+	struct hlist_head *phandle_head;
+};
+
+/**
+ * device_index_init() - Set up an empty device index
+ *
+ * This is called by dm_init() before any device is bound. If there is not
+ * enough memory, devices are found by walking through them instead.
+ */
+void device_index_init(void);
+
+/**
+ * device_index_uninit() - Free the device index
+ *
+ * This is called by dm_uninit() once all devices are unbound.
+ */
+void device_index_uninit(void);
+
+/**
+ * device_index_add() - Add a device to the index
+ *
+ * @dev:	Device to add, which must have been added to its uclass
+ */
+void device_index_add(struct udevice *dev);
+
+/**
+ * device_index_remove() - Remove a device from the index
+ *
+ * @dev:	Device to remove. This does nothing if it is not in the index.
+ */
+void device_index_remove(struct udevice *dev);
+
+/**
+ * device_index_find_by_ofnode() - Look up the device for a node
+ *
+ * @id:		uclass of the device, or UCLASS_INVALID for any
+ * @node:	Node to look up
+ * @devp:	Returns the first device bound to @node, or NULL if none
+ * @return 0 if found, -ENODEV if not found, -ENOSYS if there is no index
+ */
+int device_index_find_by_ofnode(enum uclass_id id, ofnode node,
+				struct udevice **devp);
+
+/**
+ * device_index_find_by_phandle() - Look up the device for a phandle
+ *
+ * @id:		uclass of the device, or UCLASS_INVALID for any
+ * @phandle:	Phandle to look up
+ * @devp:	Returns the first device whose node has @phandle, or NULL
+ * @return 0 if found, -ENODEV if not found, -ENOSYS if there is no index
+ */
+int device_index_find_by_phandle(enum uclass_id id, uint phandle,
+				 struct udevice **devp);
+#else
+static inline void device_index_init(void)
+{
+}
+
+static inline void device_index_uninit(void)
+{
+}
+
+static inline void device_index_add(struct udevice *dev)
+{
+}
+
+static inline void device_index_remove(struct udevice *dev)
+{
+}
+
+static inline int device_index_find_by_ofnode(enum uclass_id id, ofnode node,
+					      struct udevice **devp)
+{
+	return -ENOSYS;
+}
+
+static inline int device_index_find_by_phandle(enum uclass_id id, uint phandle,
+					       struct udevice **devp)
+{
+	return -ENOSYS;
+}
+#endif
+
+/**
+ * device_probe_start() - Start probing a device
+ *
+ * This is the same as device_probe() except that it does not wait for a
+ * driver with DM_FLAG_PROBE_ASYNC whose probe() method returns -EAGAIN.
+ * The device is then left active but not fully probed, and
+ * device_probe_continue() must be called until it finishes.
+ *
+ * @dev: Pointer to device to probe
+ * @return 0 if OK, -EINPROGRESS if the driver is still probing the device,
+ *	other -ve on error
+ */
+int device_probe_start(struct udevice *dev);
+
+/**
+ * device_probe_continue() - Call a driver's probe() method again
+ *
+ * @dev: Device for which device_probe_start() returned -EINPROGRESS
+ * @return 0 if OK, -EINPROGRESS if the driver is still probing the device,
+ *	other -ve on error, in which case the device is no longer active
+ */
+int device_probe_continue(struct udevice *dev);
+
+#if CONFIG_IS_ENABLED(DM_PROBE_ASYNC)
+/**
+ * device_probe_async() - Probe a device in the background
+ *
+ * This adds a device to the queue of devices being probed in the
+ * background and starts probing it if it does not depend on another device
+ * in the queue. A device depends on its parents and on the devices
+ * referred to by its 'clocks', 'resets' and '...-supply' properties.
+ *
+ * Devices in the queue make progress when dm_probe_async_poll() is
+ * called, including while device_probe() waits for a driver with
+ * DM_FLAG_PROBE_ASYNC. Calling device_probe() on a device in the queue
+ * waits for it to finish.
+ *
+ * @dev: Pointer to device to probe
+ * @return 0 if OK or the probe is still in progress, -ve on error
+ */
+int device_probe_async(struct udevice *dev);
+
+/**
+ * device_probe_async_wait() - Wait for a device in the queue to finish
+ *
+ * On return the device is no longer in the queue. It is active if it was
+ * probed successfully.
+ *
+ * @dev: Device to wait for
+ * @return 0 if the device has left the queue, -ve if probing it failed
+ */
+int device_probe_async_wait(struct udevice *dev);
+
+/**
+ * device_probe_async_cancel() - Take a device out of the queue
+ *
+ * A device which has not been started is simply removed from the queue.
+ * For one that has, this waits for its driver to finish probing it.
+ *
+ * @dev: Device to take out of the queue
+ * @return 0 if OK, -ve on error
+ */
+int device_probe_async_cancel(struct udevice *dev);
+
+/**
+ * dm_probe_async_poll() - Make progress with devices in the queue
+ *
+ * This starts each queued device whose dependencies have finished and
+ * calls the probe() method of each started device once.
+ *
+ * @return number of devices still in the queue
+ */
+int dm_probe_async_poll(void);
+
+/**
+ * dm_probe_async_wait() - Wait for all devices in the queue to finish
+ *
+ * Devices which fail to probe are left inactive. Use device_active() to
+ * check each device of interest.
+ *
+ * @return 0 if all were probed successfully, else the first error
+ */
+int dm_probe_async_wait(void);
+#else
+static inline int device_probe_async(struct udevice *dev)
+{
+	return device_probe(dev);
+}
+
+static inline int device_probe_async_wait(struct udevice *dev)
+{
+	return 0;
+}
+
+static inline int device_probe_async_cancel(struct udevice *dev)
+{
+	return 0;
+}
+
+static inline int dm_probe_async_poll(void)
+{
+	return 0;
+}
+
+static inline int dm_probe_async_wait(void)
+{
+	return 0;
+}
+#endif
 #endif
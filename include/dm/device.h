@@ -64,6 +64,21 @@ struct driver_info;
 /* DM does not enable/disable the power domains corresponding to this device */
 #define DM_FLAG_DEFAULT_PD_CTRL_OFF	(1 << 11)
 
+/*
+ * Driver probe() may return -EAGAIN while it waits for the hardware, and is
+ * called again later. Other devices can be probed in the meantime.
+ */
+#define DM_FLAG_PROBE_ASYNC		(1 << 12)
+
+/* Device is in the queue of devices probed in the background */
+#define DM_FLAG_PROBE_PENDING		(1 << 13)
+
+/* Device is active but its driver's probe() method has not finished */
+#define DM_FLAG_PROBING			(1 << 14)
+
+/* Driver probe() is waiting for the hardware while other devices are polled */
+#define DM_FLAG_PROBE_WAIT		(1 << 15)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
@@ -126,6 +141,11 @@ enum {
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @node_hash: Used to link the device into the index by node
+ * @phandle_hash: Used to link the device into the index by phandle
+ * @phandle: Phandle of the device's node, or 0 if none, as indexed
+ * @probe_node: Used to link the device into the queue of devices being
+ *		probed in the background
  */
 struct udevice {
 	const struct driver *driver;
@@ -149,6 +169,14 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#if CONFIG_IS_ENABLED(DM_DEVICE_INDEX)
+	struct hlist_node node_hash;
+	struct hlist_node phandle_hash;
+	uint phandle;
+#endif
+#if CONFIG_IS_ENABLED(DM_PROBE_ASYNC)
+	struct list_head probe_node;
+#endif
 };
 
 /* Maximum sequence number supported */
@@ -165,9 +193,20 @@ static inline int dev_of_offset(const struct udevice *dev)
 	return ofnode_to_offset(dev->node);
 }
 
+/**
+ * dev_set_ofnode() - Set the device tree node of a device
+ *
+ * Use this rather than setting dev->node directly, so that the device can be
+ * found by its new node.
+ *
+ * @dev:	Device to update
+ * @node:	New node for the device
+ */
+void dev_set_ofnode(struct udevice *dev, ofnode node);
+
 static inline void dev_set_of_offset(struct udevice *dev, int of_offset)
 {
-	dev->node = offset_to_ofnode(of_offset);
+	dev_set_ofnode(dev, offset_to_ofnode(of_offset));
 }
 
 static inline bool dev_has_of_node(struct udevice *dev)
@@ -44,6 +44,22 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id);
  */
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compat() - Find the driver for a compatible string
+ *
+ * This finds the first driver in the linker list which has @compat in its
+ * of_match table. If CONFIG_DM_COMPAT_HASH is enabled, a hash table is used
+ * to speed this up, falling back to searching all drivers if there is not
+ * enough memory for it.
+ *
+ * @compat:	Compatible string to look up
+ * @drvp:	Returns the driver
+ * @idp:	Returns the matching entry in the driver's of_match table
+ * @return 0 if found, -ENOENT if no driver has this compatible string
+ */
+int lists_driver_lookup_compat(const char *compat, struct driver **drvp,
+			       const struct udevice_id **idp);
+
 /**
  * lists_bind_fdt() - bind a device tree node
  *
@@ -39,6 +39,9 @@ struct property {
  * @parent: Pointer to parent node, or NULL if this is the root node
  * @child: Pointer to head of child node list, or NULL if no children
  * @sibling: Pointer to the next sibling node, or NULL if this is the last
+ * @prop_hash: Hash table of properties by name, or NULL to search the list.
+ *	This is only set up for nodes with many properties.
+ * @prop_hash_mask: Number of slots in @prop_hash - 1
  */
 struct device_node {
 	const char *name;
@@ -50,8 +53,13 @@ struct device_node {
 	struct device_node *parent;
 	struct device_node *child;
 	struct device_node *sibling;
+	struct property **prop_hash;
+	uint prop_hash_mask;
 };
 
+/* Minimum number of properties for a node to have a hash table */
+#define OF_PROP_HASH_MIN	8
+
 #define OF_MAX_PHANDLE_ARGS 16
 
 /**
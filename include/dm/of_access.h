@@ -209,6 +209,31 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 					       const char *propname,
 					       const void *propval,
 					       int proplen);
+/**
+ * of_prop_hash_init() - Set up the property hash table of a node
+ *
+ * This is used when building the live tree. Each property in the node's list
+ * is entered into @hash, so of_find_property() does not have to search the
+ * list.
+ *
+ * @np:		Node whose properties should be entered
+ * @hash:	Zeroed table with at least twice as many slots as the node has
+ *		properties
+ * @mask:	Number of slots in @hash - 1, where the number of slots is a
+ *		power of two
+ */
+void of_prop_hash_init(struct device_node *np, struct property **hash,
+		       uint mask);
+
+/**
+ * of_populate_phandle_cache() - Set up a cache of nodes by phandle
+ *
+ * This lets of_find_node_by_phandle() find most nodes without searching the
+ * whole tree. It is called when the live tree is built. If there is not
+ * enough memory, nodes are found by searching instead.
+ */
+void of_populate_phandle_cache(void);
+
 /**
  * of_find_node_by_phandle() - Find a node given a phandle
  *
@@ -135,6 +135,7 @@ extern struct unit_test_state global_dm_test_state;
  * @testdev: Test device
  * @force_fail_alloc: Force all memory allocs to fail
  * @skip_post_probe: Skip uclass post-probe processing
+ * @fail_post_probe: Make uclass post-probe processing fail
  * @removed: Used to keep track of a device that was removed
  */
 struct dm_test_state {
@@ -142,6 +143,7 @@ struct dm_test_state {
 	struct udevice *testdev;
 	int force_fail_alloc;
 	int skip_post_probe;
+	int fail_post_probe;
 	struct udevice *removed;
 };
 
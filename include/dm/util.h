@@ -30,6 +30,9 @@ void dm_dump_all(void);
 /* Dump out a list of uclasses and their devices */
 void dm_dump_uclass(void);
 
+/* Dump out statistics on the device index */
+void dm_dump_stats(void);
+
 #ifdef CONFIG_DEBUG_DEVRES
 /* Dump out a list of device resources */
 void dm_dump_devres(void);
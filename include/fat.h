@@ -23,7 +23,18 @@
 #define DIRENTSPERCLUST	((mydata->clust_size * mydata->sect_size) / \
 			 sizeof(dir_entry))
 
+/*
+ * Number of FAT sectors held in the FAT buffer. This is kept a multiple of
+ * three so that FAT12 entries never straddle two buffer loads.
+ */
+#ifdef CONFIG_SPL_BUILD
 #define FATBUFBLOCKS	6
+#else
+#define FATBUFBLOCKS	CONFIG_FS_FAT_FATBUF_BLOCKS
+#if FATBUFBLOCKS % 3
+#error "CONFIG_FS_FAT_FATBUF_BLOCKS must be a multiple of 3"
+#endif
+#endif
 #define FATBUFSIZE	(mydata->sect_size * FATBUFBLOCKS)
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
@@ -200,6 +211,8 @@ int file_fat_write(const char *filename, void *buf, loff_t offset, loff_t len,
 		   loff_t *actwrite);
 int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 		  loff_t *actread);
+int fat_read_stream(const char *filename, void *buf, loff_t chunk,
+		    fs_read_stream_fn func, void *priv, loff_t *actread);
 int fat_opendir(const char *filename, struct fs_dir_stream **dirsp);
 int fat_readdir(struct fs_dir_stream *dirs, struct fs_dirent **dentp);
 void fat_closedir(struct fs_dir_stream *dirs);
@@ -648,6 +648,76 @@ int fdtdec_get_chosen_node(const void *blob, const char *name);
  */
 const char *fdtdec_get_compatible(enum fdt_compat_id id);
 
+#if CONFIG_IS_ENABLED(OF_FDT_CACHE)
+/**
+ * fdtdec_node_offset_by_phandle() - Find a node by phandle, using the cache
+ *
+ * This is the same as fdt_node_offset_by_phandle() but uses the lookup
+ * cache in global_data when @blob is the control device tree.
+ *
+ * @blob:	FDT blob
+ * @phandle:	Phandle to look up
+ * @return node offset if found, -ve error code on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle);
+
+/**
+ * fdtdec_path_offset() - Find a node by path or alias, using the cache
+ *
+ * This is the same as fdt_path_offset() but uses the lookup cache in
+ * global_data when @blob is the control device tree.
+ *
+ * @blob:	FDT blob
+ * @path:	Full path of the node, or an alias
+ * @return node offset if found, -ve error code on error
+ */
+int fdtdec_path_offset(const void *blob, const char *path);
+
+/**
+ * fdtdec_getprop() - Read a property, using the cache
+ *
+ * This is the same as fdt_getprop() but uses the lookup cache in
+ * global_data when @blob is the control device tree.
+ *
+ * @blob:	FDT blob
+ * @node:	Offset of the node containing the property
+ * @name:	Name of the property
+ * @lenp:	Returns the length of the property, or an error code if it is
+ *		not found (NULL to ignore)
+ * @return pointer to the property value, or NULL if not found
+ */
+const void *fdtdec_getprop(const void *blob, int node, const char *name,
+			   int *lenp);
+
+/**
+ * fdtdec_cache_invalidate() - Drop all cached lookups
+ *
+ * This must be called after changing the control device tree, unless the
+ * change only writes new values over existing ones. The fdtdec functions
+ * which add nodes and properties and the 'fdt' command call it themselves.
+ */
+void fdtdec_cache_invalidate(void);
+#else
+static inline int fdtdec_node_offset_by_phandle(const void *blob,
+						uint32_t phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+static inline int fdtdec_path_offset(const void *blob, const char *path)
+{
+	return fdt_path_offset(blob, path);
+}
+
+static inline const void *fdtdec_getprop(const void *blob, int node,
+					 const char *name, int *lenp)
+{
+	return fdt_getprop(blob, node, name, lenp);
+}
+
+static inline void fdtdec_cache_invalidate(void) {}
+#endif
+
 /* Look up a phandle and follow it to its node. Then return the offset
  * of that node.
  *
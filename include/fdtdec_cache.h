@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Cache of recent lookups in the flat device tree
+ */
+
+#ifndef __FDTDEC_CACHE_H
+#define __FDTDEC_CACHE_H
+
+/* Number of entries of each type in struct fdtdec_cache */
+#define FDTDEC_CACHE_PHANDLES	16
+#define FDTDEC_CACHE_PATHS	8
+#define FDTDEC_CACHE_PROPS	16
+
+/* Longest path which can be cached, including the terminator */
+#define FDTDEC_CACHE_PATH_LEN	32
+
+/**
+ * struct fdtdec_cache_phandle - Cached phandle lookup
+ *
+ * @phandle:	Phandle, or 0 if the entry is not used
+ * @offset:	Offset of the node with this phandle
+ */
+struct fdtdec_cache_phandle {
+	u32 phandle;
+	int offset;
+};
+
+/**
+ * struct fdtdec_cache_path - Cached path lookup
+ *
+ * @offset:	Offset of the node at this path
+ * @path:	Full path, or an empty string if the entry is not used
+ */
+struct fdtdec_cache_path {
+	int offset;
+	char path[FDTDEC_CACHE_PATH_LEN];
+};
+
+/**
+ * struct fdtdec_cache_prop - Cached property lookup
+ *
+ * The property name is not stored, since it can be read from the tree.
+ *
+ * @node:	Offset of the node containing the property
+ * @offset:	Offset of the property, or 0 if the entry is not used
+ */
+struct fdtdec_cache_prop {
+	int node;
+	int offset;
+};
+
+/**
+ * struct fdtdec_cache - Cache of recent lookups in the control device tree
+ *
+ * This lives in global_data so that it can be used before relocation and in
+ * SPL. Lookups by phandle and path otherwise have to scan the whole tree.
+ *
+ * The cache is dropped whenever the address of the tree or the size of its
+ * structure or strings block changes, and by the U-Boot code which writes to
+ * the control tree (see fdtdec_cache_invalidate()). As a further guard, each
+ * entry is checked before it is used: a node must still have the phandle or
+ * the last path component it was found by, and a property must still be
+ * one of the properties of its node. Aliases are not cached.
+ *
+ * @blob:	Device tree which the cache is for, or NULL if empty
+ * @size_struct: Size of the structure block of @blob when cached
+ * @size_strings: Size of the strings block of @blob when cached
+ * @next_phandle: Next entry in @phandle to replace
+ * @next_path:	Next entry in @path to replace
+ * @next_prop:	Next entry in @prop to replace
+ * @hits:	Number of lookups answered from the cache
+ * @misses:	Number of lookups which had to search the tree
+ * @phandle:	Recent phandle lookups
+ * @path:	Recent path lookups
+ * @prop:	Recent property lookups
+ */
+struct fdtdec_cache {
+	const void *blob;
+	u32 size_struct;
+	u32 size_strings;
+	u8 next_phandle;
+	u8 next_path;
+	u8 next_prop;
+	ulong hits;
+	ulong misses;
+	struct fdtdec_cache_phandle phandle[FDTDEC_CACHE_PHANDLES];
+	struct fdtdec_cache_path path[FDTDEC_CACHE_PATHS];
+	struct fdtdec_cache_prop prop[FDTDEC_CACHE_PROPS];
+};
+
+#endif
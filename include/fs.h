@@ -109,6 +109,36 @@ int fs_size(const char *filename, loff_t *size);
 int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	    loff_t *actread);
 
+/**
+ * typedef fs_read_stream_fn - handle one chunk read by fs_read_stream()
+ *
+ * @priv:	private data passed to fs_read_stream()
+ * @buf:	the data read
+ * @len:	number of bytes at @buf
+ * Return:	0 to go on reading, 1 to stop, -ve error to stop with an error
+ */
+typedef int (*fs_read_stream_fn)(void *priv, void *buf, loff_t len);
+
+/**
+ * fs_read_stream() - read a file one chunk at a time
+ *
+ * The file is read from the partition previously set by fs_set_blk_dev()
+ * into the buffer at @addr, @chunk bytes at a time, and @func is called for
+ * each chunk as soon as it has been read. Filesystems which support it carry
+ * on from where the previous chunk ended; others read each chunk at its
+ * offset in the file.
+ *
+ * @filename:	full path of the file to read from
+ * @addr:	address of the buffer to use, @chunk bytes
+ * @chunk:	number of bytes to read at a time
+ * @func:	function to call for each chunk
+ * @priv:	private data for @func
+ * @actread:	returns the number of bytes read
+ * Return:	0 if OK, -ve on error, including an error from @func
+ */
+int fs_read_stream(const char *filename, ulong addr, loff_t chunk,
+		   fs_read_stream_fn func, void *priv, loff_t *actread);
+
 /**
  * fs_write() - write file to the partition previously set by fs_set_blk_dev()
  *
@@ -206,6 +236,8 @@ int do_size(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
 int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
+int do_loadz(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
+	     int fstype);
 int do_ls(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
 int file_exists(const char *dev_type, const char *dev_part, const char *file,
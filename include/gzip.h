@@ -62,13 +62,19 @@ void gzwrite_progress_finish(int retcode, u64 totalwritten, u64 totalsize,
 /**
  * gzwrite() - decompress and write gzipped image from memory to block device
  *
+ * If CONFIG_ZSTD is enabled, zstd-compressed images are accepted too.
+ * Decompression of each buffer overlaps with writing the one before, if the
+ * device supports asynchronous requests. Buffers which are all zero are
+ * erased instead of written, if the device is an MMC device which leaves
+ * zeroes when erased and the buffers cover whole erase groups.
+ *
  * @src:	compressed image address
  * @len:	compressed image length in bytes
  * @dev:	block device descriptor
  * @szwritebuf:	bytes per write (pad to erase size)
  * @startoffs:	offset in bytes of first write
  * @szexpected:	expected uncompressed length, may be zero to use gzip trailer
- *		for files under 4GiB
+ *		for files under 4GiB, or the size in the zstd frame header
  * @return 0 if OK, -1 on error
  */
 int gzwrite(unsigned char *src, int len, struct blk_desc *dev, ulong szwritebuf,
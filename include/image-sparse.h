@@ -23,6 +23,16 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: erase blocks so that they read back as zero, returning
+	 * the number of blocks erased. This is only called for whole erase
+	 * groups of erase_grp blocks, and only if erase_grp is not zero.
+	 */
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+	uint		erase_grp;
+
 	void		(*mssg)(const char *str, char *response);
 };
 
@@ -303,6 +303,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -1090,6 +1091,74 @@ int fit_check_ramdisk(const void *fit, int os_noffset,
 int calculate_hash(const void *data, int data_len, const char *algo,
 			uint8_t *value, int *value_len);
 
+#ifndef USE_HOSTCC
+/**
+ * fit_verify_cache_begin() - start remembering digests
+ *
+ * Until the matching fit_verify_cache_end(), calculate_hash() reuses digests
+ * it has already calculated over the same data. Calls may be nested. Digests
+ * are looked up by the address and size of the data, so the caller must make
+ * sure that the data does not change in the meantime. Keep the pair around
+ * a single verification, not around code which loads or moves images.
+ */
+void fit_verify_cache_begin(void);
+
+/**
+ * fit_verify_cache_end() - stop remembering digests
+ *
+ * Everything remembered is dropped once the outermost caller is done.
+ */
+void fit_verify_cache_end(void);
+
+/**
+ * fit_digest_cache_get() - look up a digest already calculated
+ *
+ * @algo:	name of the hash algorithm, e.g. "sha256"
+ * @data:	data which was hashed
+ * @size:	number of bytes at @data
+ * @value:	returns the digest, FIT_MAX_HASH_LEN bytes at most
+ * @return length of the digest, or -ENOENT if it is not known
+ */
+int fit_digest_cache_get(const char *algo, const void *data, size_t size,
+			 uint8_t *value);
+
+/**
+ * fit_digest_cache_put() - remember a digest for later verification
+ *
+ * This does nothing outside a fit_verify_cache_begin()/end() pair. A loader
+ * which hashes data while reading it in can use this so that verifying the
+ * data afterwards does not need to hash it again.
+ *
+ * @algo:	name of the hash algorithm, e.g. "sha256"
+ * @data:	data which was hashed
+ * @size:	number of bytes at @data
+ * @value:	digest of the data
+ * @value_len:	length of the digest
+ */
+void fit_digest_cache_put(const char *algo, const void *data, size_t size,
+			  const uint8_t *value, int value_len);
+#else
+static inline int fit_digest_cache_get(const char *algo, const void *data,
+				       size_t size, uint8_t *value)
+{
+	return -1;
+}
+
+static inline void fit_digest_cache_put(const char *algo, const void *data,
+					size_t size, const uint8_t *value,
+					int value_len)
+{
+}
+
+static inline void fit_verify_cache_begin(void)
+{
+}
+
+static inline void fit_verify_cache_end(void)
+{
+}
+#endif
+
 /*
  * At present we only support signing on the host, and verification on the
  * device
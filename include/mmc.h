@@ -70,6 +70,7 @@
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+#define MMC_CAP_CMD23		BIT(17)	/* SET_BLOCK_COUNT for multi-block */
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -78,6 +79,8 @@
 
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_CMD23_SUPPORT	0x00000002
+#define SD_DATA_STAT_AFTER_ERASE	0x00800000
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -223,6 +226,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_ERASE_GROUP_DEF		175	/* R/W */
 #define EXT_CSD_BOOT_BUS_WIDTH		177
 #define EXT_CSD_PART_CONF		179	/* R/W */
+#define EXT_CSD_ERASED_MEM_CONT		181	/* RO */
 #define EXT_CSD_BUS_WIDTH		183	/* R/W */
 #define EXT_CSD_STROBE_SUPPORT		184	/* R/W */
 #define EXT_CSD_HS_TIMING		185	/* R/W */
@@ -299,6 +303,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_ENH_GP(x)	(1 << ((x)+1))	/* GP part (x+1) is enhanced */
 
 #define EXT_CSD_HS_CTRL_REL	(1 << 0)	/* host controlled WR_REL_SET */
+#define EXT_CSD_EN_REL_WR	(1 << 2)	/* enhanced reliable write */
 
 #define EXT_CSD_WR_DATA_REL_USR		(1 << 0)	/* user data area WR_REL */
 #define EXT_CSD_WR_DATA_REL_GP(x)	(1 << ((x)+1))	/* GP part (x+1) WR_REL */
@@ -359,6 +364,9 @@ enum mmc_voltage {
  */
 struct mmc_uclass_priv {
 	struct mmc *mmc;
+	struct mmc_data *async_data;	/* transfer from start_cmd(), if busy */
+	bool async_stop;		/* send CMD12 when it finishes */
+	int async_ret;			/* result of the last such transfer */
 };
 
 /**
@@ -476,6 +484,33 @@ struct dm_mmc_ops {
 	 * @return 0 if not present, 1 if present, -ve on error
 	 */
 	int (*host_power_cycle)(struct udevice *dev);
+
+	/**
+	 * start_cmd() - Send a command and start its data transfer
+	 *
+	 * This is like send_cmd() except that it returns once the response
+	 * has been received, leaving the transfer of @data to go on in the
+	 * background (e.g. by DMA). Use poll_cmd() to find out when it is
+	 * done. No other command may be sent until then.
+	 *
+	 * @dev:	Device to receive the command
+	 * @cmd:	Command to send
+	 * @data:	Data to send/receive
+	 * @return 0 if OK, -ENOSYS if the host cannot do this (e.g. it is not
+	 * set up for DMA), other -ve on error
+	 */
+	int (*start_cmd)(struct udevice *dev, struct mmc_cmd *cmd,
+			 struct mmc_data *data);
+
+	/**
+	 * poll_cmd() - Check on a data transfer started by start_cmd()
+	 *
+	 * @dev:	Device to check
+	 * @data:	Data passed to start_cmd()
+	 * @return 0 if the transfer is complete, -EBUSY if it is still going,
+	 * other -ve on error (the transfer is then abandoned)
+	 */
+	int (*poll_cmd)(struct udevice *dev, struct mmc_data *data);
 };
 
 #define mmc_get_ops(dev)        ((struct dm_mmc_ops *)(dev)->driver->ops)
@@ -489,6 +524,30 @@ int dm_mmc_execute_tuning(struct udevice *dev, uint opcode);
 int dm_mmc_wait_dat0(struct udevice *dev, int state, int timeout_us);
 int dm_mmc_host_power_cycle(struct udevice *dev);
 
+/**
+ * dm_mmc_start_cmd() - Send a command and start its data transfer
+ *
+ * See start_cmd() in struct dm_mmc_ops. Any later command first waits for
+ * the transfer to finish. A multi-block transfer is preceded by CMD23 if the
+ * host and card support it, otherwise CMD12 is sent automatically after it.
+ *
+ * @dev:	MMC device
+ * @cmd:	Command to send
+ * @data:	Data to send/receive
+ * @return 0 if OK, -ENOSYS if not supported, other -ve on error
+ */
+int dm_mmc_start_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+		     struct mmc_data *data);
+
+/**
+ * dm_mmc_poll_cmd() - Check on a transfer started by dm_mmc_start_cmd()
+ *
+ * @dev:	MMC device
+ * @return 0 if the last transfer completed, -EBUSY if it is still going,
+ * other -ve if it failed
+ */
+int dm_mmc_poll_cmd(struct udevice *dev);
+
 /* Transition functions for compatibility */
 int mmc_set_ios(struct mmc *mmc);
 int mmc_getcd(struct mmc *mmc);
@@ -583,6 +642,36 @@ static inline bool supports_uhs(uint caps)
 #endif
 }
 
+#define MMC_MODE_CACHE_SIZE	4
+
+/**
+ * struct mmc_mode_cache_entry - Bus mode selected for a card
+ *
+ * @cid:	CID of the card
+ * @mode:	Bus mode (enum bus_mode)
+ * @bus_width:	Bus width (1, 4 or 8), 0 if this entry is not in use
+ */
+struct mmc_mode_cache_entry {
+	u32 cid[4];
+	u8 mode;
+	u8 bus_width;
+	u8 spare[2];
+};
+
+/**
+ * struct mmc_mode_cache - Bus modes selected for recently seen cards
+ *
+ * This is kept in the bloblist with tag BLOBLISTT_MMC_MODE, so that the same
+ * card can be set up quickly by a later phase of U-Boot.
+ *
+ * @next:	Index of the entry to replace next
+ * @entry:	Entries, one for each card
+ */
+struct mmc_mode_cache {
+	u32 next;
+	struct mmc_mode_cache_entry entry[MMC_MODE_CACHE_SIZE];
+};
+
 /*
  * With CONFIG_DM_MMC enabled, struct mmc can be accessed from the MMC device
  * with mmc_get_mmc_dev().
@@ -774,6 +863,15 @@ int board_mmc_getwp(struct mmc *mmc);
 #endif
 
 int mmc_set_dsr(struct mmc *mmc, u16 val);
+
+/**
+ * mmc_erased_is_zero() - check whether erased blocks read back as zero
+ *
+ * @mmc:	MMC device
+ * @return true if blocks erased by mmc_berase() read back as zero, false if
+ * they read back as ones or this is not known
+ */
+bool mmc_erased_is_zero(struct mmc *mmc);
 /* Function to change the size of boot partition and rpmb partitions */
 int mmc_boot_partition_size_change(struct mmc *mmc, unsigned long bootsize,
 					unsigned long rpmbsize);
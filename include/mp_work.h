@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Running independent work items on secondary CPUs
+ *
+ * U-Boot itself only ever runs on the boot CPU. This allows a piece of work
+ * which splits into independent items (such as the blocks of a compressed
+ * image) to be spread over the other CPUs as well. The secondary CPUs are
+ * woken for each call to mp_work_run() and parked again before it returns,
+ * so they are always left as the OS expects to find them.
+ */
+
+#ifndef __MP_WORK_H
+#define __MP_WORK_H
+
+/**
+ * mp_work_func - carry out one work item
+ *
+ * This may run on any CPU, at the same time as other work items, so must
+ * only touch memory belonging to this item. It must not allocate memory,
+ * print or use devices.
+ *
+ * @arg:	argument passed to mp_work_run()
+ * @index:	index of the work item (0 to count - 1)
+ * @cpu:	number of the CPU running this item, from 0 (the boot CPU) to
+ *		mp_work_max_cpus() - 1. Use this to find any scratch memory
+ *		set up by the caller.
+ * @return 0 if OK, -ve on error
+ */
+typedef int (*mp_work_func)(void *arg, int index, int cpu);
+
+/**
+ * mp_work_max_cpus() - get the number of CPUs which may run work items
+ *
+ * @return number of CPUs, including the boot CPU (so at least 1)
+ */
+int mp_work_max_cpus(void);
+
+/**
+ * mp_work_run() - run a number of work items, using all available CPUs
+ *
+ * Each item is run once. The boot CPU takes part, so this still works
+ * (serially) if there are no secondary CPUs.
+ *
+ * @func:	function to run for each item
+ * @arg:	argument to pass to @func
+ * @count:	number of work items
+ * @return 0 if OK, else the error returned by one of the items
+ */
+int mp_work_run(mp_work_func func, void *arg, int count);
+
+/**
+ * mp_work_secondary() - run work items on a secondary CPU
+ *
+ * This is called by each secondary CPU woken by arch_mp_work_start(). It
+ * returns when all the work items are finished, after which the CPU must
+ * be parked again.
+ */
+void mp_work_secondary(void);
+
+/* Architecture interface, with weak versions which use only the boot CPU */
+
+/**
+ * arch_mp_work_max() - get the number of secondary CPUs which can be used
+ *
+ * @return number of CPUs which arch_mp_work_start() may wake
+ */
+int arch_mp_work_max(void);
+
+/**
+ * arch_mp_work_start() - wake the secondary CPUs
+ *
+ * Each CPU which is woken must call mp_work_secondary() and then park
+ * itself.
+ *
+ * @return number of CPUs woken
+ */
+int arch_mp_work_start(void);
+
+/**
+ * arch_mp_work_stop() - wait for the secondary CPUs to park themselves
+ *
+ * This is called once all work items are finished, if arch_mp_work_start()
+ * woke any CPUs.
+ */
+void arch_mp_work_stop(void);
+
+#endif
@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client, enough to fetch a file over a single connection
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+#include <net.h>
+
+/*
+ * IP and TCP header, without TCP options
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* sequence number		*/
+	u32		tcp_ack;	/* acknowledgment number	*/
+	u8		tcp_hlen;	/* header length in words << 4	*/
+	u8		tcp_flags;	/* control flags		*/
+	u16		tcp_win;	/* receive window		*/
+	u16		tcp_xsum;	/* checksum			*/
+	u16		tcp_urg;	/* urgent pointer		*/
+} __attribute__((packed));
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+/* TCP control flags */
+#define TCP_FIN			0x01
+#define TCP_SYN			0x02
+#define TCP_RST			0x04
+#define TCP_PSH			0x08
+#define TCP_ACK			0x10
+
+/* TCP options */
+#define TCP_OPT_EOL		0
+#define TCP_OPT_NOP		1
+#define TCP_OPT_MSS		2
+#define TCP_OPT_WS		3
+
+/* Largest segment we accept, for a 1500 byte Ethernet MTU */
+#define TCP_MSS			(1500 - IP_TCP_HDR_SIZE)
+
+/* Number of out-of-order segments held until the gap before them is filled */
+#define TCP_OOO_SEGS		16
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_CLOSE_WAIT,
+};
+
+/**
+ * enum tcp_event - events reported to the user of the connection
+ *
+ * @TCP_EV_CONNECTED:	the connection is established
+ * @TCP_EV_DATA:	data has been received, in order
+ * @TCP_EV_CLOSED:	the remote end has closed the connection
+ * @TCP_EV_ABORTED:	the connection was reset or timed out
+ */
+enum tcp_event {
+	TCP_EV_CONNECTED,
+	TCP_EV_DATA,
+	TCP_EV_CLOSED,
+	TCP_EV_ABORTED,
+};
+
+/**
+ * rxhand_tcp_f - handler for TCP events
+ *
+ * @event:	event which occurred
+ * @data:	received data, for TCP_EV_DATA
+ * @len:	number of bytes at @data
+ */
+typedef void rxhand_tcp_f(enum tcp_event event, const uchar *data,
+			  unsigned int len);
+
+/**
+ * net_set_tcp_handler() - set the handler for TCP events
+ *
+ * @f:		handler to call, or NULL to drop any connection
+ */
+void net_set_tcp_handler(rxhand_tcp_f *f);
+
+/**
+ * tcp_connect() - open a connection
+ *
+ * This sends the SYN; the handler is called with TCP_EV_CONNECTED once the
+ * remote end answers. The connection then owns the net_loop() timeout
+ * handler until it is closed.
+ *
+ * @dest:	IP address to connect to
+ * @dport:	TCP port to connect to
+ */
+void tcp_connect(struct in_addr dest, int dport);
+
+/**
+ * tcp_send() - send data on an established connection
+ *
+ * The data is kept for retransmission until it is acknowledged. Only one
+ * segment may be outstanding at a time.
+ *
+ * @data:	data to send
+ * @len:	number of bytes to send, at most TCP_MSS
+ * @return 0 if OK, -EBUSY if data is still unacknowledged, -EINVAL if
+ * the connection is not established or @len is too large
+ */
+int tcp_send(const void *data, unsigned int len);
+
+/**
+ * tcp_close() - close the connection
+ *
+ * A FIN is sent and the connection forgotten, without waiting for the
+ * remote end to acknowledge it.
+ */
+void tcp_close(void);
+
+/**
+ * tcp_get_state() - get the state of the connection
+ *
+ * @return state of the connection
+ */
+enum tcp_state tcp_get_state(void);
+
+/**
+ * tcp_checksum() - compute the TCP checksum of a segment
+ *
+ * @src:	source IP address
+ * @dest:	destination IP address
+ * @seg:	TCP header and payload
+ * @len:	number of bytes at @seg
+ * @return checksum to store in the header, or 0 if @seg already holds a
+ * correct checksum
+ */
+unsigned int tcp_checksum(struct in_addr src, struct in_addr dest,
+			  const void *seg, unsigned int len);
+
+/**
+ * tcp_set_tcp_header() - fill in the IP and TCP headers of a packet
+ *
+ * Called by net_send_ip_packet(). The payload must already be in place
+ * after the IP and TCP headers; a SYN carries options and no payload.
+ *
+ * @pkt:	start of the IP header
+ * @dest:	destination IP address
+ * @dport:	destination port
+ * @sport:	source port
+ * @payload_len: number of bytes of payload
+ * @action:	TCP control flags
+ * @tcp_seq_num: sequence number
+ * @tcp_ack_num: acknowledgment number
+ * @return size of the IP and TCP headers, including options
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+
+/**
+ * tcp_receive() - process a received TCP packet
+ *
+ * @ip:		IP header of the packet
+ * @len:	length of the IP packet
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, unsigned int len);
+
+#endif /* __TCP_H__ */
@@ -6,9 +6,14 @@
 #ifndef __SANDBOX_BLOCK_DEV__
 #define __SANDBOX_BLOCK_DEV__
 
+#include <linux/list.h>
+
 struct host_block_dev {
 #ifndef CONFIG_BLK
 	struct blk_desc blk_dev;
+#else
+	struct list_head reqs;	/* asynchronous requests not yet done */
+	int req_count;		/* number of entries in reqs */
 #endif
 	char *filename;
 	int fd;
@@ -271,15 +271,10 @@ struct sdhci_ops {
 
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 #define ADMA_MAX_LEN	65532
-#ifdef CONFIG_DMA_ADDR_T_64BIT
-#define ADMA_DESC_LEN	16
-#else
-#define ADMA_DESC_LEN	8
-#endif
-#define ADMA_TABLE_NO_ENTRIES (CONFIG_SYS_MMC_MAX_BLK_COUNT * \
-			       MMC_MAX_BLOCK_LEN) / ADMA_MAX_LEN
-
-#define ADMA_TABLE_SZ (ADMA_TABLE_NO_ENTRIES * ADMA_DESC_LEN)
+#define ADMA_DESC_LEN	8	/* 32-bit descriptor */
+#define ADMA64_DESC_LEN	12	/* 64-bit (96-bit) descriptor */
+/* The block count register is 16 bits, so this is the most in one go */
+#define ADMA_MAX_BLK_COUNT	min(CONFIG_SYS_MMC_MAX_BLK_COUNT, 65535)
 
 /* Decriptor table defines */
 #define ADMA_DESC_ATTR_VALID		BIT(0)
@@ -330,7 +325,10 @@ struct sdhci_host {
 	dma_addr_t adma_addr;
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	struct sdhci_adma_desc *adma_desc_table;
+	uint desc_sz;		/* size of each descriptor in bytes */
+	uint desc_count;	/* number of descriptors in the table */
 	uint desc_slot;
+	ulong data_start;	/* time the last data transfer started (ms) */
 #endif
 };
 
@@ -80,6 +80,63 @@ uint32_t crc32_wd(uint32_t crc, const unsigned char *buf, uint len,
  */
 uint32_t crc32_no_comp(uint32_t crc, const unsigned char *buf, uint len);
 
+/**
+ * crc32_no_comp_generic() - Calculate the CRC32 using only the portable code
+ *
+ * This is crc32_no_comp() without CPU-specific instructions. It is safe to
+ * call from EFI runtime services.
+ *
+ * @crc: Input crc to chain from a previous calculation
+ * @buf: Bytes to checksum
+ * @len: Number of bytes to checksum
+ * @return checksum value
+ */
+uint32_t crc32_no_comp_generic(uint32_t crc, const unsigned char *buf,
+			       uint len);
+
+/**
+ * struct crc32_backend - an implementation of CRC32 and perhaps CRC32C
+ *
+ * Both functions work like crc32_no_comp(), without one's complement.
+ *
+ * @name:	name of the implementation, e.g. "pclmul"
+ * @probe:	returns non-zero if the CPU can run this implementation, or
+ *		NULL if it always can
+ * @crc32:	calculates a CRC32 with the polynomial used by zlib
+ * @crc32c:	calculates a CRC32C (Castagnoli polynomial), or NULL if
+ *		this implementation cannot
+ */
+struct crc32_backend {
+	const char *name;
+	int (*probe)(void);
+	uint32_t (*crc32)(uint32_t crc, const unsigned char *buf, uint len);
+	uint32_t (*crc32c)(uint32_t crc, const unsigned char *buf, uint len);
+};
+
+/* ARMv8 CRC32 instructions, in arch/arm/cpu/armv8/ */
+extern const struct crc32_backend crc32_armv8;
+
+/* x86 PCLMULQDQ and SSE4.2, in arch/x86/lib/ */
+extern const struct crc32_backend crc32_x86_pclmul;
+
+/**
+ * crc32_get_backend() - Get an implementation of CRC32
+ *
+ * The implementations are in order of preference. The last one is the
+ * portable code, which is always available.
+ *
+ * @index: 0 for the preferred implementation, 1 for the next, etc.
+ * @return the implementation, or NULL if @index is past the last one
+ */
+const struct crc32_backend *crc32_get_backend(int index);
+
+/**
+ * crc32_best_backend() - Get the preferred implementation the CPU supports
+ *
+ * @return the implementation used by crc32() and crc32_no_comp()
+ */
+const struct crc32_backend *crc32_best_backend(void);
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
@@ -93,6 +150,9 @@ void crc32_wd_buf(const uint8_t *input, uint ilen, uint8_t *output,
 
 /* lib/crc32c.c */
 
+/* Bit-reflected Castagnoli polynomial, as passed to crc32c_init() */
+#define CRC32C_POLY	0x82f63b78
+
 /**
  * crc32c_init() - Set up a the CRC32 table
  *
@@ -107,7 +167,8 @@ void crc32c_init(uint32_t *crc32c_table, uint32_t pol);
  * crc32c_cal() - Perform CRC32 on a buffer given a table
  *
  * This algorithm uses the table (set up by crc32c_init() to speed up
- * processing.
+ * processing. If the table is for the Castagnoli polynomial and the CPU has
+ * instructions for it, they are used instead.
  *
  * @crc: Previous crc (use 0 at start)
  * @data: Data bytes to checksum
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Alternative implementations of the SHA-1 and SHA-256 block functions
+ */
+
+#ifndef _SHA_BACKEND_H
+#define _SHA_BACKEND_H
+
+/**
+ * struct sha_backend - an implementation of a SHA block function
+ *
+ * The portable C code has a NULL @blocks, and is always available.
+ *
+ * @name:	name of the implementation, e.g. "armv8-ce"
+ * @probe:	returns non-zero if the CPU can run @blocks
+ * @blocks:	hashes @count 64-byte blocks at @data into @state, which
+ *		holds the words of the digest in CPU order
+ */
+struct sha_backend {
+	const char *name;
+	int (*probe)(void);
+	void (*blocks)(uint32_t *state, const uint8_t *data,
+		       unsigned int count);
+};
+
+/* ARMv8 Crypto Extensions, in arch/arm/cpu/armv8/ */
+extern const struct sha_backend sha1_armv8_ce;
+extern const struct sha_backend sha256_armv8_ce;
+
+/* x86 SHA extensions, in arch/x86/lib/ */
+extern const struct sha_backend sha1_x86_shani;
+extern const struct sha_backend sha256_x86_shani;
+
+#endif /* _SHA_BACKEND_H */
@@ -14,6 +14,8 @@
 #ifndef _SHA1_H
 #define _SHA1_H
 
+#include <u-boot/sha-backend.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -32,11 +34,31 @@ typedef struct
     unsigned long total[2];	/*!< number of bytes processed	*/
     unsigned long state[5];	/*!< intermediate digest state	*/
     unsigned char buffer[64];	/*!< data block being processed */
+    const struct sha_backend *backend;	/*!< NULL for the C code */
 }
 sha1_context;
 
 /**
- * \brief	   SHA-1 context setup
+ * \brief	   Get an implementation of SHA-1, in order of preference;
+ *		   the last one is the C code, which is always available
+ *
+ * \param index	   0 for the preferred implementation, 1 for the next...
+ * \return	   the implementation, or NULL after the last one
+ */
+const struct sha_backend *sha1_get_backend(int index);
+
+/**
+ * \brief	   SHA-1 context setup, with a given implementation
+ *
+ * \param ctx	   SHA-1 context to be initialized
+ * \param backend  implementation to use, which the CPU must support
+ */
+void sha1_starts_backend(sha1_context *ctx,
+			 const struct sha_backend *backend);
+
+/**
+ * \brief	   SHA-1 context setup, with the preferred implementation
+ *		   the CPU supports
  *
  * \param ctx	   SHA-1 context to be initialized
  */
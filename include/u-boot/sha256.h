@@ -1,6 +1,8 @@
 #ifndef _SHA256_H
 #define _SHA256_H
 
+#include <u-boot/sha-backend.h>
+
 #define SHA256_SUM_LEN	32
 #define SHA256_DER_LEN	19
 
@@ -13,8 +15,30 @@ typedef struct {
 	uint32_t total[2];
 	uint32_t state[8];
 	uint8_t buffer[64];
+	const struct sha_backend *backend;	/* NULL for the C code */
 } sha256_context;
 
+/**
+ * sha256_get_backend() - get an implementation of SHA-256
+ *
+ * The implementations are in order of preference. The last one is the
+ * portable C code, which is always available.
+ *
+ * @index:	0 for the preferred implementation, 1 for the next, etc.
+ * @return the implementation, or NULL if @index is past the last one
+ */
+const struct sha_backend *sha256_get_backend(int index);
+
+/**
+ * sha256_starts_backend() - start hashing with a given implementation
+ *
+ * @ctx:	context to set up
+ * @backend:	implementation to use, which the CPU must support
+ */
+void sha256_starts_backend(sha256_context *ctx,
+			   const struct sha_backend *backend);
+
+/* Start hashing with the preferred implementation the CPU supports */
 void sha256_starts(sha256_context * ctx);
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length);
 void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
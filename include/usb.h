@@ -918,6 +918,18 @@ int usb_setup_ehci_gadget(struct ehci_ctrl **ctlrp);
  */
 void usb_stor_reset(void);
 
+/**
+ * usb_probe_async() - Start probing slow USB controllers in the background
+ *
+ * This starts probing each controller whose driver has DM_FLAG_PROBE_ASYNC
+ * with device_probe_async(), so that the controllers wait for their
+ * hardware at the same time as each other and as the rest of the boot.
+ * usb_init() calls this itself and then waits for each controller.
+ *
+ * @return 0 if OK, -ve on error
+ */
+int usb_probe_async(void);
+
 #else /* !CONFIG_IS_ENABLED(DM_USB) */
 
 struct usb_device *usb_get_dev_index(int index);
@@ -89,6 +89,7 @@ struct vring {
  * @index: the zero-based ordinal number for this queue
  * @num_free: number of elements we expect to be able to fit
  * @vring: actual memory layout for this queue
+ * @indirect: we can use indirect descriptor tables
  * @event: host publishes avail event idx
  * @free_head: head of free buffer list
  * @num_added: number we've added since last sync
@@ -102,6 +103,7 @@ struct virtqueue {
 	unsigned int index;
 	unsigned int num_free;
 	struct vring vring;
+	bool indirect;
 	bool event;
 	unsigned int free_head;
 	unsigned int num_added;
@@ -170,6 +172,9 @@ struct virtio_sg;
  * @in_sgs:	the number of scatterlists which are writable
  *		(after readable ones)
  *
+ * If indirect descriptors were negotiated, several scatterlists take up
+ * only one entry in the ring.
+ *
  * Caller must ensure we don't call this with other virtqueue operations
  * at the same time (except where noted).
  *
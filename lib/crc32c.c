@@ -12,10 +12,18 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <u-boot/crc.h>
 
 uint32_t crc32c_cal(uint32_t crc, const char *data, int length,
 		    uint32_t *crc32c_table)
 {
+	const struct crc32_backend *backend = crc32_best_backend();
+
+	/* entry 0x80 of a bit-reflected table is the polynomial */
+	if (backend->crc32c && crc32c_table[0x80] == CRC32C_POLY)
+		return backend->crc32c(crc, (const unsigned char *)data,
+				       length);
+
 	while (length--)
 		crc = crc32c_table[(u8)(crc ^ *data++)] ^ (crc >> 8);
 
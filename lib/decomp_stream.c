@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Streaming decompression into a fixed output buffer
+ *
+ * The output buffer is the final destination of the data, so both
+ * decompressors can refer back to earlier output directly and no window is
+ * kept. gzip uses zlib's own stream interface. zstd uses the bufferless
+ * interface: each block is decoded straight from the caller's data when it
+ * is all there, otherwise it is collected in a staging buffer first.
+ *
+ * Data made up of several zstd frames, each giving its size, can also be
+ * decompressed a frame per CPU when it is all in memory.
+ */
+
+#include <common.h>
+#include <decomp_stream.h>
+#include <image.h>
+#include <malloc.h>
+#include <mp_work.h>
+#include <linux/zstd.h>
+#include <asm/unaligned.h>
+#include <u-boot/zlib.h>
+
+#if CONFIG_IS_ENABLED(ZSTD)
+/*
+ * Largest piece of input the bufferless decoder asks for at once: a block
+ * and its header. Skippable frames may ask for more and are only supported
+ * when passed in a single piece.
+ */
+#define ZSTD_STAGE_SIZE		(ZSTD_BLOCKSIZE_ABSOLUTEMAX + 3)
+
+struct zstd_priv {
+	ZSTD_DCtx *dctx;
+	void *workspace;
+	u8 *stage;
+	ulong fill;
+	bool trailing;		/* the rest of the data is not zstd */
+};
+
+static bool zstd_is_frame(const u8 *p)
+{
+	u32 magic = get_unaligned_le32(p);
+
+	return magic == ZSTD_MAGICNUMBER ||
+	       (magic & 0xfffffff0) == ZSTD_MAGIC_SKIPPABLE_START;
+}
+
+static int zstd_stream_init(struct decomp_stream *ds)
+{
+	struct zstd_priv *priv;
+	size_t wsize;
+
+	priv = calloc(1, sizeof(*priv));
+	if (!priv)
+		return -ENOMEM;
+	ds->priv = priv;
+
+	wsize = ZSTD_DCtxWorkspaceBound();
+	priv->workspace = malloc(wsize);
+	priv->stage = malloc(ZSTD_STAGE_SIZE);
+	if (!priv->workspace || !priv->stage)
+		return -ENOMEM;
+	priv->dctx = ZSTD_initDCtx(priv->workspace, wsize);
+	if (!priv->dctx || ZSTD_isError(ZSTD_decompressBegin(priv->dctx)))
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int zstd_stream_write(struct decomp_stream *ds, const u8 *src,
+			     ulong len)
+{
+	struct zstd_priv *priv = ds->priv;
+	const u8 *in;
+	size_t need, ret;
+	ulong n;
+
+	while (len && !priv->trailing) {
+		need = ZSTD_nextSrcSizeToDecompress(priv->dctx);
+		if (!need) {
+			/* Another frame may follow, as written by pzstd */
+			ZSTD_decompressBegin(priv->dctx);
+			continue;
+		}
+		if (!priv->fill && len >= need) {
+			in = src;
+			src += need;
+			len -= need;
+		} else {
+			if (need > ZSTD_STAGE_SIZE)
+				return -EINVAL;
+			n = min_t(ulong, need - priv->fill, len);
+			memcpy(priv->stage + priv->fill, src, n);
+			priv->fill += n;
+			src += n;
+			len -= n;
+			if (priv->fill < need)
+				break;
+			in = priv->stage;
+			priv->fill = 0;
+		}
+		if (ds->done) {
+			/* Anything but another frame is ignored */
+			if (!zstd_is_frame(in)) {
+				priv->trailing = true;
+				break;
+			}
+			ds->done = false;
+		}
+		ret = ZSTD_decompressContinue(priv->dctx, ds->dst + ds->out_len,
+					      ds->dst_size - ds->out_len, in,
+					      need);
+		if (ZSTD_isError(ret)) {
+			debug("%s: zstd error %d\n", __func__,
+			      ZSTD_getErrorCode(ret));
+			if (ZSTD_getErrorCode(ret) == ZSTD_error_dstSize_tooSmall)
+				return -ENOSPC;
+			return -EINVAL;
+		}
+		ds->out_len += ret;
+		if (!ZSTD_nextSrcSizeToDecompress(priv->dctx))
+			ds->done = true;
+	}
+
+	return 0;
+}
+
+static void zstd_stream_free(struct decomp_stream *ds)
+{
+	struct zstd_priv *priv = ds->priv;
+
+	if (priv) {
+		free(priv->stage);
+		free(priv->workspace);
+	}
+	free(priv);
+}
+
+#if CONFIG_IS_ENABLED(MP_WORK)
+struct zstd_mp_frame {
+	const void *in;
+	size_t in_len;
+	void *out;
+	size_t out_len;
+};
+
+struct zstd_mp {
+	struct zstd_mp_frame *frames;
+	void *workspace;	/* one for each CPU */
+	size_t wsize;
+};
+
+static int zstd_mp_frame(void *arg, int index, int cpu)
+{
+	struct zstd_mp *mp = arg;
+	struct zstd_mp_frame *frame = &mp->frames[index];
+	ZSTD_DCtx *dctx;
+	size_t ret;
+
+	dctx = ZSTD_initDCtx(mp->workspace + cpu * mp->wsize, mp->wsize);
+	if (!dctx)
+		return -ENOMEM;
+	ret = ZSTD_decompressDCtx(dctx, frame->out, frame->out_len, frame->in,
+				  frame->in_len);
+	if (ZSTD_isError(ret) || ret != frame->out_len)
+		return -EINVAL;
+
+	return 0;
+}
+
+/*
+ * Find the frames in @src, filling in @frames if not NULL. Each must give
+ * its decompressed size so that it is known where its output goes.
+ * Returns the number of frames, or -EAGAIN if they cannot be used.
+ */
+static int zstd_mp_scan(const u8 *src, ulong src_len, void *dst,
+			ulong dst_size, struct zstd_mp_frame *frames)
+{
+	ulong pos, out = 0;
+	int count = 0;
+	u64 usize;
+	size_t csize;
+
+	for (pos = 0; src_len - pos >= 4; pos += csize) {
+		const u8 *p = src + pos;
+
+		if (!zstd_is_frame(p))
+			break;
+		csize = ZSTD_findFrameCompressedSize(p, src_len - pos);
+		if (ZSTD_isError(csize) || csize > src_len - pos)
+			return -EAGAIN;
+		if (get_unaligned_le32(p) != ZSTD_MAGICNUMBER)
+			continue;	/* skippable frame */
+		usize = ZSTD_getFrameContentSize(p, src_len - pos);
+		if (usize == ZSTD_CONTENTSIZE_UNKNOWN ||
+		    usize == ZSTD_CONTENTSIZE_ERROR || usize > dst_size - out)
+			return -EAGAIN;
+		if (frames) {
+			frames[count].in = p;
+			frames[count].in_len = csize;
+			frames[count].out = dst + out;
+			frames[count].out_len = usize;
+		}
+		out += usize;
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * Decompress each frame on a different CPU. Returns -EAGAIN if the data is
+ * not suitable, in which case it should be decompressed in the normal way.
+ */
+static int zstd_mp_decompress(void *dst, ulong dst_size, const void *src,
+			      ulong src_len, ulong *lenp)
+{
+	struct zstd_mp mp;
+	int count, i, ret;
+
+	/* In-place decompression must go in order */
+	if (dst < src + src_len && src < dst + dst_size)
+		return -EAGAIN;
+	count = zstd_mp_scan(src, src_len, dst, dst_size, NULL);
+	if (count < 2)
+		return -EAGAIN;
+
+	mp.wsize = ZSTD_DCtxWorkspaceBound();
+	mp.frames = calloc(count, sizeof(*mp.frames));
+	mp.workspace = malloc(mp_work_max_cpus() * mp.wsize);
+	ret = -EAGAIN;
+	if (mp.frames && mp.workspace) {
+		zstd_mp_scan(src, src_len, dst, dst_size, mp.frames);
+		ret = mp_work_run(zstd_mp_frame, &mp, count);
+		if (ret) {
+			ret = -EAGAIN;
+		} else {
+			*lenp = 0;
+			for (i = 0; i < count; i++)
+				*lenp += mp.frames[i].out_len;
+		}
+	}
+	free(mp.workspace);
+	free(mp.frames);
+
+	return ret;
+}
+#endif /* MP_WORK */
+#endif /* ZSTD */
+
+#if CONFIG_IS_ENABLED(GZIP)
+static int gzip_stream_init(struct decomp_stream *ds)
+{
+	z_stream *s;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+	ds->priv = s;
+	s->zalloc = gzalloc;
+	s->zfree = gzfree;
+
+	/* Let zlib parse the gzip header and check the trailer */
+	if (inflateInit2(s, 16 + MAX_WBITS) != Z_OK) {
+		free(s);
+		ds->priv = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int gzip_stream_write(struct decomp_stream *ds, const u8 *src,
+			     ulong len)
+{
+	z_stream *s = ds->priv;
+	int r;
+
+	if (ds->done)
+		return 0;
+	s->next_in = (u8 *)src;
+	s->avail_in = len;
+	s->next_out = ds->dst + ds->out_len;
+	s->avail_out = ds->dst_size - ds->out_len;
+	r = inflate(s, Z_NO_FLUSH);
+	ds->out_len = (void *)s->next_out - ds->dst;
+	if (r == Z_STREAM_END) {
+		ds->done = true;
+		return 0;
+	}
+	if (r != Z_OK && r != Z_BUF_ERROR) {
+		debug("%s: inflate() returned %d\n", __func__, r);
+		return -EINVAL;
+	}
+
+	/* inflate() only stops early if the output buffer is full */
+	return s->avail_in ? -ENOSPC : 0;
+}
+
+static void gzip_stream_free(struct decomp_stream *ds)
+{
+	z_stream *s = ds->priv;
+
+	if (s) {
+		inflateEnd(s);
+		free(s);
+	}
+}
+#endif /* GZIP */
+
+int decomp_stream_detect(const void *src, ulong len)
+{
+	const u8 *p = src;
+
+	if (len >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+		return IH_COMP_GZIP;
+	if (len >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f &&
+	    p[3] == 0xfd)
+		return IH_COMP_ZSTD;
+
+	return IH_COMP_NONE;
+}
+
+int decomp_stream_init(struct decomp_stream *ds, int comp, void *dst,
+		       ulong dst_size)
+{
+	int ret;
+
+	memset(ds, '\0', sizeof(*ds));
+	ds->comp = comp;
+	ds->dst = dst;
+	ds->dst_size = dst_size;
+
+	switch (comp) {
+#if CONFIG_IS_ENABLED(GZIP)
+	case IH_COMP_GZIP:
+		ret = gzip_stream_init(ds);
+		break;
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD:
+		ret = zstd_stream_init(ds);
+		break;
+#endif
+	default:
+		return -ENOSYS;
+	}
+	if (ret)
+		decomp_stream_end(ds);
+
+	return ret;
+}
+
+int decomp_stream_write(struct decomp_stream *ds, const void *src, ulong len)
+{
+	switch (ds->comp) {
+#if CONFIG_IS_ENABLED(GZIP)
+	case IH_COMP_GZIP:
+		return gzip_stream_write(ds, src, len);
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD:
+		return zstd_stream_write(ds, src, len);
+#endif
+	default:
+		return -ENOSYS;
+	}
+}
+
+long decomp_stream_end(struct decomp_stream *ds)
+{
+	switch (ds->comp) {
+#if CONFIG_IS_ENABLED(GZIP)
+	case IH_COMP_GZIP:
+		gzip_stream_free(ds);
+		break;
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD:
+		zstd_stream_free(ds);
+		break;
+#endif
+	}
+	ds->priv = NULL;
+	if (!ds->done)
+		return -EINVAL;
+
+	return ds->out_len;
+}
+
+int decomp_stream_buf(int comp, void *dst, ulong dst_size, const void *src,
+		      ulong src_len, ulong *lenp)
+{
+	struct decomp_stream ds;
+	long len;
+	int ret;
+
+#if CONFIG_IS_ENABLED(ZSTD) && CONFIG_IS_ENABLED(MP_WORK)
+	if (comp == IH_COMP_ZSTD &&
+	    !zstd_mp_decompress(dst, dst_size, src, src_len, lenp))
+		return 0;
+#endif
+	ret = decomp_stream_init(&ds, comp, dst, dst_size);
+	if (ret)
+		return ret;
+	ret = decomp_stream_write(&ds, src, src_len);
+	len = decomp_stream_end(&ds);
+	if (ret)
+		return ret;
+	if (len < 0)
+		return len;
+	*lenp = len;
+
+	return 0;
+}
@@ -123,8 +123,10 @@ efi_status_t efi_init_runtime_supported(void)
 void __efi_runtime efi_update_table_header_crc32(struct efi_table_hdr *table)
 {
 	table->crc32 = 0;
-	table->crc32 = crc32(0, (const unsigned char *)table,
-			     table->headersize);
+	/* only the portable CRC code is in the runtime section */
+	table->crc32 = ~crc32_no_comp_generic(~0U,
+					      (const unsigned char *)table,
+					      table->headersize);
 }
 
 /**
@@ -90,7 +90,7 @@ fdt_addr_t fdtdec_get_addr_size_fixed(const void *blob, int node,
 
 	debug("%s: %s: ", __func__, prop_name);
 
-	prop = fdt_getprop(blob, node, prop_name, &len);
+	prop = fdtdec_getprop(blob, node, prop_name, &len);
 	if (!prop) {
 		debug("(not found)\n");
 		return FDT_ADDR_T_NONE;
@@ -191,7 +191,7 @@ int fdtdec_get_pci_vendev(const void *blob, int node, u16 *vendor, u16 *device)
 	const char *list, *end;
 	int len;
 
-	list = fdt_getprop(blob, node, "compatible", &len);
+	list = fdtdec_getprop(blob, node, "compatible", &len);
 	if (!list)
 		return -ENOENT;
 
@@ -245,7 +245,7 @@ uint64_t fdtdec_get_uint64(const void *blob, int node, const char *prop_name,
 	const unaligned_fdt64_t *cell64;
 	int length;
 
-	cell64 = fdt_getprop(blob, node, prop_name, &length);
+	cell64 = fdtdec_getprop(blob, node, prop_name, &length);
 	if (!cell64 || length < sizeof(*cell64))
 		return default_val;
 
@@ -263,7 +263,7 @@ int fdtdec_get_is_enabled(const void *blob, int node)
 	 *
 	 * http://www.mail-archive.com/u-boot@lists.denx.de/msg71598.html
 	 */
-	cell = fdt_getprop(blob, node, "status", NULL);
+	cell = fdtdec_getprop(blob, node, "status", NULL);
 	if (cell)
 		return strcmp(cell, "okay") == 0;
 	return 1;
@@ -311,7 +311,7 @@ int fdtdec_next_alias(const void *blob, const char *name, enum fdt_compat_id id,
 	/* snprintf() is not available */
 	assert(strlen(name) < MAX_STR_LEN);
 	sprintf(str, "%.*s%d", MAX_STR_LEN, name, *upto);
-	node = fdt_path_offset(blob, str);
+	node = fdtdec_path_offset(blob, str);
 	if (node < 0)
 		return node;
 	err = fdt_node_check_compatible(blob, node, compat_names[id]);
@@ -346,7 +346,7 @@ int fdtdec_add_aliases_for_id(const void *blob, const char *name,
 	int i, j;
 
 	/* find the alias node if present */
-	alias_node = fdt_path_offset(blob, "/aliases");
+	alias_node = fdtdec_path_offset(blob, "/aliases");
 
 	/*
 	 * start with nothing, and we can assume that the root node can't
@@ -377,7 +377,7 @@ int fdtdec_add_aliases_for_id(const void *blob, const char *name,
 		prop = fdt_get_property_by_offset(blob, offset, NULL);
 		path = fdt_string(blob, fdt32_to_cpu(prop->nameoff));
 		if (prop->len && 0 == strncmp(path, name, name_len))
-			node = fdt_path_offset(blob, prop->data);
+			node = fdtdec_path_offset(blob, prop->data);
 		if (node <= 0)
 			continue;
 
@@ -460,7 +460,7 @@ int fdtdec_get_alias_seq(const void *blob, const char *base, int offset,
 	find_name = fdt_get_name(blob, offset, &find_namelen);
 	debug("Looking for '%s' at %d, name %s\n", base, offset, find_name);
 
-	aliases = fdt_path_offset(blob, "/aliases");
+	aliases = fdtdec_path_offset(blob, "/aliases");
 	for (prop_offset = fdt_first_property_offset(blob, aliases);
 	     prop_offset > 0;
 	     prop_offset = fdt_next_property_offset(blob, prop_offset)) {
@@ -499,7 +499,7 @@ int fdtdec_get_alias_highest_id(const void *blob, const char *base)
 
 	debug("Looking for highest alias id for '%s'\n", base);
 
-	aliases = fdt_path_offset(blob, "/aliases");
+	aliases = fdtdec_path_offset(blob, "/aliases");
 	for (prop_offset = fdt_first_property_offset(blob, aliases);
 	     prop_offset > 0;
 	     prop_offset = fdt_next_property_offset(blob, prop_offset)) {
@@ -529,8 +529,8 @@ const char *fdtdec_get_chosen_prop(const void *blob, const char *name)
 
 	if (!blob)
 		return NULL;
-	chosen_node = fdt_path_offset(blob, "/chosen");
-	return fdt_getprop(blob, chosen_node, name, NULL);
+	chosen_node = fdtdec_path_offset(blob, "/chosen");
+	return fdtdec_getprop(blob, chosen_node, name, NULL);
 }
 
 int fdtdec_get_chosen_node(const void *blob, const char *name)
@@ -540,7 +540,7 @@ int fdtdec_get_chosen_node(const void *blob, const char *name)
 	prop = fdtdec_get_chosen_prop(blob, name);
 	if (!prop)
 		return -FDT_ERR_NOTFOUND;
-	return fdt_path_offset(blob, prop);
+	return fdtdec_path_offset(blob, prop);
 }
 
 int fdtdec_check_fdt(void)
@@ -587,11 +587,11 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	int lookup;
 
 	debug("%s: %s\n", __func__, prop_name);
-	phandle = fdt_getprop(blob, node, prop_name, NULL);
+	phandle = fdtdec_getprop(blob, node, prop_name, NULL);
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -614,7 +614,7 @@ static const void *get_prop_check_min_len(const void *blob, int node,
 	int len;
 
 	debug("%s: %s\n", __func__, prop_name);
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	if (!cell)
 		*err = -FDT_ERR_NOTFOUND;
 	else if (len < min_len)
@@ -650,7 +650,7 @@ int fdtdec_get_int_array_count(const void *blob, int node,
 	int i;
 
 	debug("%s: %s\n", __func__, prop_name);
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	if (!cell)
 		return -FDT_ERR_NOTFOUND;
 	elems = len / sizeof(u32);
@@ -679,7 +679,7 @@ int fdtdec_get_bool(const void *blob, int node, const char *prop_name)
 	int len;
 
 	debug("%s: %s\n", __func__, prop_name);
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	return cell != NULL;
 }
 
@@ -696,7 +696,7 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 	int phandle;
 
 	/* Retrieve the phandle list property */
-	list = fdt_getprop(blob, src_node, list_name, &size);
+	list = fdtdec_getprop(blob, src_node, list_name, &size);
 	if (!list)
 		return -ENOENT;
 	list_end = list + size / sizeof(*list);
@@ -722,8 +722,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (!node) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -848,7 +848,7 @@ int fdtdec_get_config_int(const void *blob, const char *prop_name,
 	int config_node;
 
 	debug("%s: %s\n", __func__, prop_name);
-	config_node = fdt_path_offset(blob, "/config");
+	config_node = fdtdec_path_offset(blob, "/config");
 	if (config_node < 0)
 		return default_val;
 	return fdtdec_get_int(blob, config_node, prop_name, default_val);
@@ -860,7 +860,7 @@ int fdtdec_get_config_bool(const void *blob, const char *prop_name)
 	const void *prop;
 
 	debug("%s: %s\n", __func__, prop_name);
-	config_node = fdt_path_offset(blob, "/config");
+	config_node = fdtdec_path_offset(blob, "/config");
 	if (config_node < 0)
 		return 0;
 	prop = fdt_get_property(blob, config_node, prop_name, NULL);
@@ -875,11 +875,11 @@ char *fdtdec_get_config_string(const void *blob, const char *prop_name)
 	int len;
 
 	debug("%s: %s\n", __func__, prop_name);
-	nodeoffset = fdt_path_offset(blob, "/config");
+	nodeoffset = fdtdec_path_offset(blob, "/config");
 	if (nodeoffset < 0)
 		return NULL;
 
-	nodep = fdt_getprop(blob, nodeoffset, prop_name, &len);
+	nodep = fdtdec_getprop(blob, nodeoffset, prop_name, &len);
 	if (!nodep)
 		return NULL;
 
@@ -910,7 +910,7 @@ int fdt_get_resource(const void *fdt, int node, const char *property,
 	na = fdt_address_cells(fdt, parent);
 	ns = fdt_size_cells(fdt, parent);
 
-	ptr = fdt_getprop(fdt, node, property, &len);
+	ptr = fdtdec_getprop(fdt, node, property, &len);
 	if (!ptr)
 		return len;
 
@@ -950,7 +950,7 @@ static int decode_timing_property(const void *blob, int node, const char *name,
 	int length, ret = 0;
 	const u32 *prop;
 
-	prop = fdt_getprop(blob, node, name, &length);
+	prop = fdtdec_getprop(blob, node, name, &length);
 	if (!prop) {
 		debug("%s: could not find property %s\n",
 		      fdt_get_name(blob, node, NULL), name);
@@ -1041,7 +1041,7 @@ int fdtdec_setup_mem_size_base_fdt(const void *blob)
 	int ret, mem;
 	struct fdt_resource res;
 
-	mem = fdt_path_offset(blob, "/memory");
+	mem = fdtdec_path_offset(blob, "/memory");
 	if (mem < 0) {
 		debug("%s: Missing /memory node\n", __func__);
 		return -EINVAL;
@@ -1250,6 +1250,7 @@ static int fdtdec_init_reserved_memory(void *blob)
 	node = fdt_add_subnode(blob, 0, "reserved-memory");
 	if (node < 0)
 		return node;
+	fdtdec_cache_invalidate();
 
 	err = fdt_setprop(blob, node, "ranges", NULL, 0);
 	if (err < 0)
@@ -1338,6 +1339,8 @@ int fdtdec_add_reserved_memory(void *blob, const char *basename,
 	node = fdt_add_subnode(blob, parent, name);
 	if (node < 0)
 		return node;
+	/* Nodes after this one have moved */
+	fdtdec_cache_invalidate();
 
 	if (phandlep) {
 		err = fdt_generate_phandle(blob, &phandle);
@@ -1459,6 +1462,7 @@ int fdtdec_set_carveout(void *blob, const char *node, const char *prop_name,
 		      node, err);
 		return err;
 	}
+	fdtdec_cache_invalidate();
 
 	return 0;
 }
@@ -1573,13 +1577,13 @@ int fdtdec_decode_ram_size(const void *blob, const char *area, int board_id,
 	debug("%s: board_id=%d\n", __func__, board_id);
 	if (!area)
 		area = "/memory";
-	node = fdt_path_offset(blob, area);
+	node = fdtdec_path_offset(blob, area);
 	if (node < 0) {
 		debug("No %s node found\n", area);
 		return -ENOENT;
 	}
 
-	cell = fdt_getprop(blob, node, "reg", &len);
+	cell = fdtdec_getprop(blob, node, "reg", &len);
 	if (!cell) {
 		debug("No reg property found\n");
 		return -ENOENT;
@@ -1602,7 +1606,7 @@ int fdtdec_decode_ram_size(const void *blob, const char *area, int board_id,
 			/* Found matching mask */
 			debug("Found matching mask %d\n", match_mask);
 			node = child;
-			cell = fdt_getprop(blob, node, "reg", &len);
+			cell = fdtdec_getprop(blob, node, "reg", &len);
 			if (!cell) {
 				debug("No memory-banks property found\n");
 				return -EINVAL;
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cache of recent lookups in the flat device tree
+ */
+
+#include <common.h>
+#include <fdtdec.h>
+#include <linux/libfdt.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+void fdtdec_cache_invalidate(void)
+{
+	struct fdtdec_cache *cache = &gd->fdt_cache;
+	ulong hits = cache->hits, misses = cache->misses;
+
+	memset(cache, '\0', sizeof(*cache));
+	cache->hits = hits;
+	cache->misses = misses;
+}
+
+/* Get the cache for a tree, dropping its contents if the tree has moved */
+static struct fdtdec_cache *fdtdec_cache_get(const void *blob)
+{
+	struct fdtdec_cache *cache = &gd->fdt_cache;
+
+	if (!blob || blob != gd->fdt_blob)
+		return NULL;
+	if (cache->blob != blob ||
+	    cache->size_struct != fdt_size_dt_struct(blob) ||
+	    cache->size_strings != fdt_size_dt_strings(blob)) {
+		fdtdec_cache_invalidate();
+		cache->blob = blob;
+		cache->size_struct = fdt_size_dt_struct(blob);
+		cache->size_strings = fdt_size_dt_strings(blob);
+	}
+
+	return cache;
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	struct fdtdec_cache *cache = fdtdec_cache_get(blob);
+	struct fdtdec_cache_phandle *entry;
+	int i, offset;
+
+	if (!cache || !phandle || phandle == (uint32_t)-1)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	for (i = 0; i < FDTDEC_CACHE_PHANDLES; i++) {
+		entry = &cache->phandle[i];
+		if (entry->phandle == phandle &&
+		    fdt_get_phandle(blob, entry->offset) == phandle) {
+			cache->hits++;
+			return entry->offset;
+		}
+	}
+
+	cache->misses++;
+	offset = fdt_node_offset_by_phandle(blob, phandle);
+	if (offset >= 0) {
+		entry = &cache->phandle[cache->next_phandle];
+		entry->phandle = phandle;
+		entry->offset = offset;
+		cache->next_phandle = (cache->next_phandle + 1) %
+			FDTDEC_CACHE_PHANDLES;
+	}
+
+	return offset;
+}
+
+/* Check that the node at @offset has the last component of @path as name */
+static bool fdtdec_cache_path_ok(const void *blob, int offset,
+				 const char *path)
+{
+	const char *name = fdt_get_name(blob, offset, NULL);
+
+	return name && !strcmp(name, strrchr(path, '/') + 1);
+}
+
+int fdtdec_path_offset(const void *blob, const char *path)
+{
+	struct fdtdec_cache *cache = fdtdec_cache_get(blob);
+	struct fdtdec_cache_path *entry;
+	int i, offset;
+
+	/*
+	 * Aliases are not cached, since an alias can be changed in place to
+	 * point elsewhere without moving anything in the tree
+	 */
+	if (!cache || *path != '/' || strlen(path) >= FDTDEC_CACHE_PATH_LEN)
+		return fdt_path_offset(blob, path);
+
+	for (i = 0; i < FDTDEC_CACHE_PATHS; i++) {
+		entry = &cache->path[i];
+		if (!strcmp(entry->path, path) &&
+		    fdtdec_cache_path_ok(blob, entry->offset, path)) {
+			cache->hits++;
+			return entry->offset;
+		}
+	}
+
+	cache->misses++;
+	offset = fdt_path_offset(blob, path);
+	if (offset >= 0) {
+		entry = &cache->path[cache->next_path];
+		strcpy(entry->path, path);
+		entry->offset = offset;
+		cache->next_path = (cache->next_path + 1) % FDTDEC_CACHE_PATHS;
+	}
+
+	return offset;
+}
+
+/* Check that the property at @offset still belongs to @node */
+static bool fdtdec_cache_prop_ok(const void *blob, int node, int offset)
+{
+	int prop;
+
+	fdt_for_each_property_offset(prop, blob, node) {
+		if (prop == offset)
+			return true;
+	}
+
+	return false;
+}
+
+const void *fdtdec_getprop(const void *blob, int node, const char *name,
+			   int *lenp)
+{
+	struct fdtdec_cache *cache = fdtdec_cache_get(blob);
+	struct fdtdec_cache_prop *entry;
+	const struct fdt_property *prop;
+	const char *pname;
+	const void *value;
+	int i, offset;
+
+	if (!cache || node < 0)
+		return fdt_getprop(blob, node, name, lenp);
+
+	for (i = 0; i < FDTDEC_CACHE_PROPS; i++) {
+		entry = &cache->prop[i];
+		if (entry->node != node || !entry->offset ||
+		    !fdtdec_cache_prop_ok(blob, node, entry->offset))
+			continue;
+		value = fdt_getprop_by_offset(blob, entry->offset, &pname,
+					      lenp);
+		if (value && !strcmp(pname, name)) {
+			cache->hits++;
+			return value;
+		}
+	}
+
+	cache->misses++;
+	prop = fdt_get_property(blob, node, name, lenp);
+	if (!prop)
+		return NULL;
+	offset = (const char *)prop - (const char *)blob -
+		fdt_off_dt_struct(blob);
+	entry = &cache->prop[cache->next_prop];
+	entry->node = node;
+	entry->offset = offset;
+	cache->next_prop = (cache->next_prop + 1) % FDTDEC_CACHE_PROPS;
+
+	return prop->data;
+}
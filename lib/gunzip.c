@@ -12,8 +12,12 @@
 #include <image.h>
 #include <malloc.h>
 #include <memalign.h>
+#include <mmc.h>
 #include <u-boot/crc.h>
 #include <watchdog.h>
+#include <asm/unaligned.h>
+#include <linux/math64.h>
+#include <linux/zstd.h>
 #include <u-boot/zlib.h>
 
 #define HEADER0			'\x1f'
@@ -115,6 +119,291 @@ void gzwrite_progress_finish(int returnval,
 	}
 }
 
+/**
+ * struct gzwrite_out - where gzwrite() puts the decompressed data
+ *
+ * Data is decompressed into each of two buffers in turn. If the block
+ * device handles asynchronous requests, one buffer is written while the
+ * other is filled. Buffers holding only zeroes are erased rather than
+ * written, where erasing leaves zeroes and they cover whole erase groups.
+ *
+ * @dev:	block device to write to
+ * @szbuf:	size of each buffer in bytes
+ * @buf:	the two buffers
+ * @cur:	index of the buffer being filled
+ * @req:	write request for each buffer
+ * @sg:		blocks to write for each request
+ * @outblock:	next block to write, after any run of zero blocks
+ * @erase_grp:	erase group size in blocks, or 0 to write zeroes as normal
+ * @zero_blks:	number of zero blocks before @outblock waiting to be erased
+ */
+struct gzwrite_out {
+	struct blk_desc *dev;
+	ulong szbuf;
+	u8 *buf[2];
+	int cur;
+#if CONFIG_IS_ENABLED(BLK)
+	struct blk_req req[2];
+	struct blk_sg sg[2];
+#endif
+	lbaint_t outblock;
+	uint erase_grp;
+	lbaint_t zero_blks;
+};
+
+/* Get the erase group size in blocks, or 0 if erasing does not zero */
+static uint gzwrite_erase_grp(struct blk_desc *dev)
+{
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	struct mmc *mmc;
+
+	if (dev->if_type != IF_TYPE_MMC)
+		return 0;
+	mmc = find_mmc_device(dev->devnum);
+	if (mmc && mmc_erased_is_zero(mmc))
+		return mmc->erase_grp_size;
+#endif
+
+	return 0;
+}
+
+static int gzwrite_out_init(struct gzwrite_out *out, struct blk_desc *dev,
+			    ulong szbuf, lbaint_t outblock)
+{
+	memset(out, '\0', sizeof(*out));
+	out->dev = dev;
+	out->szbuf = szbuf;
+	out->outblock = outblock;
+	out->erase_grp = gzwrite_erase_grp(dev);
+	out->buf[0] = malloc_cache_aligned(szbuf);
+	out->buf[1] = malloc_cache_aligned(szbuf);
+	if (!out->buf[0] || !out->buf[1]) {
+		printf("%s: cannot allocate %lu bytes\n", __func__, szbuf * 2);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/* Wait until buffer @i has been written, so it can be filled again */
+static int gzwrite_out_wait(struct gzwrite_out *out, int i)
+{
+#if CONFIG_IS_ENABLED(BLK)
+	struct blk_req *req = &out->req[i];
+	int ret;
+
+	if (!req->sg_count)
+		return 0;
+	ret = blk_wait(out->dev->bdev, req);
+	if (!ret && req->done != blk_req_blkcnt(req))
+		ret = -EIO;
+	req->sg_count = 0;
+	if (ret) {
+		printf("%s: write failed at block " LBAFU " (err=%d)\n",
+		       __func__, req->start + req->done, ret);
+		return ret;
+	}
+#endif
+
+	return 0;
+}
+
+/* Erase the run of zero blocks, once earlier writes are done */
+static int gzwrite_out_erase(struct gzwrite_out *out)
+{
+	lbaint_t start = out->outblock - out->zero_blks;
+	int ret;
+
+	if (!out->zero_blks)
+		return 0;
+	ret = gzwrite_out_wait(out, 0);
+	if (!ret)
+		ret = gzwrite_out_wait(out, 1);
+	if (ret)
+		return ret;
+	if (blk_derase(out->dev, start, out->zero_blks) != out->zero_blks) {
+		printf("%s: erase failed at block " LBAFU "\n", __func__,
+		       start);
+		return -EIO;
+	}
+	out->zero_blks = 0;
+
+	return 0;
+}
+
+/*
+ * Write the first @len bytes of the current buffer, padded to a whole
+ * block, then wait for the other buffer to be free
+ */
+static int gzwrite_out_next(struct gzwrite_out *out, ulong len)
+{
+	ulong blksz = out->dev->blksz;
+	lbaint_t blkcnt = DIV_ROUND_UP(len, blksz);
+	u8 *buf = out->buf[out->cur];
+#if CONFIG_IS_ENABLED(BLK)
+	struct blk_req *req = &out->req[out->cur];
+#endif
+	u32 rem;
+	int ret;
+
+	if (!blkcnt)
+		return 0;
+	memset(buf + len, '\0', blkcnt * blksz - len);
+
+	if (out->erase_grp && !memchr_inv(buf, '\0', blkcnt * blksz)) {
+		div_u64_rem(blkcnt, out->erase_grp, &rem);
+		if (!rem && !out->zero_blks)
+			div_u64_rem(out->outblock, out->erase_grp, &rem);
+		if (!rem) {
+			out->zero_blks += blkcnt;
+			out->outblock += blkcnt;
+			return 0;
+		}
+	}
+	ret = gzwrite_out_erase(out);
+	if (ret)
+		return ret;
+
+#if CONFIG_IS_ENABLED(BLK)
+	out->sg[out->cur].buf = buf;
+	out->sg[out->cur].blkcnt = blkcnt;
+	memset(req, '\0', sizeof(*req));
+	req->op = BLK_REQ_WRITE;
+	req->start = out->outblock;
+	req->sg = &out->sg[out->cur];
+	req->sg_count = 1;
+	ret = blk_submit(out->dev->bdev, req);
+	if (ret) {
+		req->sg_count = 0;
+		printf("%s: cannot write block " LBAFU " (err=%d)\n",
+		       __func__, out->outblock, ret);
+		return ret;
+	}
+#else
+	if (blk_dwrite(out->dev, out->outblock, blkcnt, buf) != blkcnt) {
+		printf("%s: write failed at block " LBAFU "\n", __func__,
+		       out->outblock);
+		return -EIO;
+	}
+#endif
+	out->outblock += blkcnt;
+	out->cur ^= 1;
+
+	return gzwrite_out_wait(out, out->cur);
+}
+
+/* Finish any writes and erases, then free the buffers */
+static int gzwrite_out_finish(struct gzwrite_out *out)
+{
+	int ret, ret2;
+
+	ret = gzwrite_out_erase(out);
+	ret2 = gzwrite_out_wait(out, 0);
+	if (!ret)
+		ret = ret2;
+	ret2 = gzwrite_out_wait(out, 1);
+	if (!ret)
+		ret = ret2;
+	free(out->buf[0]);
+	free(out->buf[1]);
+
+	return ret;
+}
+
+#if CONFIG_IS_ENABLED(ZSTD)
+static int zstdwrite(unsigned char *src, int len, struct blk_desc *dev,
+		     ulong szwritebuf, lbaint_t outblock, u64 szexpected)
+{
+	ZSTD_inBuffer in = { .src = src, .size = len };
+	ZSTD_DStream *dstream = NULL;
+	struct gzwrite_out out;
+	ZSTD_frameParams params;
+	ZSTD_outBuffer outb;
+	u64 totalfilled = 0;
+	int iteration = 0;
+	void *workspace;
+	size_t wsize, ret;
+	bool done = false;
+	int r = -1;
+
+	if (ZSTD_getFrameParams(&params, src, len) || !params.windowSize) {
+		puts("Error: Bad zstd data\n");
+		return -1;
+	}
+	if (!szexpected)
+		szexpected = params.frameContentSize;
+	if (!szexpected) {
+		printf("%s: uncompressed size not known\n", __func__);
+		return -1;
+	}
+	if (lldiv(szexpected, dev->blksz) > (dev->lba - outblock)) {
+		printf("%s: uncompressed size %llu exceeds device size\n",
+		       __func__, szexpected);
+		return -1;
+	}
+
+	wsize = ZSTD_DStreamWorkspaceBound(params.windowSize);
+	workspace = malloc(wsize);
+	if (workspace)
+		dstream = ZSTD_initDStream(params.windowSize, workspace, wsize);
+	if (!dstream || gzwrite_out_init(&out, dev, szwritebuf, outblock)) {
+		printf("%s: out of memory\n", __func__);
+		free(workspace);
+		if (dstream)
+			gzwrite_out_finish(&out);
+		return -1;
+	}
+
+	gzwrite_progress_init(szexpected);
+	while (!done) {
+		outb.dst = out.buf[out.cur];
+		outb.size = szwritebuf;
+		outb.pos = 0;
+		while (outb.pos < outb.size) {
+			ret = ZSTD_decompressStream(dstream, &outb, &in);
+			if (ZSTD_isError(ret)) {
+				printf("Error: zstd returned %d\n",
+				       ZSTD_getErrorCode(ret));
+				goto out;
+			}
+			if (!ret) {
+				/* Another frame may follow, as written by pzstd */
+				if (in.size - in.pos < 4 ||
+				    get_unaligned_le32(src + in.pos) !=
+				    ZSTD_MAGICNUMBER) {
+					done = true;
+					break;
+				}
+				ZSTD_resetDStream(dstream);
+			} else if (in.pos == in.size &&
+				   outb.pos < outb.size) {
+				puts("Error: zstd data is truncated\n");
+				goto out;
+			}
+		}
+		totalfilled += outb.pos;
+		gzwrite_progress(iteration++, totalfilled, szexpected);
+		if (gzwrite_out_next(&out, outb.pos))
+			goto out;
+		if (ctrlc()) {
+			puts("abort\n");
+			goto out;
+		}
+		WATCHDOG_RESET();
+	}
+	if (totalfilled == szexpected)
+		r = 0;
+out:
+	if (gzwrite_out_finish(&out))
+		r = -1;
+	/* zstd checks its own checksum, if there is one */
+	gzwrite_progress_finish(r, totalfilled, szexpected, 0, 0);
+	free(workspace);
+
+	return r;
+}
+#endif
+
 int gzwrite(unsigned char *src, int len,
 	    struct blk_desc *dev,
 	    unsigned long szwritebuf,
@@ -124,10 +413,10 @@ int gzwrite(unsigned char *src, int len,
 	int i, flags;
 	z_stream s;
 	int r = 0;
-	unsigned char *writebuf;
+	struct gzwrite_out out;
 	unsigned crc = 0;
 	u64 totalfilled = 0;
-	lbaint_t blksperbuf, outblock;
+	lbaint_t outblock;
 	u32 expected_crc;
 	u32 payload_size;
 	int iteration = 0;
@@ -146,9 +435,14 @@ int gzwrite(unsigned char *src, int len,
 		return -1;
 	}
 
-	blksperbuf = szwritebuf / dev->blksz;
 	outblock = lldiv(startoffs, dev->blksz);
 
+#if CONFIG_IS_ENABLED(ZSTD)
+	if (len >= 4 && get_unaligned_le32(src) == ZSTD_MAGICNUMBER)
+		return zstdwrite(src, len, dev, szwritebuf, outblock,
+				 szexpected);
+#endif
+
 	/* skip header */
 	i = 10;
 	flags = src[3];
@@ -191,6 +485,11 @@ int gzwrite(unsigned char *src, int len,
 		return -1;
 	}
 
+	if (gzwrite_out_init(&out, dev, szwritebuf, outblock)) {
+		gzwrite_out_finish(&out);
+		return -1;
+	}
+
 	gzwrite_progress_init(szexpected);
 
 	s.zalloc = gzalloc;
@@ -199,12 +498,12 @@ int gzwrite(unsigned char *src, int len,
 	r = inflateInit2(&s, -MAX_WBITS);
 	if (r != Z_OK) {
 		printf("Error: inflateInit2() returned %d\n", r);
+		gzwrite_out_finish(&out);
 		return -1;
 	}
 
 	s.next_in = src + i;
 	s.avail_in = payload_size+8;
-	writebuf = (unsigned char *)malloc_cache_aligned(szwritebuf);
 
 	/* decompress until deflate stream ends or end of file */
 	do {
@@ -216,9 +515,8 @@ int gzwrite(unsigned char *src, int len,
 
 		/* run inflate() on input until output buffer not full */
 		do {
-			unsigned long blocks_written;
+			unsigned char *writebuf = out.buf[out.cur];
 			int numfilled;
-			lbaint_t writeblocks;
 
 			s.avail_out = szwritebuf;
 			s.next_out = writebuf;
@@ -231,23 +529,17 @@ int gzwrite(unsigned char *src, int len,
 			numfilled = szwritebuf - s.avail_out;
 			crc = crc32(crc, writebuf, numfilled);
 			totalfilled += numfilled;
-			if (numfilled < szwritebuf) {
-				writeblocks = (numfilled+dev->blksz-1)
-						/ dev->blksz;
-				memset(writebuf+numfilled, 0,
-				       dev->blksz-(numfilled%dev->blksz));
-			} else {
-				writeblocks = blksperbuf;
-			}
 
 			gzwrite_progress(iteration++,
 					 totalfilled,
 					 szexpected);
-			blocks_written = blk_dwrite(dev, outblock,
-						    writeblocks, writebuf);
-			outblock += blocks_written;
+			if (gzwrite_out_next(&out, numfilled)) {
+				r = -1;
+				goto out;
+			}
 			if (ctrlc()) {
 				puts("abort\n");
+				r = -1;
 				goto out;
 			}
 			WATCHDOG_RESET();
@@ -262,9 +554,10 @@ int gzwrite(unsigned char *src, int len,
 		r = 0;
 
 out:
+	if (gzwrite_out_finish(&out))
+		r = -1;
 	gzwrite_progress_finish(r, totalfilled, szexpected,
 				expected_crc, crc);
-	free(writebuf);
 	inflateEnd(&s);
 
 	return r;
@@ -46,26 +46,220 @@
 
 static void default_log(const char *ignored, char *response) {}
 
-int write_sparse_image(struct sparse_storage *info,
-		       const char *part_name, void *data, char *response)
-{
+/**
+ * struct sparse_state - state kept while writing a sparse image
+ *
+ * Small RAW chunks are copied into @raw_buf and written with a single call
+ * once a chunk arrives which does not follow on from them, so that an image
+ * made up of many small chunks does not need one write per chunk.
+ *
+ * @info:	storage being written
+ * @response:	response buffer to pass to info->mssg()
+ * @blk:	next block to write; pending RAW data is written from here
+ * @buf_blks:	size of @fill_buf and @raw_buf in storage blocks
+ * @fill_buf:	buffer for FILL chunks, or NULL if not allocated yet
+ * @fill_val:	value that @fill_buf is currently filled with
+ * @raw_buf:	buffer for gathering small RAW chunks, or NULL if not allocated
+ * @raw_blks:	number of blocks waiting to be written from @raw_buf
+ */
+struct sparse_state {
+	struct sparse_storage *info;
+	char *response;
 	lbaint_t blk;
-	lbaint_t blkcnt;
+	lbaint_t buf_blks;
+	uint32_t *fill_buf;
+	uint32_t fill_val;
+	void *raw_buf;
+	lbaint_t raw_blks;
+};
+
+static int sparse_write(struct sparse_state *st, lbaint_t blkcnt,
+			const void *buffer)
+{
+	struct sparse_storage *info = st->info;
 	lbaint_t blks;
+
+	blks = info->write(info, st->blk, blkcnt, buffer);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (blks < blkcnt) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n", __func__,
+		       "Write failed, block #", st->blk, blks);
+		info->mssg("flash write failure", st->response);
+		return -EIO;
+	}
+	st->blk += blks;
+
+	return 0;
+}
+
+static int sparse_flush(struct sparse_state *st)
+{
+	lbaint_t blkcnt = st->raw_blks;
+
+	if (!blkcnt)
+		return 0;
+	st->raw_blks = 0;
+
+	return sparse_write(st, blkcnt, st->raw_buf);
+}
+
+static int sparse_check_size(struct sparse_state *st, lbaint_t blkcnt)
+{
+	struct sparse_storage *info = st->info;
+
+	if (st->blk + st->raw_blks + blkcnt > info->start + info->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		info->mssg("Request would exceed partition size!",
+			   st->response);
+		return -ENOSPC;
+	}
+
+	return 0;
+}
+
+static int sparse_write_raw(struct sparse_state *st, lbaint_t blkcnt,
+			    const void *data)
+{
+	struct sparse_storage *info = st->info;
+	int ret;
+
+	ret = sparse_check_size(st, blkcnt);
+	if (ret)
+		return ret;
+
+	/* Large chunks are written straight from the image */
+	if (blkcnt >= st->buf_blks) {
+		ret = sparse_flush(st);
+		if (ret)
+			return ret;
+		return sparse_write(st, blkcnt, data);
+	}
+
+	if (st->raw_blks + blkcnt > st->buf_blks) {
+		ret = sparse_flush(st);
+		if (ret)
+			return ret;
+	}
+	if (!st->raw_buf) {
+		st->raw_buf = memalign(ARCH_DMA_MINALIGN,
+				       ROUNDUP(info->blksz * st->buf_blks,
+					       ARCH_DMA_MINALIGN));
+		if (!st->raw_buf) {
+			info->mssg("Malloc failed for: CHUNK_TYPE_RAW",
+				   st->response);
+			return -ENOMEM;
+		}
+	}
+	memcpy(st->raw_buf + st->raw_blks * info->blksz, data,
+	       blkcnt * info->blksz);
+	st->raw_blks += blkcnt;
+
+	return 0;
+}
+
+static int sparse_write_fill(struct sparse_state *st, lbaint_t blkcnt)
+{
+	lbaint_t i, j;
+	int ret;
+
+	for (i = 0; i < blkcnt; i += j) {
+		j = min(blkcnt - i, st->buf_blks);
+		ret = sparse_write(st, j, st->fill_buf);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Erase the erase groups which lie entirely within a zero-filled chunk
+ * rather than writing zeroes to them. Any part of the chunk outside those
+ * groups, or which cannot be erased, is written as normal.
+ */
+static int sparse_erase_fill(struct sparse_state *st, lbaint_t blkcnt)
+{
+	struct sparse_storage *info = st->info;
+	uint grp = info->erase_grp;
+	lbaint_t head, mid;
+	u32 rem;
+	int ret;
+
+	div_u64_rem(st->blk, grp, &rem);
+	head = rem ? grp - rem : 0;
+	if (head >= blkcnt)
+		return sparse_write_fill(st, blkcnt);
+	mid = blkcnt - head;
+	div_u64_rem(mid, grp, &rem);
+	mid -= rem;
+
+	ret = sparse_write_fill(st, head);
+	if (ret)
+		return ret;
+	if (mid && info->erase(info, st->blk, mid) == mid) {
+		st->blk += mid;
+	} else {
+		ret = sparse_write_fill(st, mid);
+		if (ret)
+			return ret;
+	}
+
+	return sparse_write_fill(st, blkcnt - head - mid);
+}
+
+static int sparse_fill(struct sparse_state *st, lbaint_t blkcnt,
+		       uint32_t fill_val)
+{
+	struct sparse_storage *info = st->info;
+	int ret;
+	int i;
+
+	ret = sparse_check_size(st, blkcnt);
+	if (!ret)
+		ret = sparse_flush(st);
+	if (ret)
+		return ret;
+
+	/* The buffer is kept for later chunks with the same value */
+	if (!st->fill_buf) {
+		st->fill_buf = memalign(ARCH_DMA_MINALIGN,
+					ROUNDUP(info->blksz * st->buf_blks,
+						ARCH_DMA_MINALIGN));
+		if (!st->fill_buf) {
+			info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
+				   st->response);
+			return -ENOMEM;
+		}
+		st->fill_val = ~fill_val;
+	}
+	if (fill_val != st->fill_val) {
+		for (i = 0; i < info->blksz * st->buf_blks / sizeof(fill_val);
+		     i++)
+			st->fill_buf[i] = fill_val;
+		st->fill_val = fill_val;
+	}
+
+	if (!fill_val && info->erase && info->erase_grp)
+		return sparse_erase_fill(st, blkcnt);
+
+	return sparse_write_fill(st, blkcnt);
+}
+
+static int sparse_process(struct sparse_state *st, const char *part_name,
+			  void *data)
+{
+	struct sparse_storage *info = st->info;
+	char *response = st->response;
+	lbaint_t blkcnt;
 	uint32_t bytes_written = 0;
 	unsigned int chunk;
 	unsigned int offset;
 	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
 	uint32_t fill_val;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
 	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	int ret;
 
 	/* Read and skip over sparse image header */
 	sparse_header = (sparse_header_t *)data;
@@ -79,9 +273,6 @@ int write_sparse_image(struct sparse_storage *info,
 		data += (sparse_header->file_hdr_sz - sizeof(sparse_header_t));
 	}
 
-	if (!info->mssg)
-		info->mssg = default_log;
-
 	debug("=== Sparse Image Header ===\n");
 	debug("magic: 0x%x\n", sparse_header->magic);
 	debug("major_version: 0x%x\n", sparse_header->major_version);
@@ -107,7 +298,6 @@ int write_sparse_image(struct sparse_storage *info,
 	puts("Flashing Sparse Image\n");
 
 	/* Start processing chunks */
-	blk = info->start;
 	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
 		/* Read and skip over chunk header */
 		chunk_header = (chunk_header_t *)data;
@@ -140,25 +330,9 @@ int write_sparse_image(struct sparse_storage *info,
 				return -1;
 			}
 
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
-
-			blks = info->write(info, blk, blkcnt, data);
-			/* blks might be > blkcnt (eg. NAND bad-blocks) */
-			if (blks < blkcnt) {
-				printf("%s: %s" LBAFU " [" LBAFU "]\n",
-				       __func__, "Write failed, block #",
-				       blk, blks);
-				info->mssg("flash write failure", response);
-				return -1;
-			}
-			blk += blks;
+			ret = sparse_write_raw(st, blkcnt, data);
+			if (ret)
+				return ret;
 			bytes_written += blkcnt * info->blksz;
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
@@ -171,61 +345,21 @@ int write_sparse_image(struct sparse_storage *info,
 				return -1;
 			}
 
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
-			}
-
 			fill_val = *(uint32_t *)data;
 			data = (char *)data + sizeof(uint32_t);
 
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
-
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
+			ret = sparse_fill(st, blkcnt, fill_val);
+			if (ret)
+				return ret;
 			bytes_written += blkcnt * info->blksz;
 			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
 			break;
 
 		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
+			ret = sparse_flush(st);
+			if (ret)
+				return ret;
+			st->blk += info->reserve(info, st->blk, blkcnt);
 			total_blocks += chunk_header->chunk_sz;
 			break;
 
@@ -247,6 +381,9 @@ int write_sparse_image(struct sparse_storage *info,
 			return -1;
 		}
 	}
+	ret = sparse_flush(st);
+	if (ret)
+		return ret;
 
 	debug("Wrote %d blocks, expected to write %d blocks\n",
 	      total_blocks, sparse_header->total_blks);
@@ -259,3 +396,24 @@ int write_sparse_image(struct sparse_storage *info,
 
 	return 0;
 }
+
+int write_sparse_image(struct sparse_storage *info,
+		       const char *part_name, void *data, char *response)
+{
+	struct sparse_state st = {
+		.info = info,
+		.response = response,
+		.blk = info->start,
+	};
+	int ret;
+
+	if (!info->mssg)
+		info->mssg = default_log;
+	st.buf_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+
+	ret = sparse_process(&st, part_name, data);
+	free(st.fill_buf);
+	free(st.raw_buf);
+
+	return ret ? -1 : 0;
+}
@@ -7,6 +7,8 @@
 #include <compiler.h>
 #include <image.h>
 #include <lz4.h>
+#include <malloc.h>
+#include <mp_work.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
 
@@ -62,6 +64,106 @@ struct lz4_block_header {
 	/* + u32 block_checksum iff has_block_checksum is set */
 } __packed;
 
+#if CONFIG_IS_ENABLED(MP_WORK)
+struct lz4_mp_block {
+	const void *in;		/* block data */
+	u32 raw;		/* block header */
+	void *out;		/* where this block's output goes */
+	size_t max;		/* space at out */
+	int len;		/* number of bytes decompressed */
+};
+
+static int lz4_mp_block(void *arg, int index, int cpu)
+{
+	struct lz4_mp_block *blk = (struct lz4_mp_block *)arg + index;
+	struct lz4_block_header b;
+
+	b.raw = blk->raw;
+	if (b.not_compressed) {
+		if (b.size > blk->max)
+			return -ENOBUFS;
+		memcpy(blk->out, blk->in, b.size);
+		blk->len = b.size;
+	} else {
+		/* constant folding essential, do not touch params! */
+		blk->len = LZ4_decompress_generic(blk->in, blk->out, b.size,
+				blk->max, endOnInputSize,
+				full, 0, noDict, blk->out, NULL, 0);
+		if (blk->len < 0)
+			return -EPROTO;
+	}
+
+	return 0;
+}
+
+/*
+ * Decompress the blocks of a frame in parallel. Each block is assumed to
+ * fill its maximum size, except the last, which is checked afterwards.
+ * Returns -EAGAIN if the frame is not suitable, in which case it should be
+ * decompressed in the normal way.
+ */
+static int ulz4fn_mp(const void *src, size_t srcn, const void *in,
+		     int has_block_checksum, void *dst, size_t *dstn)
+{
+	const struct lz4_frame_header *h = src;
+	size_t block_size = 1 << (8 + 2 * h->max_block_size);
+	struct lz4_mp_block *blocks;
+	const void *p = in;
+	int count = 0;
+	int ret, i;
+
+	/* In-place decompression must go block by block */
+	if (dst < src + srcn && src < dst + *dstn)
+		return -EAGAIN;
+
+	while (1) {
+		struct lz4_block_header b;
+
+		b.raw = le32_to_cpu(*(u32 *)p);
+		p += sizeof(struct lz4_block_header);
+		if (p - src + b.size > srcn)
+			return -EAGAIN;
+		if (!b.size)
+			break;
+		p += b.size;
+		if (has_block_checksum)
+			p += sizeof(u32);
+		count++;
+	}
+	if (count < 2 || (count - 1) * block_size >= *dstn)
+		return -EAGAIN;
+
+	blocks = calloc(count, sizeof(*blocks));
+	if (!blocks)
+		return -EAGAIN;
+	for (p = in, i = 0; i < count; i++) {
+		struct lz4_mp_block *blk = &blocks[i];
+		struct lz4_block_header b;
+
+		b.raw = le32_to_cpu(*(u32 *)p);
+		p += sizeof(struct lz4_block_header);
+		blk->in = p;
+		blk->raw = b.raw;
+		blk->out = dst + i * block_size;
+		blk->max = min(block_size, *dstn - i * block_size);
+		p += b.size;
+		if (has_block_checksum)
+			p += sizeof(u32);
+	}
+
+	ret = mp_work_run(lz4_mp_block, blocks, count);
+	for (i = 0; !ret && i < count - 1; i++) {
+		if (blocks[i].len != block_size)
+			ret = -EAGAIN;
+	}
+	if (!ret)
+		*dstn = (count - 1) * block_size + blocks[count - 1].len;
+	free(blocks);
+
+	return ret ? -EAGAIN : 0;
+}
+#endif
+
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 {
 	const void *end = dst + *dstn;
@@ -92,6 +194,13 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 		in += sizeof(u8);
 	}
 
+#if CONFIG_IS_ENABLED(MP_WORK)
+	*dstn = end - dst;
+	if (!ulz4fn_mp(src, srcn, in, has_block_checksum, dst, dstn))
+		return 0;
+	*dstn = 0;
+#endif
+
 	while (1) {
 		struct lz4_block_header b;
 
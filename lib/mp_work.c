@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Running independent work items on secondary CPUs
+ *
+ * Work items are handed out through a shared counter, so each CPU simply
+ * takes the next item until none are left. Atomic operations use the
+ * compiler builtins since U-Boot has no SMP-safe atomics of its own.
+ */
+
+#include <common.h>
+#include <mp_work.h>
+#include <watchdog.h>
+
+struct mp_work {
+	mp_work_func func;
+	void *arg;
+	int count;
+	int next;	/* next item to hand out */
+	int done;	/* number of items finished */
+	int cpus;	/* number of CPUs which have joined in */
+	int max_cpus;
+	int ret;
+};
+
+static struct mp_work work;
+
+__weak int arch_mp_work_max(void)
+{
+	return 0;
+}
+
+__weak int arch_mp_work_start(void)
+{
+	return 0;
+}
+
+__weak void arch_mp_work_stop(void)
+{
+}
+
+int mp_work_max_cpus(void)
+{
+	return 1 + arch_mp_work_max();
+}
+
+static void mp_work_loop(int cpu)
+{
+	int index, ret;
+
+	while (1) {
+		index = __atomic_fetch_add(&work.next, 1, __ATOMIC_ACQUIRE);
+		if (index >= work.count)
+			break;
+		ret = work.func(work.arg, index, cpu);
+		if (ret)
+			__atomic_store_n(&work.ret, ret, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&work.done, 1, __ATOMIC_RELEASE);
+	}
+}
+
+void mp_work_secondary(void)
+{
+	int cpu;
+
+	cpu = __atomic_add_fetch(&work.cpus, 1, __ATOMIC_ACQUIRE);
+	if (cpu < work.max_cpus)
+		mp_work_loop(cpu);
+
+	/* Don't let a CPU park and be woken again before the run is over */
+	while (__atomic_load_n(&work.done, __ATOMIC_ACQUIRE) < work.count)
+		;
+}
+
+int mp_work_run(mp_work_func func, void *arg, int count)
+{
+	int started = 0;
+
+	work.func = func;
+	work.arg = arg;
+	work.count = count;
+	work.next = 0;
+	work.done = 0;
+	work.cpus = 0;
+	work.max_cpus = mp_work_max_cpus();
+	work.ret = 0;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (count > 1 && work.max_cpus > 1)
+		started = arch_mp_work_start();
+	mp_work_loop(0);
+	while (__atomic_load_n(&work.done, __ATOMIC_ACQUIRE) < count)
+		WATCHDOG_RESET();
+	if (started > 0)
+		arch_mp_work_stop();
+	debug("%s: %d items, %d secondary CPUs\n", __func__, count, started);
+
+	return work.ret;
+}
@@ -14,6 +14,7 @@
 #include <malloc.h>
 #include <dm/of_access.h>
 #include <linux/err.h>
+#include <linux/log2.h>
 
 static void *unflatten_dt_alloc(void **mem, unsigned long size,
 				unsigned long align)
@@ -45,8 +46,9 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 {
 	const __be32 *p;
 	struct device_node *np;
-	struct property *pp, **prev_pp = NULL;
+	struct property *pp, **prev_pp = NULL, **hash;
 	const char *pathp;
+	int nprops = 0;
 	int l;
 	unsigned int allocl;
 	static int depth;
@@ -142,6 +144,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 			has_name = 1;
 		pp = unflatten_dt_alloc(&mem, sizeof(struct property),
 					__alignof__(struct property));
+		nprops++;
 		if (!dryrun) {
 			/*
 			 * We accept flattened tree phandles either in
@@ -187,6 +190,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		sz = (pa - ps) + 1;
 		pp = unflatten_dt_alloc(&mem, sizeof(struct property) + sz,
 					__alignof__(struct property));
+		nprops++;
 		if (!dryrun) {
 			pp->name = "name";
 			pp->length = sz;
@@ -199,6 +203,16 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 			      (char *)pp->value);
 		}
 	}
+	if (nprops >= OF_PROP_HASH_MIN) {
+		uint slots = roundup_pow_of_two(nprops * 2);
+
+		hash = unflatten_dt_alloc(&mem, slots * sizeof(*hash),
+					  __alignof__(struct property *));
+		if (!dryrun) {
+			*prev_pp = NULL;
+			of_prop_hash_init(np, hash, slots - 1);
+		}
+	}
 	if (!dryrun) {
 		*prev_pp = NULL;
 		np->name = of_get_property(np, "name", NULL);
@@ -324,6 +338,7 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 		debug("Failed to create live tree: err=%d\n", ret);
 		return ret;
 	}
+	of_populate_phandle_cache();
 	ret = of_alias_scan();
 	if (ret) {
 		debug("Failed to scan live tree aliases: err=%d\n", ret);
@@ -29,6 +29,12 @@ int hash_calculate(const char *name,
 	if (ret)
 		return ret;
 
+	/* The same data is often covered by a hash node as well */
+	if (region_count == 1 &&
+	    fit_digest_cache_get(name, region[0].data, region[0].size,
+				 checksum) == algo->digest_size)
+		return 0;
+
 	ret = algo->hash_init(algo, &ctx);
 	if (ret)
 		return ret;
@@ -46,6 +52,9 @@ int hash_calculate(const char *name,
 	ret = algo->hash_finish(algo, ctx, checksum, algo->digest_size);
 	if (ret)
 		return ret;
+	if (region_count == 1)
+		fit_digest_cache_put(name, region[0].data, region[0].size,
+				     checksum, algo->digest_size);
 
 	return 0;
 }
@@ -50,11 +50,51 @@ const uint8_t sha1_der_prefix[SHA1_DER_LEN] = {
 }
 #endif
 
+/*
+ * Implementations of the block function, in order of preference. The C
+ * code at the end is always available, and is all the host tools use.
+ */
+static const struct sha_backend sha1_generic = {
+	.name	= "generic",
+};
+
+static const struct sha_backend *const sha1_backends[] = {
+#if !defined(USE_HOSTCC) && defined(CONFIG_SHA_ARMV8_CE)
+	&sha1_armv8_ce,
+#endif
+#if !defined(USE_HOSTCC) && defined(CONFIG_SHA_X86_SHANI)
+	&sha1_x86_shani,
+#endif
+	&sha1_generic,
+};
+
+const struct sha_backend *sha1_get_backend(int index)
+{
+	if (index < 0 ||
+	    index >= sizeof(sha1_backends) / sizeof(sha1_backends[0]))
+		return NULL;
+
+	return sha1_backends[index];
+}
+
 /*
  * SHA-1 context setup
  */
 void sha1_starts (sha1_context * ctx)
 {
+	const struct sha_backend *backend;
+	int i;
+
+	for (i = 0; (backend = sha1_get_backend(i)); i++) {
+		if (!backend->probe || backend->probe())
+			break;
+	}
+	sha1_starts_backend(ctx, backend);
+}
+
+void sha1_starts_backend(sha1_context *ctx, const struct sha_backend *backend)
+{
+	ctx->backend = backend && backend->blocks ? backend : NULL;
 	ctx->total[0] = 0;
 	ctx->total[1] = 0;
 
@@ -219,6 +259,26 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 	ctx->state[4] += E;
 }
 
+static void sha1_blocks(sha1_context *ctx, const unsigned char *data,
+			unsigned int count)
+{
+	uint32_t state[5];
+	int i;
+
+	if (ctx->backend) {
+		/* the state is kept in unsigned longs, which may be wider */
+		for (i = 0; i < 5; i++)
+			state[i] = ctx->state[i];
+		ctx->backend->blocks(state, data, count);
+		for (i = 0; i < 5; i++)
+			ctx->state[i] = state[i];
+		return;
+	}
+
+	for (; count; count--, data += 64)
+		sha1_process(ctx, data);
+}
+
 /*
  * SHA-1 process buffer
  */
@@ -242,16 +302,16 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 
 	if (left && ilen >= fill) {
 		memcpy ((void *) (ctx->buffer + left), (void *) input, fill);
-		sha1_process (ctx, ctx->buffer);
+		sha1_blocks(ctx, ctx->buffer, 1);
 		input += fill;
 		ilen -= fill;
 		left = 0;
 	}
 
-	while (ilen >= 64) {
-		sha1_process (ctx, input);
-		input += 64;
-		ilen -= 64;
+	if (ilen >= 64) {
+		sha1_blocks(ctx, input, ilen / 64);
+		input += ilen & ~0x3F;
+		ilen &= 0x3F;
 	}
 
 	if (ilen > 0) {
@@ -40,8 +40,49 @@ const uint8_t sha256_der_prefix[SHA256_DER_LEN] = {
 }
 #endif
 
+/*
+ * Implementations of the block function, in order of preference. The C
+ * code at the end is always available, and is all the host tools use.
+ */
+static const struct sha_backend sha256_generic = {
+	.name	= "generic",
+};
+
+static const struct sha_backend *const sha256_backends[] = {
+#if !defined(USE_HOSTCC) && defined(CONFIG_SHA_ARMV8_CE)
+	&sha256_armv8_ce,
+#endif
+#if !defined(USE_HOSTCC) && defined(CONFIG_SHA_X86_SHANI)
+	&sha256_x86_shani,
+#endif
+	&sha256_generic,
+};
+
+const struct sha_backend *sha256_get_backend(int index)
+{
+	if (index < 0 ||
+	    index >= sizeof(sha256_backends) / sizeof(sha256_backends[0]))
+		return NULL;
+
+	return sha256_backends[index];
+}
+
 void sha256_starts(sha256_context * ctx)
 {
+	const struct sha_backend *backend;
+	int i;
+
+	for (i = 0; (backend = sha256_get_backend(i)); i++) {
+		if (!backend->probe || backend->probe())
+			break;
+	}
+	sha256_starts_backend(ctx, backend);
+}
+
+void sha256_starts_backend(sha256_context *ctx,
+			   const struct sha_backend *backend)
+{
+	ctx->backend = backend && backend->blocks ? backend : NULL;
 	ctx->total[0] = 0;
 	ctx->total[1] = 0;
 
@@ -186,6 +227,18 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 	ctx->state[7] += H;
 }
 
+static void sha256_blocks(sha256_context *ctx, const uint8_t *data,
+			  uint32_t count)
+{
+	if (ctx->backend) {
+		ctx->backend->blocks(ctx->state, data, count);
+		return;
+	}
+
+	for (; count; count--, data += 64)
+		sha256_process(ctx, data);
+}
+
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 {
 	uint32_t left, fill;
@@ -204,16 +257,16 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 
 	if (left && length >= fill) {
 		memcpy((void *) (ctx->buffer + left), (void *) input, fill);
-		sha256_process(ctx, ctx->buffer);
+		sha256_blocks(ctx, ctx->buffer, 1);
 		length -= fill;
 		input += fill;
 		left = 0;
 	}
 
-	while (length >= 64) {
-		sha256_process(ctx, input);
-		length -= 64;
-		input += 64;
+	if (length >= 64) {
+		sha256_blocks(ctx, input, length / 64);
+		input += length & ~0x3F;
+		length &= 0x3F;
 	}
 
 	if (length)
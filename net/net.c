@@ -96,6 +96,12 @@
 #include <net.h>
 #include <net/fastboot.h>
 #include <net/tftp.h>
+#if defined(CONFIG_PROT_TCP)
+#include <net/tcp.h>
+#endif
+#if defined(CONFIG_CMD_WGET)
+#include <net/wget.h>
+#endif
 #if defined(CONFIG_CMD_PCAP)
 #include <net/pcap.h>
 #endif
@@ -362,6 +368,9 @@ static void net_clear_handlers(void)
 {
 	net_set_udp_handler(NULL);
 	net_set_arp_handler(NULL);
+#if defined(CONFIG_PROT_TCP)
+	net_set_tcp_handler(NULL);
+#endif
 	net_set_timeout_handler(0, NULL);
 }
 
@@ -501,6 +510,11 @@ restart:
 			nfs_start();
 			break;
 #endif
+#if defined(CONFIG_CMD_WGET)
+		case WGET:
+			wget_start();
+			break;
+#endif
 #if defined(CONFIG_CMD_CDP)
 		case CDP:
 			cdp_start();
@@ -848,6 +862,14 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 				   payload_len);
 		pkt_hdr_size = eth_hdr_size + IP_UDP_HDR_SIZE;
 		break;
+#if defined(CONFIG_PROT_TCP)
+	case IPPROTO_TCP:
+		pkt_hdr_size = eth_hdr_size +
+			tcp_set_tcp_header(pkt + eth_hdr_size, dest, dport,
+					   sport, payload_len, action,
+					   tcp_seq_num, tcp_ack_num);
+		break;
+#endif
 	default:
 		return -EINVAL;
 	}
@@ -869,8 +891,8 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 		arp_request();
 		return 1;	/* waiting */
 	} else {
-		debug_cond(DEBUG_DEV_PKT, "sending UDP to %pI4/%pM\n",
-			   &dest, ether);
+		debug_cond(DEBUG_DEV_PKT, "sending IP proto %d to %pI4/%pM\n",
+			   proto, &dest, ether);
 		net_send_packet(net_tx_packet, pkt_hdr_size + payload_len);
 		return 0;	/* transmitted */
 	}
@@ -1257,6 +1279,11 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			receive_icmp(ip, len, src_ip, et);
 			return;
+#if defined(CONFIG_PROT_TCP)
+		} else if (ip->ip_p == IPPROTO_TCP) {
+			tcp_receive((struct ip_tcp_hdr *)ip, len);
+			return;
+#endif
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
@@ -1360,6 +1387,9 @@ static int net_check_prereq(enum proto_t protocol)
 #endif
 #if defined(CONFIG_CMD_NFS)
 	case NFS:
+#endif
+#if defined(CONFIG_CMD_WGET)
+	case WGET:
 #endif
 		/* Fall through */
 	case TFTPGET:
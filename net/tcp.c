@@ -0,0 +1,520 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client
+ *
+ * This supports a single active connection, as needed to download a file.
+ * The receive side is the one that matters: the window is large (using
+ * window scaling), in-order data is handed straight to the user and a few
+ * out-of-order segments are held back so that a lost packet costs a single
+ * fast retransmit rather than a stall. There is no SACK; the remote learns
+ * of a gap from the duplicate ACKs sent for each out-of-order segment.
+ * The send side only copes with one small segment at a time.
+ */
+
+#include <common.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+
+/* Retransmission timeout, in ms */
+#define TCP_RTO_MS		1000
+/* Number of timeouts before the connection is abandoned */
+#define TCP_RETRIES		10
+/* Time an ACK for a single segment may be held back, in ms */
+#define TCP_DELACK_MS		20
+/* Duplicate ACKs which trigger a fast retransmit */
+#define TCP_DUP_ACKS		3
+
+#ifdef CONFIG_TCP_RCV_WINDOW
+#define TCP_RCV_WINDOW		CONFIG_TCP_RCV_WINDOW
+#else
+#define TCP_RCV_WINDOW		65535
+#endif
+
+/* Sequence number comparisons, allowing for wrap-around */
+#define seq_before(a, b)	((s32)((a) - (b)) < 0)
+#define seq_after(a, b)		seq_before(b, a)
+
+/*
+ * A segment received ahead of a gap
+ */
+struct tcp_ooo_seg {
+	u32 seq;
+	u16 len;
+	u8 fin;
+	u8 used;
+	uchar data[TCP_MSS];
+};
+
+static enum tcp_state tcp_state;
+static rxhand_tcp_f *tcp_handler;
+
+static struct in_addr tcp_remote_ip;
+static uchar tcp_remote_ethaddr[ARP_HLEN];
+static int tcp_remote_port;
+static int tcp_our_port;
+
+/* first unacknowledged and next sequence number to send */
+static u32 tcp_snd_una;
+static u32 tcp_snd_nxt;
+/* data waiting to be acknowledged, starting at sequence tcp_snd_seq */
+static uchar tcp_snd_buf[TCP_MSS];
+static unsigned int tcp_snd_len;
+static u32 tcp_snd_seq;
+/* largest segment the remote accepts */
+static unsigned int tcp_snd_mss;
+static int tcp_dup_acks;
+
+/* next sequence number expected */
+static u32 tcp_rcv_nxt;
+/* shift applied to the window we advertise, 0 if not scaling */
+static int tcp_rcv_wscale;
+/* segments received since the last ACK was sent */
+static int tcp_ack_pending;
+
+static int tcp_retries;
+static struct tcp_ooo_seg tcp_ooo[TCP_OOO_SEGS];
+
+static void tcp_timeout_handler(void);
+
+enum tcp_state tcp_get_state(void)
+{
+	return tcp_state;
+}
+
+unsigned int tcp_checksum(struct in_addr src, struct in_addr dest,
+			  const void *seg, unsigned int len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dest;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} __packed pseudo;
+
+	net_copy_ip(&pseudo.src, &src);
+	net_copy_ip(&pseudo.dest, &dest);
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(len);
+
+	return add_ip_checksums(sizeof(pseudo),
+				compute_ip_checksum(&pseudo, sizeof(pseudo)),
+				compute_ip_checksum(seg, len));
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+	int hdr_len = IP_TCP_HDR_SIZE;
+	u32 win;
+
+	if (action & TCP_SYN) {
+		/* the window in a SYN is never scaled */
+		opt[0] = TCP_OPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		opt[4] = TCP_OPT_NOP;
+		opt[5] = TCP_OPT_WS;
+		opt[6] = 3;
+		opt[7] = tcp_rcv_wscale;
+		hdr_len += 8;
+		win = min(TCP_RCV_WINDOW, 0xffff);
+	} else {
+		/* without window scaling, the window must fit in 16 bits */
+		win = min(TCP_RCV_WINDOW >> tcp_rcv_wscale, 0xffff);
+	}
+
+	net_set_ip_header(pkt, dest, net_ip, hdr_len + payload_len,
+			  IPPROTO_TCP);
+
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(tcp_seq_num);
+	ip->tcp_ack = (action & TCP_ACK) ? htonl(tcp_ack_num) : 0;
+	ip->tcp_hlen = ((hdr_len - IP_HDR_SIZE) / 4) << 4;
+	ip->tcp_flags = action;
+	ip->tcp_win = htons(win);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = tcp_checksum(net_ip, dest, pkt + IP_HDR_SIZE,
+				    hdr_len - IP_HDR_SIZE + payload_len);
+
+	return hdr_len;
+}
+
+static void tcp_send_segment(u8 action, u32 seq, const void *data,
+			     unsigned int len)
+{
+	if (len)
+		memcpy(net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE,
+		       data, len);
+	net_send_ip_packet(tcp_remote_ethaddr, tcp_remote_ip, tcp_remote_port,
+			   tcp_our_port, len, IPPROTO_TCP, action, seq,
+			   tcp_rcv_nxt);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+	tcp_ack_pending = 0;
+}
+
+/* (Re)send whatever data is not acknowledged yet */
+static void tcp_send_data(void)
+{
+	unsigned int done = tcp_snd_una - tcp_snd_seq;
+
+	tcp_send_segment(TCP_ACK | TCP_PSH, tcp_snd_una, tcp_snd_buf + done,
+			 tcp_snd_len - done);
+	tcp_ack_pending = 0;
+}
+
+static void tcp_set_timeout(void)
+{
+	net_set_timeout_handler(tcp_ack_pending ? TCP_DELACK_MS : TCP_RTO_MS,
+				tcp_timeout_handler);
+}
+
+/* Forget the connection and tell the user */
+static void tcp_abort(void)
+{
+	tcp_state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+	if (tcp_handler)
+		tcp_handler(TCP_EV_ABORTED, NULL, 0);
+}
+
+static void tcp_timeout_handler(void)
+{
+	if (tcp_ack_pending) {
+		tcp_send_ack();
+		tcp_set_timeout();
+		return;
+	}
+
+	if (++tcp_retries > TCP_RETRIES) {
+		debug("TCP: connection timed out\n");
+		tcp_abort();
+		return;
+	}
+
+	switch (tcp_state) {
+	case TCP_SYN_SENT:
+		tcp_send_segment(TCP_SYN, tcp_snd_una, NULL, 0);
+		break;
+	case TCP_ESTABLISHED:
+	case TCP_CLOSE_WAIT:
+		if (tcp_snd_una != tcp_snd_nxt)
+			tcp_send_data();
+		else
+			tcp_send_ack();
+		break;
+	default:
+		return;
+	}
+	tcp_set_timeout();
+}
+
+void net_set_tcp_handler(rxhand_tcp_f *f)
+{
+	tcp_handler = f;
+	if (!f)
+		tcp_state = TCP_CLOSED;
+}
+
+void tcp_connect(struct in_addr dest, int dport)
+{
+	ulong rand = (ulong)get_ticks();
+	int i;
+
+	tcp_remote_ip = dest;
+	tcp_remote_port = dport;
+	tcp_our_port = 49152 + (rand % 16384);
+	memset(tcp_remote_ethaddr, 0, ARP_HLEN);
+
+	tcp_snd_una = rand * 0x9e3779b1;
+	tcp_snd_nxt = tcp_snd_una + 1;
+	tcp_snd_len = 0;
+	tcp_snd_mss = 536;
+	tcp_dup_acks = 0;
+
+	tcp_rcv_nxt = 0;
+	tcp_rcv_wscale = 0;
+	while ((TCP_RCV_WINDOW >> tcp_rcv_wscale) > 0xffff)
+		tcp_rcv_wscale++;
+	tcp_ack_pending = 0;
+	for (i = 0; i < TCP_OOO_SEGS; i++)
+		tcp_ooo[i].used = 0;
+
+	tcp_retries = 0;
+	tcp_state = TCP_SYN_SENT;
+	net_set_timeout_handler(TCP_RTO_MS, tcp_timeout_handler);
+	tcp_send_segment(TCP_SYN, tcp_snd_una, NULL, 0);
+}
+
+int tcp_send(const void *data, unsigned int len)
+{
+	if (tcp_state != TCP_ESTABLISHED || len > tcp_snd_mss)
+		return -EINVAL;
+	if (tcp_snd_una != tcp_snd_nxt)
+		return -EBUSY;
+
+	memcpy(tcp_snd_buf, data, len);
+	tcp_snd_len = len;
+	tcp_snd_seq = tcp_snd_nxt;
+	tcp_snd_nxt += len;
+	tcp_dup_acks = 0;
+	tcp_send_data();
+	tcp_set_timeout();
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	if (tcp_state == TCP_ESTABLISHED || tcp_state == TCP_CLOSE_WAIT)
+		tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt, NULL, 0);
+	tcp_state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+}
+
+/* Pick up the options we care about from a SYN */
+static void tcp_parse_options(const uchar *opt, int len)
+{
+	int wscale_ok = 0;
+
+	while (len > 0 && opt[0] != TCP_OPT_EOL) {
+		if (opt[0] == TCP_OPT_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		if (opt[0] == TCP_OPT_MSS && opt[1] == 4)
+			tcp_snd_mss = min_t(unsigned int, TCP_MSS,
+					    get_unaligned_be16(opt + 2));
+		else if (opt[0] == TCP_OPT_WS && opt[1] == 3)
+			wscale_ok = 1;
+		len -= opt[1];
+		opt += opt[1];
+	}
+
+	/* our window is only scaled if both ends offered scaling */
+	if (!wscale_ok)
+		tcp_rcv_wscale = 0;
+}
+
+static void tcp_rx_ack(u32 ack, unsigned int len, u8 flags)
+{
+	if (seq_after(ack, tcp_snd_una) && !seq_after(ack, tcp_snd_nxt)) {
+		tcp_snd_una = ack;
+		tcp_dup_acks = 0;
+	} else if (ack == tcp_snd_una && tcp_snd_una != tcp_snd_nxt &&
+		   !len && !(flags & TCP_FIN)) {
+		/* the remote is still waiting for our data */
+		if (++tcp_dup_acks == TCP_DUP_ACKS)
+			tcp_send_data();
+	}
+}
+
+/* Hold on to a segment which arrived ahead of a gap */
+static void tcp_ooo_add(u32 seq, const uchar *data, unsigned int len, int fin)
+{
+	struct tcp_ooo_seg *seg, *free = NULL;
+	int i;
+
+	for (i = 0; i < TCP_OOO_SEGS; i++) {
+		seg = &tcp_ooo[i];
+		if (seg->used && seg->seq == seq)
+			return;
+		if (!seg->used && !free)
+			free = seg;
+	}
+	if (!free || len > TCP_MSS)
+		return;
+
+	free->seq = seq;
+	free->len = len;
+	free->fin = fin;
+	free->used = 1;
+	memcpy(free->data, data, len);
+}
+
+/*
+ * Take the next held segment which now follows on from tcp_rcv_nxt, if
+ * any, dropping those which turn out to be duplicates.
+ */
+static struct tcp_ooo_seg *tcp_ooo_next(void)
+{
+	struct tcp_ooo_seg *seg;
+	int i;
+
+	for (i = 0; i < TCP_OOO_SEGS; i++) {
+		seg = &tcp_ooo[i];
+		if (!seg->used || seq_after(seg->seq, tcp_rcv_nxt))
+			continue;
+		seg->used = 0;
+		if (seq_after(seg->seq + seg->len + seg->fin, tcp_rcv_nxt))
+			return seg;
+	}
+
+	return NULL;
+}
+
+/*
+ * Deliver a segment which starts at tcp_rcv_nxt. Returns 1 if it carried
+ * a FIN, 0 if not, or -1 if the user closed the connection.
+ */
+static int tcp_deliver(const uchar *data, unsigned int len, int fin)
+{
+	if (len) {
+		tcp_rcv_nxt += len;
+		tcp_handler(TCP_EV_DATA, data, len);
+		if (tcp_state == TCP_CLOSED)
+			return -1;
+	}
+	if (fin)
+		tcp_rcv_nxt++;
+
+	return fin;
+}
+
+static void tcp_rx_data(u32 seq, const uchar *data, unsigned int len,
+			int fin, int push)
+{
+	struct tcp_ooo_seg *seg;
+	int filled = 0;
+	u32 skip;
+	int ret;
+
+	if (!len && !fin)
+		return;
+
+	if (seq_before(seq, tcp_rcv_nxt)) {
+		/* drop what we already have, the ACK for it may be lost */
+		skip = tcp_rcv_nxt - seq;
+		if (skip > len || (skip == len && !fin)) {
+			tcp_send_ack();
+			return;
+		}
+		data += skip;
+		len -= skip;
+		seq = tcp_rcv_nxt;
+	}
+
+	if (seq != tcp_rcv_nxt) {
+		/* a gap: keep the data and send a duplicate ACK at once */
+		if (seq_before(seq, tcp_rcv_nxt + TCP_RCV_WINDOW))
+			tcp_ooo_add(seq, data, len, fin);
+		tcp_send_ack();
+		return;
+	}
+
+	ret = tcp_deliver(data, len, fin);
+	while (!ret && (seg = tcp_ooo_next())) {
+		skip = tcp_rcv_nxt - seg->seq;
+		ret = tcp_deliver(seg->data + skip, seg->len - skip, seg->fin);
+		filled = 1;
+	}
+	if (ret < 0)
+		return;
+
+	if (ret) {
+		tcp_state = TCP_CLOSE_WAIT;
+		tcp_send_ack();
+		tcp_handler(TCP_EV_CLOSED, NULL, 0);
+		return;
+	}
+
+	/* ACK every other segment, unless the remote wants it now */
+	if (++tcp_ack_pending >= 2 || filled || push)
+		tcp_send_ack();
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, unsigned int len)
+{
+	struct in_addr src = net_read_ip(&ip->ip_src);
+	unsigned int hlen, dlen;
+	const uchar *data;
+	u32 seq, ack;
+	u8 flags;
+
+	if (tcp_state == TCP_CLOSED || !tcp_handler || len < IP_TCP_HDR_SIZE)
+		return;
+	if (src.s_addr != tcp_remote_ip.s_addr ||
+	    ntohs(ip->tcp_src) != tcp_remote_port ||
+	    ntohs(ip->tcp_dst) != tcp_our_port)
+		return;
+
+	hlen = (ip->tcp_hlen >> 4) * 4;
+	if (hlen < TCP_HDR_SIZE || IP_HDR_SIZE + hlen > len)
+		return;
+	if (tcp_checksum(src, net_read_ip(&ip->ip_dst), &ip->tcp_src,
+			 len - IP_HDR_SIZE)) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	flags = ip->tcp_flags;
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	data = (const uchar *)&ip->tcp_src + hlen;
+	dlen = len - IP_HDR_SIZE - hlen;
+
+	if (tcp_state == TCP_SYN_SENT) {
+		if (!(flags & TCP_ACK) || ack != tcp_snd_nxt)
+			return;
+		if (flags & TCP_RST) {
+			debug("TCP: connection refused\n");
+			tcp_abort();
+			return;
+		}
+		if (!(flags & TCP_SYN))
+			return;
+
+		tcp_parse_options(data - (hlen - TCP_HDR_SIZE),
+				  hlen - TCP_HDR_SIZE);
+		tcp_rcv_nxt = seq + 1;
+		tcp_snd_una = ack;
+		tcp_state = TCP_ESTABLISHED;
+		tcp_retries = 0;
+		tcp_send_ack();
+		tcp_set_timeout();
+		tcp_handler(TCP_EV_CONNECTED, NULL, 0);
+		return;
+	}
+
+	if (flags & TCP_RST) {
+		if (seq_before(seq, tcp_rcv_nxt) ||
+		    !seq_before(seq, tcp_rcv_nxt + TCP_RCV_WINDOW))
+			return;
+		debug("TCP: connection reset\n");
+		tcp_abort();
+		return;
+	}
+
+	if (flags & TCP_SYN) {
+		/* our ACK of the SYN was lost */
+		tcp_send_ack();
+		return;
+	}
+	if (!(flags & TCP_ACK))
+		return;
+
+	tcp_retries = 0;
+	tcp_rx_ack(ack, dlen, flags);
+
+	if (tcp_state == TCP_ESTABLISHED)
+		tcp_rx_data(seq, data, dlen, flags & TCP_FIN, flags & TCP_PSH);
+	else if (dlen || (flags & TCP_FIN))
+		tcp_send_ack();
+
+	if (tcp_state != TCP_CLOSED)
+		tcp_set_timeout();
+}
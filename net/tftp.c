@@ -83,6 +83,14 @@ static ulong	tftp_prev_block;
 static ulong	tftp_block_wrap;
 /* memory offset due to wrapping */
 static ulong	tftp_block_wrap_offset;
+/* last block number acknowledged */
+static ulong	tftp_last_ack;
+/* blocks received ahead of tftp_prev_block + 1, bit n is block prev + 2 + n */
+static ulong	tftp_ahead_map;
+/* 1 if the final (short) block has been received out of order */
+static int	tftp_final_block_seen;
+/* block number of the final block, if tftp_final_block_seen */
+static ulong	tftp_final_block;
 static int	tftp_state;
 static ulong	tftp_load_addr;
 #ifdef CONFIG_LMB
@@ -138,6 +146,24 @@ static char tftp_filename[MAX_LEN];
 #define TFTP_MTU_BLOCKSIZE 1468
 #endif
 
+/*
+ * RFC 7440 window size: the number of blocks the server may send before
+ * waiting for an ACK. Blocks arriving out of order within the window are
+ * stored straight away and tracked in tftp_ahead_map, so the window can
+ * not usefully be larger than the number of bits in that map.
+ */
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE 1
+#endif
+#define TFTP_WINDOWSIZE_MAX	BITS_PER_LONG
+
+/* window size in use for the current transfer */
+static unsigned short tftp_windowsize = 1;
+/* window size to request from the server */
+static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
+
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
@@ -200,6 +226,9 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	tftp_last_ack = 0;
+	tftp_ahead_map = 0;
+	tftp_final_block_seen = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -352,6 +381,10 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/* and for more than one block in flight */
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_window_size_option, 0);
 		len = pkt - xp;
 		break;
 
@@ -405,6 +438,72 @@ static void tftp_send(void)
 			    tftp_remote_port, tftp_our_port, len);
 }
 
+/*
+ * Handle a received data block. With a window size larger than one the
+ * server sends several blocks per ACK, so blocks may arrive after a later
+ * one when a packet is lost or reordered. Such blocks are stored as they
+ * come and remembered in tftp_ahead_map; the ACK, which always names the
+ * last block received in order, is sent at the end of each window or as
+ * soon as the transfer is complete.
+ *
+ * @param block	Block number from the packet
+ * @param src	Block data
+ * @param len	Number of bytes in the block
+ * @return 0 if OK, non-zero if the block could not be stored
+ */
+static int tftp_receive_block(ulong block, uchar *src, unsigned len)
+{
+	ulong ahead = (unsigned short)(block - tftp_prev_block - 1);
+	ulong since_ack = (unsigned short)(block - tftp_last_ack);
+	int done = 0;
+	int more;
+
+	if (ahead <= TFTP_WINDOWSIZE_MAX) {
+		if (store_block(tftp_prev_block + ahead, src, len))
+			return -1;
+		if (len < tftp_block_size) {
+			tftp_final_block_seen = 1;
+			tftp_final_block = block;
+		}
+		if (ahead)
+			tftp_ahead_map |= 1UL << (ahead - 1);
+		timeout_count_max = tftp_timeout_count_max;
+		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+	}
+
+	if (!ahead) {
+		/* move past this block and any received ahead of it */
+		do {
+			tftp_cur_block = (unsigned short)(tftp_prev_block + 1);
+			update_block_number();
+			tftp_prev_block = tftp_cur_block;
+			if (tftp_final_block_seen &&
+			    tftp_prev_block == tftp_final_block)
+				done = 1;
+			more = tftp_ahead_map & 1;
+			tftp_ahead_map >>= 1;
+		} while (more && !done);
+	}
+
+	/*
+	 * Acknowledge once a window's worth of blocks has arrived, which will
+	 * prompt the remote for the next window. If blocks are missing at the
+	 * end of the window the remote resends from the first missing one.
+	 */
+	if (done || (since_ack >= tftp_windowsize &&
+		     since_ack < TFTP_SEQUENCE_SIZE / 2) ||
+	    (unsigned short)(tftp_prev_block - tftp_last_ack) >=
+	    tftp_windowsize) {
+		tftp_last_ack = tftp_prev_block;
+		tftp_send();
+	}
+
+	if (done)
+		tftp_complete();
+
+	return 0;
+}
+
 #ifdef CONFIG_CMD_TFTPPUT
 static void icmp_handler(unsigned type, unsigned code, unsigned dest,
 			 struct in_addr sip, unsigned src, uchar *pkt,
@@ -422,6 +521,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 {
 	__be16 proto;
 	__be16 *s;
+	ulong block;
 	int i;
 
 	if (dest != tftp_our_port) {
@@ -496,6 +596,16 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_windowsize = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				if (!tftp_windowsize ||
+				    tftp_windowsize > tftp_window_size_option)
+					tftp_windowsize = 1;
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_windowsize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -518,9 +628,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (len < 2)
 			return;
 		len -= 2;
-		tftp_cur_block = ntohs(*(__be16 *)pkt);
-
-		update_block_number();
+		block = ntohs(*(__be16 *)pkt);
 
 		if (tftp_state == STATE_SEND_RRQ)
 			debug("Server did not acknowledge timeout option!\n");
@@ -532,39 +640,21 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			tftp_remote_port = src;
 			new_transfer();
 
-			if (tftp_cur_block != 1) {	/* Assertion */
+			/* with a window, block 1 may simply be late */
+			if (block != 1 && tftp_windowsize == 1) { /* Assertion */
 				puts("\nTFTP error: ");
 				printf("First block is not block 1 (%ld)\n",
-				       tftp_cur_block);
+				       block);
 				puts("Starting again\n\n");
 				net_start_again();
 				break;
 			}
 		}
 
-		if (tftp_cur_block == tftp_prev_block) {
-			/* Same block again; ignore it. */
-			break;
-		}
-
-		tftp_prev_block = tftp_cur_block;
-		timeout_count_max = tftp_timeout_count_max;
-		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
-
-		if (store_block(tftp_cur_block - 1, pkt + 2, len)) {
+		if (tftp_receive_block(block, pkt + 2, len)) {
 			eth_halt();
 			net_set_state(NETLOOP_FAIL);
-			break;
 		}
-
-		/*
-		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
-		 */
-		tftp_send();
-
-		if (len < tftp_block_size)
-			tftp_complete();
 		break;
 
 	case TFTP_ERROR:
@@ -600,6 +690,8 @@ static void tftp_timeout_handler(void)
 	} else {
 		puts("T ");
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		/* the remote restarts its window from this ACK */
+		tftp_last_ack = tftp_cur_block;
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
 	}
@@ -638,6 +730,10 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = env_get("tftpwindowsize");
+	if (ep != NULL)
+		tftp_window_size_option = simple_strtol(ep, NULL, 10);
+
 	ep = env_get("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -659,8 +755,16 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	if (!tftp_window_size_option)
+		tftp_window_size_option = 1;
+	if (tftp_window_size_option > TFTP_WINDOWSIZE_MAX) {
+		printf("TFTP window size (%d) too large, set max = %d\n",
+		       tftp_window_size_option, TFTP_WINDOWSIZE_MAX);
+		tftp_window_size_option = TFTP_WINDOWSIZE_MAX;
+	}
+
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
@@ -759,8 +863,9 @@ void tftp_start(enum proto_t protocol)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_windowsize to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
 	tftp_tsize_num_hash = 0;
@@ -791,8 +896,9 @@ void tftp_start_server(void)
 	timeout_ms = TIMEOUT;
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_windowsize to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
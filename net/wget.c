@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP download (wget)
+ *
+ * Fetches a file with a single HTTP/1.1 GET and streams the body to the
+ * load address as it arrives. Any plain web server will do.
+ */
+
+#include <common.h>
+#include <env.h>
+#include <lmb.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Well known HTTP port # */
+#define WGET_PORT		80
+/* Room for the response headers */
+#define WGET_HDR_MAX		1024
+/* Longest path we request */
+#define WGET_PATH_MAX		256
+/* Number of bytes per "loading" hash, and hashes per line */
+#define WGET_HASH_BYTES		SZ_64K
+#define HASHES_PER_LINE		65
+
+static char wget_path[WGET_PATH_MAX];
+static struct in_addr wget_server_ip;
+static ulong wget_load_addr;
+static ulong wget_load_size;
+static ulong time_start;
+
+/* response headers received so far */
+static char wget_hdr[WGET_HDR_MAX + 1];
+static unsigned int wget_hdr_len;
+/* 1 once the headers are done and data is the body of the file */
+static int wget_in_body;
+/* length from the Content-Length header, or -1 if not known */
+static long wget_content_len;
+static ulong wget_received;
+static ulong wget_num_hash;
+
+static void wget_fail(void)
+{
+	tcp_close();
+	eth_halt();
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_complete(void)
+{
+	tcp_close();
+	time_start = get_timer(time_start);
+	if (time_start > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(net_boot_file_size /
+			time_start * 1000, "/s");
+	}
+	puts("\ndone\n");
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static void wget_send_request(void)
+{
+	char req[WGET_PATH_MAX + 128];
+	int len;
+
+	len = snprintf(req, sizeof(req),
+		       "GET %s%s HTTP/1.1\r\n"
+		       "Host: %pI4\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Connection: close\r\n\r\n",
+		       wget_path[0] == '/' ? "" : "/", wget_path,
+		       &wget_server_ip);
+	if (tcp_send(req, len)) {
+		puts("\nwget: cannot send request\n");
+		wget_fail();
+	}
+}
+
+/*
+ * Collect the response headers and check them. Returns the number of bytes
+ * of @data which belong to the headers, or -1 on error.
+ */
+static int wget_parse_header(const uchar *data, unsigned int len)
+{
+	unsigned int n = min(len, WGET_HDR_MAX - wget_hdr_len);
+	unsigned int status;
+	char *end, *p;
+
+	memcpy(wget_hdr + wget_hdr_len, data, n);
+	wget_hdr[wget_hdr_len + n] = '\0';
+	end = strstr(wget_hdr, "\r\n\r\n");
+	if (!end) {
+		wget_hdr_len += n;
+		if (wget_hdr_len == WGET_HDR_MAX) {
+			puts("\nwget: response headers too long\n");
+			return -1;
+		}
+		return n;
+	}
+	n = end + 4 - wget_hdr - wget_hdr_len;
+	*end = '\0';
+
+	p = strchr(wget_hdr, ' ');
+	status = p ? simple_strtoul(p + 1, NULL, 10) : 0;
+	if (strncmp(wget_hdr, "HTTP/1.", 7) || status != 200) {
+		p = strstr(wget_hdr, "\r\n");
+		if (p)
+			*p = '\0';
+		printf("\nwget: server replied '%s'\n", wget_hdr);
+		return -1;
+	}
+
+	for (p = strstr(wget_hdr, "\r\n"); p; p = strstr(p, "\r\n")) {
+		p += 2;
+		if (!strncasecmp(p, "Content-Length:", 15)) {
+			for (p += 15; *p == ' ' || *p == '\t'; p++)
+				;
+			wget_content_len = simple_strtoul(p, NULL, 10);
+		} else if (!strncasecmp(p, "Transfer-Encoding:", 18)) {
+			for (p += 18; *p == ' ' || *p == '\t'; p++)
+				;
+			if (strncasecmp(p, "identity", 8)) {
+				puts("\nwget: transfer encoding not supported\n");
+				return -1;
+			}
+		}
+	}
+
+	if (wget_load_size && wget_content_len > 0 &&
+	    (ulong)wget_content_len > wget_load_size) {
+		puts("\nwget error: ");
+		puts("trying to overwrite reserved memory...\n");
+		return -1;
+	}
+	wget_in_body = 1;
+
+	return n;
+}
+
+static int wget_store(const uchar *data, unsigned int len)
+{
+	void *ptr;
+
+	if (wget_load_size && wget_received + len > wget_load_size) {
+		puts("\nwget error: ");
+		puts("trying to overwrite reserved memory...\n");
+		return -1;
+	}
+
+	ptr = map_sysmem(wget_load_addr + wget_received, len);
+	memcpy(ptr, data, len);
+	unmap_sysmem(ptr);
+	wget_received += len;
+	net_boot_file_size = wget_received;
+
+	while (wget_num_hash < wget_received / WGET_HASH_BYTES) {
+		putc('#');
+		if (!(++wget_num_hash % HASHES_PER_LINE))
+			puts("\n\t ");
+	}
+
+	return 0;
+}
+
+static void wget_handler(enum tcp_event event, const uchar *data,
+			 unsigned int len)
+{
+	int used;
+
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		wget_send_request();
+		break;
+
+	case TCP_EV_DATA:
+		if (!wget_in_body) {
+			used = wget_parse_header(data, len);
+			if (used < 0) {
+				wget_fail();
+				break;
+			}
+			data += used;
+			len -= used;
+		}
+		if (len && wget_store(data, len)) {
+			wget_fail();
+			break;
+		}
+		if (wget_in_body && wget_content_len >= 0 &&
+		    wget_received >= (ulong)wget_content_len)
+			wget_complete();
+		break;
+
+	case TCP_EV_CLOSED:
+		if (!wget_in_body || (wget_content_len >= 0 &&
+				      wget_received < (ulong)wget_content_len)) {
+			puts("\nwget: connection closed early\n");
+			wget_fail();
+		} else {
+			wget_complete();
+		}
+		break;
+
+	case TCP_EV_ABORTED:
+		puts("\nwget: connection failed; starting again\n");
+		net_start_again();
+		break;
+	}
+}
+
+/* Initialize wget_load_addr and wget_load_size from load_addr and lmb */
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, load_addr);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#else
+	wget_load_size = 0;
+#endif
+	wget_load_addr = load_addr;
+	return 0;
+}
+
+void wget_start(void)
+{
+	wget_server_ip = net_server_ip;
+	if (!net_parse_bootfile(&wget_server_ip, wget_path, WGET_PATH_MAX)) {
+		puts("*** ERROR: no file name given\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4; our IP address is %pI4\n",
+	       &wget_server_ip, &net_ip);
+	printf("Filename '%s'.\n", wget_path);
+
+	if (wget_init_load_addr()) {
+		eth_halt();
+		net_set_state(NETLOOP_FAIL);
+		puts("\nwget error: ");
+		puts("trying to overwrite reserved memory...\n");
+		return;
+	}
+	printf("Load address: 0x%lx\n", wget_load_addr);
+	puts("Loading: *\b");
+
+	wget_hdr_len = 0;
+	wget_in_body = 0;
+	wget_content_len = -1;
+	wget_received = 0;
+	wget_num_hash = 0;
+	time_start = get_timer(0);
+
+	net_set_tcp_handler(wget_handler);
+	tcp_connect(wget_server_ip, WGET_PORT);
+}
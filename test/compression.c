@@ -6,11 +6,16 @@
 #include <common.h>
 #include <bootm.h>
 #include <command.h>
+#include <decomp_stream.h>
 #include <gzip.h>
 #include <lz4.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <os.h>
+#include <sandboxblockdev.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
+#include <linux/sizes.h>
 
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -119,6 +124,23 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/* zstd -19 -c /tmp/plain.txt > /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -294,6 +316,40 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(struct unit_test_state *uts,
+				 void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	ulong len;
+	int ret;
+
+	ret = decomp_stream_buf(IH_COMP_ZSTD, out, out_max, in, in_size, &len);
+	if (out_size)
+		*out_size = len;
+
+	return ret;
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -438,6 +494,320 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+static int compression_test_zstd(struct unit_test_state *uts)
+{
+	return run_test(uts, "zstd", compress_using_zstd,
+			uncompress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_zstd, 0);
+
+/**
+ * run_stream_test() - Check streaming decompression with split input
+ *
+ * The compressed data is passed in pieces of each size from 1 to @max_step
+ * bytes, so that every split point is covered.
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * @max_step:	Largest piece size to try
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_stream_test(struct unit_test_state *uts, int comp_type,
+			   mutate_func compress, int max_step)
+{
+	char comp_buf[TEST_BUFFER_SIZE], out[TEST_BUFFER_SIZE];
+	ulong comp_size = sizeof(comp_buf);
+	ulong unc_len = strlen(plain);
+	struct decomp_stream ds;
+	ulong pos, n;
+	int step;
+
+	ut_assertok(compress(uts, (void *)plain, unc_len, comp_buf,
+			     comp_size, &comp_size));
+	ut_asserteq(comp_type, decomp_stream_detect(comp_buf, comp_size));
+
+	for (step = 1; step <= max_step; step++) {
+		memset(out, 'A', sizeof(out));
+		ut_assertok(decomp_stream_init(&ds, comp_type, out, unc_len));
+		for (pos = 0; pos < comp_size; pos += n) {
+			n = min_t(ulong, step, comp_size - pos);
+			ut_assertok(decomp_stream_write(&ds, comp_buf + pos, n));
+		}
+		ut_asserteq(unc_len, decomp_stream_end(&ds));
+		ut_asserteq_mem(plain, out, unc_len);
+		ut_asserteq('A', out[unc_len]);
+	}
+
+	/* Data after the end of the stream is ignored */
+	ut_assertok(decomp_stream_init(&ds, comp_type, out, sizeof(out)));
+	ut_assertok(decomp_stream_write(&ds, comp_buf, comp_size));
+	ut_assert(ds.done);
+	ut_assertok(decomp_stream_write(&ds, plain, 16));
+	ut_asserteq(unc_len, decomp_stream_end(&ds));
+
+	/* A truncated stream is an error */
+	ut_assertok(decomp_stream_init(&ds, comp_type, out, sizeof(out)));
+	ut_assertok(decomp_stream_write(&ds, comp_buf, comp_size - 1));
+	ut_asserteq(-EINVAL, decomp_stream_end(&ds));
+
+	/* So is too little space for the output */
+	ut_assertok(decomp_stream_init(&ds, comp_type, out, unc_len - 1));
+	ut_asserteq(-ENOSPC, decomp_stream_write(&ds, comp_buf, comp_size));
+	ut_asserteq(-EINVAL, decomp_stream_end(&ds));
+
+	return 0;
+}
+
+static int compression_test_stream_gzip(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_GZIP, compress_using_gzip, 33);
+}
+COMPRESSION_TEST(compression_test_stream_gzip, 0);
+
+static int compression_test_stream_zstd(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_ZSTD, compress_using_zstd, 33);
+}
+COMPRESSION_TEST(compression_test_stream_zstd, 0);
+
+#ifdef CONFIG_CMD_UNZIP
+#define GZWRITE_TEST_FILE	"gzwrite_test.img"
+#define GZWRITE_TEST_BLKS	16
+
+/* Set up a host device filled with 0xff */
+static int gzwrite_test_bind(struct unit_test_state *uts,
+			     struct blk_desc **descp)
+{
+	char buf[GZWRITE_TEST_BLKS * 512];
+	int fd;
+
+	memset(buf, 0xff, sizeof(buf));
+	fd = os_open(GZWRITE_TEST_FILE, OS_O_RDWR | OS_O_CREAT | OS_O_TRUNC);
+	ut_assert(fd >= 0);
+	ut_asserteq(sizeof(buf), os_write(fd, buf, sizeof(buf)));
+	os_close(fd);
+	ut_assertok(host_dev_bind(0, GZWRITE_TEST_FILE));
+	ut_assertok(blk_get_device_by_str("host", "0", descp));
+
+	return 0;
+}
+
+static void gzwrite_test_unbind(void)
+{
+	host_dev_bind(0, NULL);
+	os_unlink(GZWRITE_TEST_FILE);
+}
+
+/*
+ * Write @comp to a host device with gzwrite(), starting at block 1, and
+ * check that @unc_len bytes of @unc end up there
+ */
+static int run_gzwrite_test(struct unit_test_state *uts, void *comp,
+			    ulong comp_len, const char *unc, ulong unc_len,
+			    ulong writebuf)
+{
+	char buf[GZWRITE_TEST_BLKS * 512];
+	struct blk_desc *desc;
+	ulong padded;
+
+	ut_assertok(gzwrite_test_bind(uts, &desc));
+	ut_assertok(gzwrite(comp, comp_len, desc, writebuf, 512, unc_len));
+	ut_asserteq(GZWRITE_TEST_BLKS, blk_dread(desc, 0, GZWRITE_TEST_BLKS,
+						 buf));
+	gzwrite_test_unbind();
+
+	ut_asserteq(0xff, (u8)buf[511]);
+	ut_asserteq_mem(unc, buf + 512, unc_len);
+
+	/* The last block is padded with zeroes */
+	padded = ALIGN(unc_len, 512);
+	ut_assertnull(memchr_inv(buf + 512 + unc_len, '\0', padded - unc_len));
+	ut_asserteq(0xff, (u8)buf[512 + padded]);
+
+	return 0;
+}
+
+static int compression_test_gzwrite(struct unit_test_state *uts)
+{
+	char unc[3000], comp[TEST_BUFFER_SIZE * 4];
+	struct blk_desc *desc;
+	ulong comp_len;
+	int i;
+
+	/* Use more than one buffer, including one which is all zero */
+	memset(unc, '\0', sizeof(unc));
+	for (i = 0; i < 1024; i++)
+		unc[i] = plain[i % strlen(plain)];
+	for (i = 2048; i < sizeof(unc); i++)
+		unc[i] = i;
+	ut_assertok(compress_using_gzip(uts, unc, sizeof(unc), comp,
+					sizeof(comp), &comp_len));
+	ut_assertok(run_gzwrite_test(uts, comp, comp_len, unc, sizeof(unc),
+				     1024));
+	ut_assertok(run_gzwrite_test(uts, comp, comp_len, unc, sizeof(unc),
+				     512));
+
+	/* A corrupted image is refused */
+	comp[comp_len - 8] ^= 1;
+	ut_assertok(gzwrite_test_bind(uts, &desc));
+	ut_asserteq(-1, gzwrite((void *)comp, comp_len, desc, 1024, 0, 0));
+	gzwrite_test_unbind();
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_gzwrite, 0);
+
+static int compression_test_gzwrite_zstd(struct unit_test_state *uts)
+{
+	ut_assertok(run_gzwrite_test(uts, (void *)zstd_compressed,
+				     zstd_compressed_size, plain,
+				     strlen(plain), 512));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_gzwrite_zstd, 0);
+#endif
+
+/* Size of each block in compression_test_lz4_blocks() (max_block_size 4) */
+#define LZ4_TEST_BLOCK_SIZE	SZ_64K
+
+/* Add an uncompressed block of @len bytes of @val to an LZ4 frame */
+static void *lz4_add_raw_block(void *ptr, int val, uint len)
+{
+	put_unaligned_le32(len | 1U << 31, ptr);
+	memset(ptr + 4, val, len);
+
+	return ptr + 4 + len;
+}
+
+/* Add the (compressed) block from lz4_compressed to an LZ4 frame */
+static void *lz4_add_plain_block(void *ptr)
+{
+	/* The block follows the 7-byte frame header */
+	uint len = 4 + get_unaligned_le32(lz4_compressed + 7);
+
+	memcpy(ptr, lz4_compressed + 7, len);
+
+	return ptr + len;
+}
+
+/**
+ * run_lz4_blocks_test() - Check an LZ4 frame made up of several blocks
+ *
+ * The frame has two full blocks with the plain text in between or at the
+ * end, so that the block sizes do or do not allow the blocks to be
+ * decompressed in parallel.
+ *
+ * @plain_last:	true to put the plain text at the end
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_lz4_blocks_test(struct unit_test_state *uts, bool plain_last)
+{
+	const ulong size = LZ4_TEST_BLOCK_SIZE;
+	ulong unc_len = 2 * size + strlen(plain);
+	char *comp, *out, *ptr, *expect;
+	size_t out_len;
+
+	comp = malloc(unc_len + 0x100);
+	out = malloc(unc_len + 1);
+	ut_assertnonnull(comp);
+	ut_assertnonnull(out);
+
+	/* Version 1, independent blocks, 64KB maximum block size */
+	memcpy(comp, "\x04\x22\x4d\x18\x60\x40\x00", 7);
+	ptr = lz4_add_raw_block(comp + 7, 'a', size);
+	if (plain_last) {
+		ptr = lz4_add_raw_block(ptr, 'b', size);
+		ptr = lz4_add_plain_block(ptr);
+	} else {
+		ptr = lz4_add_plain_block(ptr);
+		ptr = lz4_add_raw_block(ptr, 'b', size);
+	}
+	put_unaligned_le32(0, ptr);
+	ptr += 4;
+
+	memset(out, 'A', unc_len + 1);
+	out_len = unc_len;
+	ut_assertok(ulz4fn(comp, ptr - comp, out, &out_len));
+	ut_asserteq(unc_len, out_len);
+	ut_asserteq('A', out[unc_len]);
+
+	expect = out;
+	ut_asserteq('a', expect[0]);
+	ut_asserteq('a', expect[size - 1]);
+	expect += size;
+	if (!plain_last) {
+		ut_asserteq_mem(plain, expect, strlen(plain));
+		expect += strlen(plain);
+	}
+	ut_asserteq('b', expect[0]);
+	ut_asserteq('b', expect[size - 1]);
+	expect += size;
+	if (plain_last)
+		ut_asserteq_mem(plain, expect, strlen(plain));
+
+	/* Too little space for the output */
+	out_len = unc_len - 1;
+	ut_assert(ulz4fn(comp, ptr - comp, out, &out_len));
+
+	free(out);
+	free(comp);
+
+	return 0;
+}
+
+static int compression_test_lz4_blocks(struct unit_test_state *uts)
+{
+	ut_assertok(run_lz4_blocks_test(uts, true));
+	ut_assertok(run_lz4_blocks_test(uts, false));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lz4_blocks, 0);
+
+/* Check zstd data made up of several frames, as written by pzstd */
+static int compression_test_zstd_frames(struct unit_test_state *uts)
+{
+	/* Skippable frame with 4 bytes of data */
+	static const char skip[] =
+		"\x50\x2a\x4d\x18\x04\x00\x00\x00\x00\x00\x00\x00";
+	char comp[3 * TEST_BUFFER_SIZE], out[3 * TEST_BUFFER_SIZE];
+	ulong unc_len = strlen(plain);
+	ulong comp_size, len;
+	char *ptr = comp;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		memcpy(ptr, zstd_compressed, zstd_compressed_size);
+		ptr += zstd_compressed_size;
+		if (!i) {
+			memcpy(ptr, skip, sizeof(skip) - 1);
+			ptr += sizeof(skip) - 1;
+		}
+	}
+	comp_size = ptr - comp;
+
+	memset(out, 'A', sizeof(out));
+	ut_assertok(decomp_stream_buf(IH_COMP_ZSTD, out, sizeof(out), comp,
+				      comp_size, &len));
+	ut_asserteq(3 * unc_len, len);
+	for (i = 0; i < 3; i++)
+		ut_asserteq_mem(plain, out + i * unc_len, unc_len);
+	ut_asserteq('A', out[len]);
+
+	/* Too little space for the output */
+	ut_asserteq(-ENOSPC, decomp_stream_buf(IH_COMP_ZSTD, out, len - 1, comp,
+					       comp_size, &len));
+
+	/* A corrupt frame is found whichever way the frames are decompressed */
+	comp[zstd_compressed_size + sizeof(skip) - 1 + 32] ^= 0xff;
+	ut_assert(decomp_stream_buf(IH_COMP_ZSTD, out, sizeof(out), comp,
+				    comp_size, &len));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_frames, 0);
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -528,6 +898,12 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+static int compression_test_bootm_zstd(struct unit_test_state *uts)
+{
+	return run_bootm_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_bootm_zstd, 0);
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
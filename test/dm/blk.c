@@ -5,6 +5,8 @@
 
 #include <common.h>
 #include <dm.h>
+#include <os.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/state.h>
 #include <dm/test.h>
@@ -162,3 +164,203 @@ static int dm_test_blk_get_from_parent(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_get_from_parent, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#define ASYNC_TEST_FILE		"blk_async_test.img"
+#define ASYNC_TEST_REQS		6
+
+static void blk_async_count(struct blk_req *req)
+{
+	int *countp = req->priv;
+
+	(*countp)++;
+}
+
+static void blk_async_setup(struct blk_req *req, enum blk_req_op op,
+			    lbaint_t start, struct blk_sg *sg, int sg_count,
+			    int *countp)
+{
+	memset(req, '\0', sizeof(*req));
+	req->op = op;
+	req->start = start;
+	req->sg = sg;
+	req->sg_count = sg_count;
+	req->complete = blk_async_count;
+	req->priv = countp;
+}
+
+/* Test asynchronous requests with a driver which supports them */
+static int dm_test_blk_async(struct unit_test_state *uts)
+{
+	char data[ASYNC_TEST_REQS * 2 * 512], buf[ASYNC_TEST_REQS * 2 * 512];
+	struct blk_sg sg[ASYNC_TEST_REQS][2];
+	struct blk_req reqs[ASYNC_TEST_REQS];
+	struct blk_desc *desc;
+	struct udevice *dev;
+	int count = 0;
+	int fd, i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7 + i / 512;
+	fd = os_open(ASYNC_TEST_FILE, OS_O_RDWR | OS_O_CREAT | OS_O_TRUNC);
+	ut_assert(fd >= 0);
+	ut_asserteq(sizeof(data), os_write(fd, data, sizeof(data)));
+	os_close(fd);
+	ut_assertok(host_dev_bind(0, ASYNC_TEST_FILE));
+	ut_assertok(blk_get_device(IF_TYPE_HOST, 0, &dev));
+	desc = dev_get_uclass_platdata(dev);
+
+	/* Each request reads two blocks, into two separate buffers */
+	memset(buf, '\0', sizeof(buf));
+	for (i = 0; i < ASYNC_TEST_REQS; i++) {
+		sg[i][0].buf = buf + (i * 2 + 1) * 512;
+		sg[i][0].blkcnt = 1;
+		sg[i][1].buf = buf + i * 2 * 512;
+		sg[i][1].blkcnt = 1;
+		blk_async_setup(&reqs[i], BLK_REQ_READ, i * 2, sg[i], 2,
+				&count);
+		ut_assertok(blk_submit(dev, &reqs[i]));
+		ut_asserteq(-EINPROGRESS, reqs[i].ret);
+	}
+	ut_asserteq(0, count);
+
+	/* The driver takes four at once and finishes one on each poll */
+	ut_asserteq(ASYNC_TEST_REQS - 1, blk_poll(dev));
+	ut_asserteq(1, count);
+	ut_assertok(reqs[0].ret);
+	ut_asserteq(2, reqs[0].done);
+	ut_asserteq(-EINPROGRESS, reqs[1].ret);
+
+	ut_assertok(blk_wait(dev, &reqs[ASYNC_TEST_REQS - 1]));
+	ut_asserteq(ASYNC_TEST_REQS, count);
+	ut_asserteq(0, blk_poll(dev));
+	for (i = 0; i < ASYNC_TEST_REQS * 2; i++)
+		ut_asserteq_mem(data + (i ^ 1) * 512, buf + i * 512, 512);
+
+	/* Write a block and read it back */
+	memset(buf, 'w', 512);
+	sg[0][0].buf = buf;
+	blk_async_setup(&reqs[0], BLK_REQ_WRITE, 3, sg[0], 1, &count);
+	ut_assertok(blk_submit(dev, &reqs[0]));
+	ut_assertok(blk_wait(dev, &reqs[0]));
+	ut_asserteq(1, reqs[0].done);
+	ut_asserteq(1, blk_dread(desc, 3, 1, buf + 512));
+	ut_asserteq_mem(buf, buf + 512, 512);
+
+	/* Bad requests are refused */
+	blk_async_setup(&reqs[0], BLK_REQ_READ, 0, sg[0], 0, &count);
+	ut_asserteq(-EINVAL, blk_submit(dev, &reqs[0]));
+	blk_async_setup(&reqs[0], BLK_REQ_READ, desc->lba, sg[0], 1, &count);
+	ut_asserteq(-EINVAL, blk_submit(dev, &reqs[0]));
+
+	ut_assertok(host_dev_bind(0, NULL));
+	os_unlink(ASYNC_TEST_FILE);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test asynchronous requests with a driver which does not support them */
+static int dm_test_blk_async_sync(struct unit_test_state *uts)
+{
+	struct blk_desc *desc;
+	struct blk_sg sg;
+	struct blk_req req;
+	char buf[512 * 2];
+	int count = 0;
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &desc));
+
+	/* The request is finished by the time blk_submit() returns */
+	memset(buf, '\0', sizeof(buf));
+	sg.buf = buf;
+	sg.blkcnt = 2;
+	blk_async_setup(&req, BLK_REQ_READ, 0, &sg, 1, &count);
+	ut_assertok(blk_submit(desc->bdev, &req));
+	ut_asserteq(1, count);
+	ut_assertok(req.ret);
+	ut_asserteq(2, req.done);
+	ut_asserteq_str("this is a test", buf);
+	ut_asserteq(0, blk_poll(desc->bdev));
+	ut_assertok(blk_wait(desc->bdev, &req));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async_sync, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+/* Test the block cache lookup, eviction and read-ahead */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_stats old, stats;
+	struct blk_desc desc;
+	char buf[512 * 8], out[512 * 2];
+	lbaint_t ra_start;
+	void *ra_buf;
+	int i;
+
+	blkcache_stats(&old);
+	/* four lines of four blocks, up to eight blocks of read-ahead */
+	blkcache_configure(4, 4, 8);
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i / 512;
+
+	/* A read spanning two cached lines is a hit */
+	blkcache_fill(IF_TYPE_HOST, 9, 0, 8, 512, buf);
+	ut_asserteq(1, blkcache_read(IF_TYPE_HOST, 9, 3, 2, 512, out));
+	ut_asserteq(3, out[0]);
+	ut_asserteq(4, out[512]);
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 9, 7, 2, 512, out));
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 8, 0, 1, 512, out));
+
+	/* Only lines starting within the data are cached */
+	blkcache_fill(IF_TYPE_HOST, 9, 10, 6, 512, buf);
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 9, 10, 1, 512, out));
+	ut_asserteq(1, blkcache_read(IF_TYPE_HOST, 9, 12, 1, 512, out));
+	ut_asserteq(2, out[0]);
+
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.hits);
+	ut_asserteq(3, stats.misses);
+	ut_asserteq(3, stats.entries);
+
+	/* The least-recently used line (0..3) is evicted first */
+	blkcache_fill(IF_TYPE_HOST, 9, 20, 8, 512, buf);
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 9, 0, 1, 512, out));
+	ut_asserteq(1, blkcache_read(IF_TYPE_HOST, 9, 4, 1, 512, out));
+	blkcache_stats(&stats);
+	ut_asserteq(4, stats.entries);
+
+	blkcache_invalidate(IF_TYPE_HOST, 9);
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 9, 0, 1, 512, out));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+
+	/* Random reads are widened to whole lines */
+	memset(&desc, '\0', sizeof(desc));
+	desc.if_type = IF_TYPE_HOST;
+	desc.devnum = 9;
+	desc.blksz = 512;
+	desc.lba = 30;
+	ut_asserteq(4, blkcache_prefetch(&desc, 5, 1, &ra_start, &ra_buf));
+	ut_asserteq(4, ra_start);
+	ut_asserteq(0, blkcache_prefetch(&desc, 12, 4, &ra_start, &ra_buf));
+
+	/* Sequential reads grow the read-ahead window up to the maximum */
+	ut_asserteq(8, blkcache_prefetch(&desc, 16, 1, &ra_start, &ra_buf));
+	ut_asserteq(16, ra_start);
+	ut_asserteq(8, blkcache_prefetch(&desc, 17, 1, &ra_start, &ra_buf));
+	ut_asserteq(16, ra_start);
+
+	/* but not past the end of the device */
+	desc.lba = 22;
+	ut_asserteq(6, blkcache_prefetch(&desc, 18, 1, &ra_start, &ra_buf));
+	blkcache_stats(&stats);
+	ut_asserteq(3, stats.readaheads);
+
+	blkcache_configure(old.max_blocks_per_entry, old.max_entries,
+			   old.max_readahead);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, 0);
+#endif
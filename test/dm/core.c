@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -904,3 +905,421 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+/* Find a driver for a compatible string the slow way */
+static struct driver *find_compat_driver(const char *compat,
+					 const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match;
+	struct driver *entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++) {
+			if (!strcmp(of_match->compatible, compat)) {
+				*idp = of_match;
+				return entry;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Test that every compatible string finds the first driver that has it */
+static int dm_test_lookup_compat(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match, *id, *expect_id = NULL;
+	struct driver *entry, *drv;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++) {
+			ut_assertok(lists_driver_lookup_compat(
+					of_match->compatible, &drv, &id));
+			ut_asserteq_ptr(find_compat_driver(of_match->compatible,
+							   &expect_id), drv);
+			ut_asserteq_ptr(expect_id, id);
+		}
+	}
+	ut_asserteq(-ENOENT, lists_driver_lookup_compat("denx,no-such-device",
+							&drv, &id));
+
+	return 0;
+}
+DM_TEST(dm_test_lookup_compat, 0);
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+/* Test the fallback used when there is no memory for the hash table */
+static int dm_test_lookup_compat_nomem(struct unit_test_state *uts)
+{
+	struct lists_compat_hash *tab;
+	const struct udevice_id *id;
+	struct driver *drv;
+
+	/* Make sure the table has been built */
+	ut_assertok(lists_driver_lookup_compat("denx,u-boot-fdt-test", &drv,
+					       &id));
+	tab = gd->compat_hash;
+	ut_assert(!IS_ERR_OR_NULL(tab));
+
+	gd->compat_hash = ERR_PTR(-ENOMEM);
+	ut_assertok(lists_driver_lookup_compat("denx,u-boot-fdt-test", &drv,
+					       &id));
+	ut_asserteq_ptr(DM_GET_DRIVER(testfdt_drv), drv);
+	ut_asserteq_str("denx,u-boot-fdt-test", id->compatible);
+	ut_asserteq(-ENOENT, lists_driver_lookup_compat("denx,no-such-device",
+							&drv, &id));
+	gd->compat_hash = tab;
+
+	return 0;
+}
+DM_TEST(dm_test_lookup_compat_nomem, 0);
+#endif
+
+#if CONFIG_IS_ENABLED(DM_PROBE_ASYNC)
+/* Number of times a test device returns -EAGAIN from probe() */
+struct dm_test_async_pdata {
+	int polls;
+	struct udevice *dep;	/* device to probe when starting, if any */
+};
+
+struct dm_test_async_priv {
+	int calls;
+	int start_seq;
+	int done_seq;
+	int dep_ret;		/* result of probing @dep */
+};
+
+/* Sequence of events seen by the test devices */
+static int dm_test_async_seq;
+
+static int test_async_probe(struct udevice *dev)
+{
+	struct dm_test_async_pdata *pdata = dev_get_platdata(dev);
+	struct dm_test_async_priv *priv = dev_get_priv(dev);
+
+	if (!priv->calls++) {
+		priv->start_seq = ++dm_test_async_seq;
+		if (pdata->dep)
+			priv->dep_ret = device_probe(pdata->dep);
+	}
+	if (priv->calls <= pdata->polls)
+		return -EAGAIN;
+	priv->done_seq = ++dm_test_async_seq;
+
+	return 0;
+}
+
+static int test_async_ofdata_to_platdata(struct udevice *dev)
+{
+	struct dm_test_async_pdata *pdata = dev_get_platdata(dev);
+
+	pdata->polls = dev_read_u32_default(dev, "polls", 0);
+
+	return 0;
+}
+
+static const struct udevice_id test_async_ids[] = {
+	{ .compatible = "denx,u-boot-async-test" },
+	{ }
+};
+
+U_BOOT_DRIVER(test_async_drv) = {
+	.name	= "test_async_drv",
+	.id	= UCLASS_TEST_DUMMY,
+	.of_match	= test_async_ids,
+	.bind	= dm_scan_fdt_dev,
+	.ofdata_to_platdata	= test_async_ofdata_to_platdata,
+	.probe	= test_async_probe,
+	.priv_auto_alloc_size	= sizeof(struct dm_test_async_priv),
+	.platdata_auto_alloc_size	= sizeof(struct dm_test_async_pdata),
+	.flags	= DM_FLAG_PROBE_ASYNC,
+};
+
+/* The same driver in a uclass whose post_probe() method can fail */
+U_BOOT_DRIVER(test_async_uc_drv) = {
+	.name	= "test_async_uc_drv",
+	.id	= UCLASS_TEST,
+	.probe	= test_async_probe,
+	.priv_auto_alloc_size	= sizeof(struct dm_test_async_priv),
+	.flags	= DM_FLAG_PROBE_ASYNC,
+};
+
+static int dm_test_async_bind(struct unit_test_state *uts,
+			      struct udevice *parent, const char *name,
+			      struct dm_test_async_pdata *pdata,
+			      struct udevice **devp)
+{
+	struct driver *drv = lists_driver_lookup_name("test_async_drv");
+
+	ut_assertnonnull(drv);
+	ut_assertok(device_bind(parent, drv, name, pdata, -1, devp));
+
+	return 0;
+}
+
+static int dm_test_async_calls(struct udevice *dev)
+{
+	struct dm_test_async_priv *priv = dev_get_priv(dev);
+
+	return priv->calls;
+}
+
+/* Test probing devices in the background */
+static int dm_test_probe_async(struct unit_test_state *uts)
+{
+	struct dm_test_async_pdata pdata_a = { .polls = 3 };
+	struct dm_test_async_pdata pdata_b = { .polls = 2 };
+	struct dm_test_async_pdata pdata_c = { .polls = 1 };
+	struct dm_test_async_pdata pdata_d = { .polls = 2 };
+	struct udevice *a, *b, *c, *d;
+	struct dm_test_async_priv *priv_a, *priv_b;
+
+	dm_test_async_seq = 0;
+	ut_assertok(dm_test_async_bind(uts, dm_root(), "a", &pdata_a, &a));
+	ut_assertok(dm_test_async_bind(uts, a, "b", &pdata_b, &b));
+	ut_assertok(dm_test_async_bind(uts, dm_root(), "c", &pdata_c, &c));
+	ut_assertok(dm_test_async_bind(uts, dm_root(), "d", &pdata_d, &d));
+
+	/* The child must wait for its parent before it is started */
+	ut_assertok(device_probe_async(a));
+	ut_assertok(device_probe_async(b));
+	ut_assertok(device_probe_async(c));
+	ut_assert(device_active(a));
+	ut_assert(!device_active(b));
+	ut_assert(device_active(c));
+	ut_asserteq(1, dm_test_async_calls(a));
+	ut_asserteq(1, dm_test_async_calls(c));
+
+	/* Each poll calls probe() once for each device that is started */
+	ut_asserteq(2, dm_probe_async_poll());
+	ut_asserteq(2, dm_test_async_calls(a));
+	ut_assert(!(c->flags & DM_FLAG_PROBE_PENDING));
+	ut_asserteq(2, dm_test_async_calls(c));
+	ut_asserteq(2, dm_probe_async_poll());
+	ut_assert(!device_active(b));
+	ut_asserteq(1, dm_probe_async_poll());
+	ut_assert(!(a->flags & DM_FLAG_PROBE_PENDING));
+	ut_assert(device_active(b));
+	ut_assert(b->flags & DM_FLAG_PROBE_PENDING);
+	priv_a = dev_get_priv(a);
+	priv_b = dev_get_priv(b);
+	ut_assert(priv_a->done_seq < priv_b->start_seq);
+
+	/* device_probe() waits for a device in the queue */
+	ut_asserteq(1, dm_test_async_calls(b));
+	ut_assertok(device_probe(b));
+	ut_assert(!(b->flags & DM_FLAG_PROBE_PENDING));
+	ut_asserteq(3, dm_test_async_calls(b));
+	ut_asserteq(0, dm_probe_async_poll());
+
+	/* Without the queue, device_probe() polls the driver itself */
+	ut_assertok(device_probe(d));
+	ut_assert(device_active(d));
+	ut_asserteq(3, dm_test_async_calls(d));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async, 0);
+
+/* Test that a device waiting in device_probe() is not used half-probed */
+static int dm_test_probe_async_busy(struct unit_test_state *uts)
+{
+	struct dm_test_async_pdata pdata_a = { .polls = 1 };
+	struct dm_test_async_pdata pdata_b = { .polls = 0 };
+	struct dm_test_async_pdata pdata_c = { .polls = 3 };
+	struct dm_test_async_priv *priv_b;
+	struct udevice *a, *b, *c;
+
+	/* b is started while c is being probed, and tries to probe c */
+	ut_assertok(dm_test_async_bind(uts, dm_root(), "a", &pdata_a, &a));
+	ut_assertok(dm_test_async_bind(uts, a, "b", &pdata_b, &b));
+	ut_assertok(dm_test_async_bind(uts, dm_root(), "c", &pdata_c, &c));
+	pdata_b.dep = c;
+	ut_assertok(device_probe_async(a));
+	ut_assertok(device_probe_async(b));
+	ut_assert(!device_active(b));
+
+	ut_assertok(device_probe(c));
+	ut_assert(device_active(c));
+	ut_assert(device_active(b));
+	priv_b = dev_get_priv(b);
+	ut_asserteq(-EBUSY, priv_b->dep_ret);
+	ut_assertok(dm_probe_async_wait());
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_busy, 0);
+
+/* Check that @dev finished probing before @user started */
+static bool dm_test_async_before(struct udevice *dev, struct udevice *user)
+{
+	struct dm_test_async_priv *priv = dev_get_priv(dev);
+	struct dm_test_async_priv *user_priv = dev_get_priv(user);
+
+	return priv->done_seq < user_priv->start_seq;
+}
+
+/* Test that devices wait for their clocks, resets and regulators */
+static int dm_test_probe_async_deps(struct unit_test_state *uts)
+{
+	static const char *const names[][2] = {
+		{ "async-clk", "async-clk-user" },
+		{ "async-reset", "async-reset-user" },
+		{ "async-ldo", "async-ldo-user" },
+	};
+	struct udevice *dev[ARRAY_SIZE(names)], *user[ARRAY_SIZE(names)];
+	int i;
+
+	dm_test_async_seq = 0;
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		ut_assertok(uclass_find_device_by_name(UCLASS_TEST_DUMMY,
+						       names[i][0], &dev[i]));
+		ut_assertok(uclass_find_device_by_name(UCLASS_TEST_DUMMY,
+						       names[i][1], &user[i]));
+		ut_assertok(device_probe_async(dev[i]));
+		ut_assertok(device_probe_async(user[i]));
+		ut_assert(device_active(dev[i]));
+		ut_assert(!device_active(user[i]));
+	}
+	ut_assertok(dm_probe_async_wait());
+
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		ut_assert(device_active(user[i]));
+		ut_assert(dm_test_async_before(dev[i], user[i]));
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_deps, DM_TESTF_SCAN_FDT);
+
+/* Test that a device being probed synchronously holds back its users */
+static int dm_test_probe_async_sync_dep(struct unit_test_state *uts)
+{
+	struct udevice *clk, *ldo, *user;
+
+	dm_test_async_seq = 0;
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_DUMMY, "async-clk",
+					       &clk));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_DUMMY, "async-ldo",
+					       &ldo));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_DUMMY,
+					       "async-multi-user", &user));
+
+	/* The user waits for the regulator, which finishes during the clock */
+	ut_assertok(device_probe_async(ldo));
+	ut_assertok(device_probe_async(user));
+	ut_assert(!device_active(user));
+	ut_assertok(device_probe(clk));
+	ut_assert(!(ldo->flags & DM_FLAG_PROBE_PENDING));
+	ut_assert(!device_active(user));
+
+	ut_assertok(dm_probe_async_wait());
+	ut_assert(device_active(user));
+	ut_assert(dm_test_async_before(clk, user));
+	ut_assert(dm_test_async_before(ldo, user));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_sync_dep, DM_TESTF_SCAN_FDT);
+
+/* Test that devices which depend on each other are still probed */
+static int dm_test_probe_async_cycle(struct unit_test_state *uts)
+{
+	struct udevice *bus, *a, *b;
+
+	dm_test_async_seq = 0;
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_DUMMY, "async-cycle",
+					       &bus));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_DUMMY,
+					       "async-cycle-a", &a));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_DUMMY,
+					       "async-cycle-b", &b));
+
+	/* Both wait for their parent, then for each other */
+	ut_assertok(device_probe_async(bus));
+	ut_assertok(device_probe_async(a));
+	ut_assertok(device_probe_async(b));
+	ut_asserteq(2, dm_probe_async_poll());
+	ut_assert(!device_active(a));
+	ut_assert(!device_active(b));
+
+	/* The first one is started anyway */
+	ut_asserteq(2, dm_probe_async_poll());
+	ut_assert(device_active(a));
+	ut_assert(!device_active(b));
+	ut_assertok(dm_probe_async_wait());
+	ut_assert(device_active(b));
+	ut_assert(dm_test_async_before(bus, a));
+	ut_assert(dm_test_async_before(a, b));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_cycle, DM_TESTF_SCAN_FDT);
+
+/* Test removing and unbinding devices in the background queue */
+static int dm_test_probe_async_remove(struct unit_test_state *uts)
+{
+	struct dm_test_async_pdata pdata_a = { .polls = 5 };
+	struct dm_test_async_pdata pdata_b = { .polls = 1 };
+	struct dm_test_async_pdata pdata_c = { .polls = 2 };
+	struct udevice *a, *b, *c;
+
+	ut_assertok(dm_test_async_bind(uts, dm_root(), "a", &pdata_a, &a));
+	ut_assertok(dm_test_async_bind(uts, a, "b", &pdata_b, &b));
+	ut_assertok(dm_test_async_bind(uts, dm_root(), "c", &pdata_c, &c));
+	ut_assertok(device_probe_async(a));
+	ut_assertok(device_probe_async(b));
+	ut_assertok(device_probe_async(c));
+
+	/* A device which has not started is just dropped from the queue */
+	ut_assertok(device_unbind(b));
+	ut_asserteq(2, dm_probe_async_poll());
+
+	/* Removing a device waits for its probe to finish first */
+	ut_assertok(device_remove(a, DM_REMOVE_NORMAL));
+	ut_assert(!device_active(a));
+	ut_assert(!(a->flags & DM_FLAG_PROBE_PENDING));
+
+	/* Waiting for the queue probes everything left */
+	ut_assertok(dm_probe_async_wait());
+	ut_assert(device_active(c));
+	ut_asserteq(0, dm_probe_async_poll());
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_remove, 0);
+
+/* Test a queued device whose uclass fails to finish probing it */
+static int dm_test_probe_async_post_fail(struct unit_test_state *uts)
+{
+	struct dm_test_async_pdata pdata = { .polls = 1 };
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *dev;
+	struct driver *drv;
+	int removes;
+
+	drv = lists_driver_lookup_name("test_async_uc_drv");
+	ut_assertnonnull(drv);
+	ut_assertok(device_bind(dm_root(), drv, "a", &pdata, -1, &dev));
+	ut_assertok(device_probe_async(dev));
+	ut_assert(dev->flags & DM_FLAG_PROBE_PENDING);
+
+	/* The device is removed like any other, and its memory freed */
+	dms->fail_post_probe = 1;
+	removes = dm_testdrv_op_count[DM_TEST_OP_PRE_REMOVE];
+	ut_asserteq(0, dm_probe_async_poll());
+	ut_asserteq(removes + 1, dm_testdrv_op_count[DM_TEST_OP_PRE_REMOVE]);
+	ut_assert(!device_active(dev));
+	ut_assert(!(dev->flags & (DM_FLAG_PROBE_PENDING | DM_FLAG_PROBING)));
+	ut_assertnull(dev_get_priv(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_post_fail, 0);
+#endif
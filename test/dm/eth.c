@@ -11,7 +11,9 @@
 #include <env.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
+#include <net/tcp.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -429,3 +431,175 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, DM_TESTF_SCAN_FDT);
+
+#if defined(CONFIG_CMD_WGET)
+#define SB_WGET_SEG		1000
+#define SB_WGET_FILE_SIZE	5000
+#define SB_WGET_BUF		1000000
+
+/*
+ * A fake HTTP server on the other end of the wire. It answers a GET with
+ * a short file, sending the second and third segments in the wrong order.
+ * With no_wscale set, it does not offer window scaling.
+ */
+static struct {
+	bool no_wscale;
+	u16 client_port;
+	u32 client_nxt;		/* next sequence number expected from U-Boot */
+	int gap_acks;		/* ACKs asking for the late segment */
+	u32 min_win;		/* smallest window advertised by U-Boot */
+	char resp[SB_WGET_FILE_SIZE + 100];
+	unsigned int resp_len;
+	int nsegs;
+	int next_seg;
+} sb_wget;
+
+#define SB_WGET_ISS		0x12345678
+
+static void sb_wget_inject(struct udevice *dev, u8 flags, u32 seq,
+			   const void *opt, unsigned int optlen,
+			   const void *data, unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth;
+	struct ip_tcp_hdr *ip;
+	unsigned int hlen = TCP_HDR_SIZE + optlen;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, net_ethaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	ip = (void *)eth + ETHER_HDR_SIZE;
+	memcpy((void *)ip + IP_TCP_HDR_SIZE, opt, optlen);
+	memcpy((void *)ip + IP_TCP_HDR_SIZE + optlen, data, len);
+	net_set_ip_header((uchar *)ip, net_ip, priv->fake_host_ipaddr,
+			  IP_HDR_SIZE + hlen + len, IPPROTO_TCP);
+	ip->tcp_src = htons(80);
+	ip->tcp_dst = htons(sb_wget.client_port);
+	ip->tcp_seq = htonl(seq);
+	ip->tcp_ack = htonl(sb_wget.client_nxt);
+	ip->tcp_hlen = (hlen / 4) << 4;
+	ip->tcp_flags = flags;
+	ip->tcp_win = htons(0xffff);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = tcp_checksum(priv->fake_host_ipaddr, net_ip,
+				    &ip->tcp_src, hlen + len);
+
+	priv->recv_packet_length[priv->recv_packets++] =
+		ETHER_HDR_SIZE + IP_HDR_SIZE + hlen + len;
+}
+
+static int sb_wget_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct unit_test_state *uts = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *ip = packet + ETHER_HDR_SIZE;
+	static const u8 syn_opts[] = { 2, 4, 0x05, 0xb4, 1, 3, 3, 7 };
+	unsigned int hlen, dlen;
+	u32 ack;
+	int seg;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_TCP)
+		return 0;
+
+	len = ntohs(ip->ip_len);
+	hlen = (ip->tcp_hlen >> 4) * 4;
+	dlen = len - IP_HDR_SIZE - hlen;
+	ut_asserteq(0, tcp_checksum(net_ip, priv->fake_host_ipaddr,
+				    &ip->tcp_src, len - IP_HDR_SIZE));
+	ut_asserteq(80, ntohs(ip->tcp_dst));
+
+	if (ip->tcp_flags & TCP_SYN) {
+		sb_wget.client_port = ntohs(ip->tcp_src);
+		sb_wget.client_nxt = ntohl(ip->tcp_seq) + 1;
+		/* the MSS option comes first, window scaling follows it */
+		sb_wget_inject(dev, TCP_SYN | TCP_ACK, SB_WGET_ISS, syn_opts,
+			       sb_wget.no_wscale ? 4 : sizeof(syn_opts),
+			       NULL, 0);
+		return 0;
+	}
+
+	sb_wget.min_win = min_t(u32, sb_wget.min_win, ntohs(ip->tcp_win));
+
+	ack = ntohl(ip->tcp_ack);
+	if (ack == SB_WGET_ISS + 1 + SB_WGET_SEG)
+		sb_wget.gap_acks++;
+
+	if (dlen) {
+		ut_asserteq_mem("GET /file.bin HTTP/1.1\r\n",
+				(void *)ip + IP_HDR_SIZE + hlen, 24);
+		sb_wget.client_nxt += dlen;
+		sb_wget.nsegs = DIV_ROUND_UP(sb_wget.resp_len, SB_WGET_SEG);
+	}
+
+	/* send what we can, with segments 1 and 2 swapped */
+	while (sb_wget.next_seg < sb_wget.nsegs &&
+	       priv->recv_packets < PKTBUFSRX) {
+		seg = sb_wget.next_seg++;
+		if (seg == 1 || seg == 2)
+			seg = 3 - seg;
+		sb_wget_inject(dev, TCP_ACK, SB_WGET_ISS + 1 + seg * SB_WGET_SEG,
+			       NULL, 0, sb_wget.resp + seg * SB_WGET_SEG,
+			       min_t(unsigned int, SB_WGET_SEG,
+				     sb_wget.resp_len - seg * SB_WGET_SEG));
+	}
+
+	return 0;
+}
+
+static int sb_wget_run(struct unit_test_state *uts, bool no_wscale)
+{
+	char *buf;
+	int i;
+
+	memset(&sb_wget, '\0', sizeof(sb_wget));
+	sb_wget.no_wscale = no_wscale;
+	sb_wget.min_win = ~0U;
+	sb_wget.resp_len = sprintf(sb_wget.resp,
+				   "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n",
+				   SB_WGET_FILE_SIZE);
+	for (i = 0; i < SB_WGET_FILE_SIZE; i++)
+		sb_wget.resp[sb_wget.resp_len++] = i * 7;
+
+	buf = map_sysmem(SB_WGET_BUF, SB_WGET_FILE_SIZE);
+	memset(buf, '\0', SB_WGET_FILE_SIZE);
+
+	sandbox_eth_set_tx_handler(0, sb_wget_handler);
+	/* Used by all of the ut_assert macros in the tx_handler */
+	sandbox_eth_set_priv(0, uts);
+
+	env_set("ethact", "eth@10002000");
+	load_addr = SB_WGET_BUF;
+	copy_filename(net_boot_file_name, "1.1.2.2:/file.bin",
+		      sizeof(net_boot_file_name));
+	ut_asserteq(SB_WGET_FILE_SIZE, net_loop(WGET));
+
+	/* the gap left by the late segment should have been reported */
+	ut_assert(sb_wget.gap_acks > 0);
+	/* the window never closes, even when it cannot be scaled */
+	ut_assert(sb_wget.min_win >= SB_WGET_FILE_SIZE);
+	for (i = 0; i < SB_WGET_FILE_SIZE; i++)
+		ut_asserteq((u8)(i * 7), (u8)buf[i]);
+	unmap_sysmem(buf);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	return 0;
+}
+
+static int dm_test_eth_wget(struct unit_test_state *uts)
+{
+	ut_assertok(sb_wget_run(uts, false));
+	ut_assertok(sb_wget_run(uts, true));
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_wget, DM_TESTF_SCAN_FDT);
+#endif
@@ -4,6 +4,7 @@
  */
 
 #include <common.h>
+#include <bloblist.h>
 #include <dm.h>
 #include <mmc.h>
 #include <dm/test.h>
@@ -41,3 +42,73 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Multi-block transfers use CMD23 when the host and card support it */
+static int dm_test_mmc_cmd23(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char cmp[1024];
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assert(mmc->card_caps & MMC_CAP_CMD23);
+	ut_assert(mmc->host_caps & MMC_CAP_CMD23);
+
+	/* sandbox rejects a CMD12 sent after a CMD23 transfer */
+	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	memset(cmp, '\0', sizeof(cmp));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
+	ut_assertok(strcmp(cmp, "this is a test"));
+
+	/* Without CMD23 the transfer must be stopped with CMD12 instead */
+	mmc->card_caps &= ~MMC_CAP_CMD23;
+	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	memset(cmp, '\0', sizeof(cmp));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
+	ut_assertok(strcmp(cmp, "this is a test"));
+	mmc->card_caps |= MMC_CAP_CMD23;
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cmd23, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* The bus mode selected for a card is cached and used next time */
+static int dm_test_mmc_mode_cache(struct unit_test_state *uts)
+{
+	struct mmc_mode_cache_entry *entry;
+	struct mmc_mode_cache *cache;
+	struct udevice *dev;
+	struct mmc *mmc;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	cache = bloblist_find(BLOBLISTT_MMC_MODE, sizeof(*cache));
+	ut_assertnonnull(cache);
+
+	/* All the sandbox cards have the same CID so share an entry */
+	entry = &cache->entry[0];
+	ut_asserteq_mem(mmc->cid, entry->cid, sizeof(mmc->cid));
+	ut_asserteq(mmc->selected_mode, entry->mode);
+	ut_asserteq(mmc->bus_width, entry->bus_width);
+	ut_asserteq(0, cache->entry[1].bus_width);
+
+	/* The cached mode is used */
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(entry->mode, mmc->selected_mode);
+	ut_asserteq(1, cache->next);
+
+	/* A mode the card cannot do is ignored and the entry updated */
+	entry->mode = UHS_SDR104;
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(SD_LEGACY, mmc->selected_mode);
+	ut_asserteq(SD_LEGACY, entry->mode);
+	ut_asserteq(1, cache->next);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_mode_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -1,11 +1,17 @@
 // SPDX-License-Identifier: GPL-2.0+
 
 #include <common.h>
+#include <command.h>
 #include <dm.h>
+#include <fdtdec.h>
+#include <malloc.h>
+#include <dm/of_access.h>
 #include <dm/of_extra.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static int dm_test_ofnode_compatible(struct unit_test_state *uts)
 {
 	ofnode root_node = ofnode_path("/");
@@ -58,3 +64,193 @@ static int dm_test_ofnode_fmap(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_ofnode_fmap, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that phandle and property lookups in the live tree find each one */
+static int dm_test_ofnode_live_lookup(struct unit_test_state *uts)
+{
+	static const char value[] = "new";
+	struct property *pp, *first;
+	struct device_node *np;
+	int hashed = 0;
+	ofnode node;
+	int len;
+
+	for_each_of_allnodes(np) {
+		if (np->phandle)
+			ut_asserteq_ptr(np,
+					of_find_node_by_phandle(np->phandle));
+		if (np->prop_hash)
+			hashed++;
+		for (pp = np->properties; pp; pp = pp->next) {
+			for (first = np->properties; first; first = first->next)
+				if (!strcmp(first->name, pp->name))
+					break;
+			ut_asserteq_ptr(first, of_find_property(np, pp->name,
+								&len));
+			ut_asserteq(first->length, len);
+		}
+		ut_assertnull(of_find_property(np, "no-such-prop", &len));
+		ut_asserteq(-FDT_ERR_NOTFOUND, len);
+	}
+	ut_assert(hashed > 0);
+
+	/* A property added to a node with a hash table can be found */
+	node = ofnode_path("/a-test");
+	ut_assertok(ofnode_write_prop(node, "new-value", sizeof(value),
+				      value));
+	ut_asserteq_str(value, ofnode_read_string(node, "new-value"));
+	ut_asserteq(1234, ofnode_read_u32_default(node, "int-value", 0));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_live_lookup, DM_TESTF_LIVE_TREE);
+
+#if CONFIG_IS_ENABLED(OF_FDT_CACHE)
+static int dm_test_ofnode_fdt_cache(struct unit_test_state *uts)
+{
+	const void *old_blob = gd->fdt_blob;
+	struct fdtdec_cache *cache = &gd->fdt_cache;
+	int size, offset, gpio_offset, alias;
+	ofnode node, gpio;
+	ulong hits, misses;
+	uint phandle;
+	void *blob;
+
+	/* Work on a copy of the tree so that it can be changed */
+	size = fdt_totalsize(old_blob) + 1024;
+	blob = malloc(size);
+	ut_assertnonnull(blob);
+	ut_assertok(fdt_open_into(old_blob, blob, size));
+	gd->fdt_blob = blob;
+
+	/* A repeated path lookup is answered from the cache */
+	node = ofnode_path("/a-test");
+	ut_assert(ofnode_valid(node));
+	hits = cache->hits;
+	ut_asserteq(ofnode_to_offset(node),
+		    ofnode_to_offset(ofnode_path("/a-test")));
+	ut_asserteq(hits + 1, cache->hits);
+
+	/* Likewise a phandle and a property */
+	gpio_offset = fdt_path_offset(blob, "/base-gpios");
+	phandle = fdt_get_phandle(blob, gpio_offset);
+	ut_assert(phandle);
+	gpio = ofnode_get_by_phandle(phandle);
+	ut_asserteq(gpio_offset, ofnode_to_offset(gpio));
+	ut_asserteq(1234, ofnode_read_u32_default(node, "int-value", 0));
+	hits = cache->hits;
+	misses = cache->misses;
+	ut_asserteq(gpio_offset,
+		    ofnode_to_offset(ofnode_get_by_phandle(phandle)));
+	ut_asserteq(1234, ofnode_read_u32_default(node, "int-value", 0));
+	ut_asserteq(hits + 2, cache->hits);
+	ut_asserteq(misses, cache->misses);
+
+	/* Missing entries are not cached */
+	ut_assert(!ofnode_valid(ofnode_path("/no-such-node")));
+	ut_assert(!ofnode_valid(ofnode_path("/no-such-node")));
+	ut_asserteq(misses + 2, cache->misses);
+
+	/* Adding a property to the root node moves every other node */
+	ut_assertok(fdt_setprop_string(blob, 0, "cache-test", "value"));
+	offset = fdt_path_offset(blob, "/a-test");
+	ut_assert(offset != ofnode_to_offset(node));
+	node = ofnode_path("/a-test");
+	ut_asserteq(offset, ofnode_to_offset(node));
+	ut_asserteq(fdt_path_offset(blob, "/base-gpios"),
+		    ofnode_to_offset(ofnode_get_by_phandle(phandle)));
+	ut_asserteq(1234, ofnode_read_u32_default(node, "int-value", 0));
+
+	/* A change in place is seen without dropping the cache */
+	ut_assertok(fdt_setprop_inplace_u32(blob, offset, "int-value", 5678));
+	ut_asserteq(5678, ofnode_read_u32_default(node, "int-value", 0));
+
+	/* An alias changed in place is followed */
+	ut_asserteq(offset, fdtdec_path_offset(blob, "testfdt8"));
+	alias = fdt_path_offset(blob, "/aliases");
+	ut_assertok(fdt_setprop_inplace(blob, alias, "testfdt8", "/b-test",
+					sizeof("/b-test")));
+	ut_asserteq(fdt_path_offset(blob, "/b-test"),
+		    fdtdec_path_offset(blob, "testfdt8"));
+
+	/* The fdt command drops the cache */
+	misses = cache->misses;
+	ut_asserteq(offset, ofnode_to_offset(ofnode_path("/a-test")));
+	ut_asserteq(misses, cache->misses);
+	run_command("fdt addr", 0);
+	ut_asserteq(offset, ofnode_to_offset(ofnode_path("/a-test")));
+	ut_asserteq(misses + 1, cache->misses);
+
+	/* Other trees do not use the cache */
+	hits = cache->hits;
+	misses = cache->misses;
+	ut_asserteq(fdt_path_offset(old_blob, "/a-test"),
+		    fdtdec_path_offset(old_blob, "/a-test"));
+	ut_asserteq(hits, cache->hits);
+	ut_asserteq(misses, cache->misses);
+
+	gd->fdt_blob = old_blob;
+	free(blob);
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_fdt_cache, DM_TESTF_FLAT_TREE);
+
+/*
+ * Build a tree with a node @name, holding property 'x' if @with_x, else
+ * followed by a node 'b' holding 'x'
+ */
+static int dm_test_fdt_cache_tree(void *blob, int size, const char *name,
+				  bool with_x)
+{
+	int node, ret;
+
+	ret = fdt_create_empty_tree(blob, size);
+	if (ret)
+		return ret;
+
+	/* New nodes go before their siblings, so add 'b' first */
+	if (!with_x) {
+		node = fdt_add_subnode(blob, 0, "b");
+		if (node < 0)
+			return node;
+		ret = fdt_setprop_u32(blob, node, "x", 2);
+		if (ret)
+			return ret;
+	}
+	node = fdt_add_subnode(blob, 0, name);
+	if (node < 0)
+		return node;
+
+	return with_x ? fdt_setprop_u32(blob, node, "x", 1) : 0;
+}
+
+/* A cached property is only used while it belongs to the same node */
+static int dm_test_ofnode_fdt_cache_prop(struct unit_test_state *uts)
+{
+	const void *old_blob = gd->fdt_blob;
+	char blob[256];
+	int node, len;
+
+	/*
+	 * In the first tree, property 'x' of the first node is at the same
+	 * offset as property 'x' of node 'b' in the second, and both trees
+	 * have the same size
+	 */
+	ut_assertok(dm_test_fdt_cache_tree(blob, sizeof(blob),
+					   "abcdefghijklmno", true));
+	gd->fdt_blob = blob;
+	node = fdt_first_subnode(blob, 0);
+	ut_assertnonnull(fdtdec_getprop(blob, node, "x", &len));
+
+	ut_assertok(dm_test_fdt_cache_tree(blob, sizeof(blob), "a", false));
+	ut_asserteq(node, fdt_first_subnode(blob, 0));
+	ut_assertnull(fdtdec_getprop(blob, node, "x", &len));
+	ut_asserteq(-FDT_ERR_NOTFOUND, len);
+
+	gd->fdt_blob = old_blob;
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_fdt_cache_prop, DM_TESTF_FLAT_TREE);
+#endif
@@ -753,6 +753,76 @@ static int dm_test_fdt_phandle(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_fdt_phandle, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+#if CONFIG_IS_ENABLED(DM_DEVICE_INDEX)
+/* Test that looking up devices in the index gives the same result as a walk */
+static int dm_test_fdt_device_index(struct unit_test_state *uts)
+{
+	struct dm_device_index *idx = gd->dm_index;
+	struct udevice *dev, *first, *found;
+	struct uclass *uc;
+	ulong lookups;
+	ofnode node;
+	uint phandle;
+
+	ut_assertnonnull(idx);
+	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		enum uclass_id id = uc->uc_drv->id;
+
+		uclass_foreach_dev(dev, uc) {
+			node = dev_ofnode(dev);
+			if (!ofnode_valid(node))
+				continue;
+			uclass_foreach_dev(first, uc) {
+				if (ofnode_equal(dev_ofnode(first), node))
+					break;
+			}
+			ut_assertok(uclass_find_device_by_ofnode(id, node,
+								 &found));
+			ut_asserteq_ptr(first, found);
+			ut_assertok(device_find_global_by_ofnode(node, &found));
+			ut_assert(ofnode_equal(node, dev_ofnode(found)));
+
+			phandle = dev_read_phandle(dev);
+			if (!phandle)
+				continue;
+			uclass_foreach_dev(first, uc) {
+				if (dev_read_phandle(first) == phandle)
+					break;
+			}
+			ut_assertok(device_index_find_by_phandle(id, phandle,
+								 &found));
+			ut_asserteq_ptr(first, found);
+		}
+	}
+
+	/* An unbound device can no longer be found */
+	ut_assertok(uclass_find_first_device(UCLASS_TEST_FDT, &dev));
+	ut_asserteq_str("a-test", dev->name);
+	node = dev_ofnode(dev);
+	lookups = idx->node_lookups;
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(-ENODEV, uclass_find_device_by_ofnode(UCLASS_TEST_FDT,
+							  node, &found));
+	ut_asserteq(-ENOENT, device_find_global_by_ofnode(node, &found));
+	ut_asserteq(lookups + 2, idx->node_lookups);
+
+	/* A device moved to another node is found there */
+	ut_assertok(uclass_find_first_device(UCLASS_TEST_FDT, &dev));
+	ut_asserteq_str("b-test", dev->name);
+	dev_set_ofnode(dev, node);
+	ut_assertok(uclass_find_device_by_ofnode(UCLASS_TEST_FDT, node,
+						 &found));
+	ut_asserteq_ptr(dev, found);
+	ut_asserteq(-ENODEV,
+		    uclass_find_device_by_ofnode(UCLASS_TEST_FDT,
+						 ofnode_path("/b-test"),
+						 &found));
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_device_index, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
 /* Test device_find_first_child_by_uclass() */
 static int dm_test_first_child(struct unit_test_state *uts)
 {
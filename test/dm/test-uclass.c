@@ -75,6 +75,8 @@ static int test_post_probe(struct udevice *dev)
 	ut_assert(priv);
 	ut_assert(device_active(dev));
 	priv->base_add = 0;
+	if (dms->fail_post_probe)
+		return -EIO;
 	if (dms->skip_post_probe)
 		return 0;
 	if (&prev->uclass_node != &uc->dev_head) {
@@ -120,3 +120,77 @@ static int dm_test_virtio_remove(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_virtio_remove, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that several buffers take one ring entry with indirect descriptors */
+static int dm_test_virtio_ring_indirect(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct virtqueue *vq;
+	struct virtio_sg sg[3], *sgs[3];
+	struct vring_desc *desc;
+	char hdr[16], data[512];
+	u8 status;
+	int i;
+
+	/* check probe success */
+	ut_assertok(uclass_first_device(UCLASS_VIRTIO, &bus));
+
+	/* check the child virtio-blk device is bound */
+	ut_assertok(device_find_first_child(bus, &dev));
+
+	/* fake the virtio device probe, as in dm_test_virtio_all_ops() */
+	uc_priv = dev_get_uclass_priv(bus);
+	uc_priv->vdev = dev;
+	__virtio_set_bit(bus, VIRTIO_RING_F_INDIRECT_DESC);
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_assert(vq->indirect);
+	ut_asserteq(4, vq->num_free);
+
+	sg[0].addr = hdr;
+	sg[0].length = sizeof(hdr);
+	sg[1].addr = data;
+	sg[1].length = sizeof(data);
+	sg[2].addr = &status;
+	sg[2].length = sizeof(status);
+	for (i = 0; i < 3; i++)
+		sgs[i] = &sg[i];
+	ut_assertok(virtqueue_add(vq, sgs, 1, 2));
+	ut_asserteq(3, vq->num_free);
+
+	/* check the ring entry points to a table with all three buffers */
+	ut_asserteq(VRING_DESC_F_INDIRECT,
+		    virtio16_to_cpu(dev, vq->vring.desc[0].flags));
+	ut_asserteq(3 * sizeof(struct vring_desc),
+		    virtio32_to_cpu(dev, vq->vring.desc[0].len));
+	desc = (struct vring_desc *)(uintptr_t)virtio64_to_cpu(dev,
+						vq->vring.desc[0].addr);
+	for (i = 0; i < 3; i++) {
+		ut_asserteq_ptr(sg[i].addr, (void *)(uintptr_t)
+				virtio64_to_cpu(dev, desc[i].addr));
+		ut_asserteq(sg[i].length, virtio32_to_cpu(dev, desc[i].len));
+	}
+	ut_asserteq(VRING_DESC_F_NEXT, virtio16_to_cpu(dev, desc[0].flags));
+	ut_asserteq(VRING_DESC_F_NEXT | VRING_DESC_F_WRITE,
+		    virtio16_to_cpu(dev, desc[1].flags));
+	ut_asserteq(VRING_DESC_F_WRITE, virtio16_to_cpu(dev, desc[2].flags));
+
+	/* a single buffer does not need a table */
+	ut_assertok(virtqueue_add(vq, sgs, 1, 0));
+	ut_asserteq(2, vq->num_free);
+	ut_asserteq(0, virtio16_to_cpu(dev, vq->vring.desc[1].flags));
+
+	/* pretend the device has used both, then check they come back */
+	vq->vring.used->ring[0].id = cpu_to_virtio32(dev, 0);
+	vq->vring.used->ring[1].id = cpu_to_virtio32(dev, 1);
+	vq->vring.used->idx = cpu_to_virtio16(dev, 2);
+	ut_asserteq_ptr(hdr, virtqueue_get_buf(vq, NULL));
+	ut_asserteq_ptr(hdr, virtqueue_get_buf(vq, NULL));
+	ut_assertnull(virtqueue_get_buf(vq, NULL));
+	ut_asserteq(4, vq->num_free);
+
+	ut_assertok(virtio_del_vqs(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_indirect, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests and a benchmark for the implementations of CRC32 and CRC32C
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <time.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+#include <linux/sizes.h>
+
+/* The usual check string, and its CRCs */
+#define CRC_CHECK	"123456789"
+#define CRC32_CHECK	0xcbf43926
+#define CRC32C_CHECK	0xe3069283
+
+#define CRC_TEST_LEN	1000
+#define CRC_BENCH_LEN	SZ_4M
+
+/* Reflected polynomials, as used by the bitwise reference below */
+#define CRC32_POLY_LE	0xedb88320
+
+static void crc_test_fill(uint8_t *buf, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = i * 7 + (i >> 8);
+}
+
+/* Compute a CRC one bit at a time, without any table */
+static uint32_t crc_test_bitwise(uint32_t crc, uint32_t poly,
+				 const uint8_t *buf, int len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *buf++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (crc & 1 ? poly : 0);
+	}
+
+	return crc;
+}
+
+/*
+ * Lengths to check: every one up to 64 covers the tail handling of the
+ * wider loops, then larger steps up to CRC_TEST_LEN
+ */
+static int crc_test_next_len(int len)
+{
+	return len < 64 ? len + 1 : len + 37;
+}
+
+/*
+ * Each implementation, including the portable one, must agree with a
+ * bitwise CRC at every alignment
+ */
+static int lib_test_crc32_backends(struct unit_test_state *uts)
+{
+	const struct crc32_backend *backend;
+	uint8_t buf[CRC_TEST_LEN + 8];
+	int i, start, len;
+
+	crc_test_fill(buf, sizeof(buf));
+	ut_asserteq(CRC32_CHECK, crc32(0, (uint8_t *)CRC_CHECK, 9));
+
+	for (i = 0; (backend = crc32_get_backend(i)); i++) {
+		if (backend->probe && !backend->probe())
+			continue;
+
+		ut_asserteq(CRC32_CHECK,
+			    ~backend->crc32(~0U, (uint8_t *)CRC_CHECK, 9));
+		for (start = 0; start < 8; start++) {
+			for (len = 0; len <= CRC_TEST_LEN;
+			     len = crc_test_next_len(len)) {
+				ut_asserteq(crc_test_bitwise(len, CRC32_POLY_LE,
+							     buf + start, len),
+					    backend->crc32(len, buf + start,
+							   len));
+			}
+		}
+	}
+
+	/* the portable code comes last */
+	ut_assert(i > 0);
+	ut_asserteq_str("generic", crc32_get_backend(i - 1)->name);
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32_backends, 0);
+
+#ifdef CONFIG_CRC32C
+static int lib_test_crc32c(struct unit_test_state *uts)
+{
+	const struct crc32_backend *backend;
+	uint8_t buf[CRC_TEST_LEN + 8];
+	uint32_t table[256];
+	int i, start, len;
+
+	crc_test_fill(buf, sizeof(buf));
+	crc32c_init(table, CRC32C_POLY);
+	ut_asserteq(CRC32C_CHECK, ~crc32c_cal(~0U, CRC_CHECK, 9, table));
+	for (start = 0; start < 8; start++) {
+		for (len = 0; len <= CRC_TEST_LEN;
+		     len = crc_test_next_len(len)) {
+			ut_asserteq(crc_test_bitwise(len, CRC32C_POLY,
+						     buf + start, len),
+				    crc32c_cal(len, (char *)buf + start, len,
+					       table));
+		}
+	}
+
+	for (i = 0; (backend = crc32_get_backend(i)); i++) {
+		if (!backend->crc32c || (backend->probe && !backend->probe()))
+			continue;
+
+		ut_asserteq(CRC32C_CHECK,
+			    ~backend->crc32c(~0U, (uint8_t *)CRC_CHECK, 9));
+		for (start = 0; start < 8; start++) {
+			for (len = 0; len <= CRC_TEST_LEN;
+			     len = crc_test_next_len(len)) {
+				ut_asserteq(crc_test_bitwise(len, CRC32C_POLY,
+							     buf + start, len),
+					    backend->crc32c(len, buf + start,
+							    len));
+			}
+		}
+	}
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32c, 0);
+#endif
+
+#ifdef CONFIG_UT_LIB_CRC32_BENCH
+/* Show the speed of each implementation the CPU supports */
+static int lib_test_crc32_bench(struct unit_test_state *uts)
+{
+	const struct crc32_backend *backend;
+	uint32_t crc, expect, expect_c;
+	ulong start, us;
+	uint8_t *buf;
+	int i;
+
+	buf = malloc(CRC_BENCH_LEN);
+	ut_assertnonnull(buf);
+	crc_test_fill(buf, CRC_BENCH_LEN);
+	expect = crc32_no_comp_generic(0, buf, CRC_BENCH_LEN);
+	expect_c = crc_test_bitwise(0, CRC32C_POLY, buf, CRC_BENCH_LEN);
+
+	for (i = 0; (backend = crc32_get_backend(i)); i++) {
+		if (backend->probe && !backend->probe())
+			continue;
+
+		start = timer_get_us();
+		crc = backend->crc32(0, buf, CRC_BENCH_LEN);
+		us = timer_get_us() - start;
+		printf("crc32  %-8s %8lu us %6lu MB/s\n", backend->name, us,
+		       us ? CRC_BENCH_LEN / us : 0);
+		ut_asserteq(expect, crc);
+
+		if (!backend->crc32c)
+			continue;
+		start = timer_get_us();
+		crc = backend->crc32c(0, buf, CRC_BENCH_LEN);
+		us = timer_get_us() - start;
+		printf("crc32c %-8s %8lu us %6lu MB/s\n", backend->name, us,
+		       us ? CRC_BENCH_LEN / us : 0);
+		ut_asserteq(expect_c, crc);
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32_bench, 0);
+#endif
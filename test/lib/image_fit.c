@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for reusing digests while verifying FIT images
+ */
+
+#include <common.h>
+#include <image.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/rsa-checksum.h>
+#include <u-boot/sha256.h>
+
+/* SHA-256 of "abc" */
+static const uint8_t abc_sha256[SHA256_SUM_LEN] = {
+	0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+	0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+	0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+	0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+};
+
+static int lib_test_fit_digest_cache(struct unit_test_state *uts)
+{
+	uint8_t value[FIT_MAX_HASH_LEN], fake[SHA256_SUM_LEN];
+	struct image_region region;
+	char data[] = "abc";
+	int len;
+
+	memset(fake, 0x5a, sizeof(fake));
+
+	/* nothing is remembered outside a begin/end pair */
+	fit_digest_cache_put("sha256", data, 3, fake, sizeof(fake));
+	ut_asserteq(-ENOENT, fit_digest_cache_get("sha256", data, 3, value));
+	ut_assertok(calculate_hash(data, 3, "sha256", value, &len));
+	ut_asserteq(SHA256_SUM_LEN, len);
+	ut_asserteq_mem(abc_sha256, value, SHA256_SUM_LEN);
+
+	fit_verify_cache_begin();
+
+	/* a calculated digest is remembered */
+	ut_assertok(calculate_hash(data, 3, "sha256", value, &len));
+	ut_asserteq(SHA256_SUM_LEN,
+		    fit_digest_cache_get("sha256", data, 3, value));
+	ut_asserteq_mem(abc_sha256, value, SHA256_SUM_LEN);
+	ut_asserteq(-ENOENT, fit_digest_cache_get("sha1", data, 3, value));
+	ut_asserteq(-ENOENT, fit_digest_cache_get("sha256", data, 2, value));
+
+	/* a digest put by a loader is used instead of hashing again */
+	fit_digest_cache_put("sha256", data, 3, fake, sizeof(fake));
+	ut_assertok(calculate_hash(data, 3, "sha256", value, &len));
+	ut_asserteq_mem(fake, value, SHA256_SUM_LEN);
+	region.data = data;
+	region.size = 3;
+	ut_assertok(hash_calculate("sha256", &region, 1, value));
+	ut_asserteq_mem(fake, value, SHA256_SUM_LEN);
+
+	fit_verify_cache_end();
+
+	ut_asserteq(-ENOENT, fit_digest_cache_get("sha256", data, 3, value));
+	ut_assertok(calculate_hash(data, 3, "sha256", value, &len));
+	ut_asserteq_mem(abc_sha256, value, SHA256_SUM_LEN);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_fit_digest_cache, 0);
@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing Android sparse images
+ */
+
+#include <common.h>
+#include <image-sparse.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define SPARSE_TEST_BLKSZ	512
+/* Size of the buffers used by write_sparse_image(), in blocks */
+#define SPARSE_TEST_BUF_BLKS	(CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / \
+				 SPARSE_TEST_BLKSZ)
+#define SPARSE_TEST_ERASE_GRP	SPARSE_TEST_BUF_BLKS
+#define SPARSE_TEST_MAX_OPS	16
+
+/* One call to the write() or erase() method */
+struct sparse_test_op {
+	bool erase;
+	lbaint_t blk;
+	lbaint_t blkcnt;
+};
+
+/* Storage which records the calls made to it */
+struct sparse_test_disk {
+	u8 *data;
+	int op_count;
+	struct sparse_test_op ops[SPARSE_TEST_MAX_OPS];
+};
+
+static lbaint_t sparse_test_op(struct sparse_storage *info, bool erase,
+			       lbaint_t blk, lbaint_t blkcnt)
+{
+	struct sparse_test_disk *disk = info->priv;
+	struct sparse_test_op *op;
+
+	if (disk->op_count == SPARSE_TEST_MAX_OPS)
+		return 0;
+	op = &disk->ops[disk->op_count++];
+	op->erase = erase;
+	op->blk = blk;
+	op->blkcnt = blkcnt;
+
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_write(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt, const void *buffer)
+{
+	struct sparse_test_disk *disk = info->priv;
+
+	memcpy(disk->data + blk * SPARSE_TEST_BLKSZ, buffer,
+	       blkcnt * SPARSE_TEST_BLKSZ);
+
+	return sparse_test_op(info, false, blk, blkcnt);
+}
+
+static lbaint_t sparse_test_reserve(struct sparse_storage *info,
+				    lbaint_t blk, lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_erase(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt)
+{
+	struct sparse_test_disk *disk = info->priv;
+
+	memset(disk->data + blk * SPARSE_TEST_BLKSZ, '\0',
+	       blkcnt * SPARSE_TEST_BLKSZ);
+
+	return sparse_test_op(info, true, blk, blkcnt);
+}
+
+static void *sparse_test_chunk(void *ptr, int type, uint blkcnt, uint size)
+{
+	chunk_header_t *chunk = ptr;
+
+	chunk->chunk_type = type;
+	chunk->reserved1 = 0;
+	chunk->chunk_sz = blkcnt;
+	chunk->total_sz = sizeof(*chunk) + size;
+
+	return ptr + sizeof(*chunk);
+}
+
+static void *sparse_test_raw(void *ptr, uint blkcnt, int val)
+{
+	ptr = sparse_test_chunk(ptr, CHUNK_TYPE_RAW, blkcnt,
+				blkcnt * SPARSE_TEST_BLKSZ);
+	memset(ptr, val, blkcnt * SPARSE_TEST_BLKSZ);
+
+	return ptr + blkcnt * SPARSE_TEST_BLKSZ;
+}
+
+static void *sparse_test_fill(void *ptr, uint blkcnt, u32 val)
+{
+	ptr = sparse_test_chunk(ptr, CHUNK_TYPE_FILL, blkcnt, sizeof(val));
+	*(u32 *)ptr = val;
+
+	return ptr + sizeof(val);
+}
+
+static int sparse_test_check_op(struct unit_test_state *uts,
+				struct sparse_test_disk *disk, int seq,
+				bool erase, lbaint_t blk, lbaint_t blkcnt)
+{
+	struct sparse_test_op *op = &disk->ops[seq];
+
+	ut_assert(seq < disk->op_count);
+	ut_asserteq(erase, op->erase);
+	ut_asserteq(blk, op->blk);
+	ut_asserteq(blkcnt, op->blkcnt);
+
+	return 0;
+}
+
+/*
+ * Check that small RAW chunks are written together and that zero-filled
+ * chunks are erased where possible
+ */
+static int lib_test_sparse_write(struct unit_test_state *uts)
+{
+	const uint big = SPARSE_TEST_BUF_BLKS;
+	const uint zero_start = 12, zero_blks = big * 2 + 52;
+	const uint total = zero_start + zero_blks + big;
+	const u32 fill = 0x12345678;
+	struct sparse_test_disk disk;
+	struct sparse_storage info;
+	sparse_header_t *hdr;
+	u8 *image, *ptr, *data;
+	uint head, tail, i;
+
+	image = malloc((big + 16) * SPARSE_TEST_BLKSZ);
+	ut_assertnonnull(image);
+	hdr = (sparse_header_t *)image;
+	hdr->magic = SPARSE_HEADER_MAGIC;
+	hdr->major_version = 1;
+	hdr->minor_version = 0;
+	hdr->file_hdr_sz = sizeof(*hdr);
+	hdr->chunk_hdr_sz = sizeof(chunk_header_t);
+	hdr->blk_sz = SPARSE_TEST_BLKSZ;
+	hdr->total_blks = total;
+	hdr->total_chunks = 6;
+	hdr->image_checksum = 0;
+
+	ptr = image + sizeof(*hdr);
+	ptr = sparse_test_raw(ptr, 2, 'a');
+	ptr = sparse_test_raw(ptr, 3, 'b');
+	ptr = sparse_test_chunk(ptr, CHUNK_TYPE_DONT_CARE, 4, 0);
+	ptr = sparse_test_fill(ptr, 3, fill);
+	ptr = sparse_test_fill(ptr, zero_blks, 0);
+	ptr = sparse_test_raw(ptr, big, 'c');
+
+	data = malloc(total * SPARSE_TEST_BLKSZ);
+	ut_assertnonnull(data);
+	memset(data, 0xff, total * SPARSE_TEST_BLKSZ);
+	memset(&disk, '\0', sizeof(disk));
+	disk.data = data;
+
+	info.blksz = SPARSE_TEST_BLKSZ;
+	info.start = 0;
+	info.size = total;
+	info.priv = &disk;
+	info.write = sparse_test_write;
+	info.reserve = sparse_test_reserve;
+	info.erase = sparse_test_erase;
+	info.erase_grp = SPARSE_TEST_ERASE_GRP;
+	info.mssg = NULL;
+	ut_assertok(write_sparse_image(&info, "test", image, NULL));
+
+	/* The first two RAW chunks are written together */
+	head = SPARSE_TEST_ERASE_GRP - zero_start;
+	tail = zero_blks - head - SPARSE_TEST_ERASE_GRP;
+	ut_asserteq(6, disk.op_count);
+	ut_assertok(sparse_test_check_op(uts, &disk, 0, false, 0, 5));
+	ut_assertok(sparse_test_check_op(uts, &disk, 1, false, 9, 3));
+	ut_assertok(sparse_test_check_op(uts, &disk, 2, false, zero_start,
+					 head));
+	ut_assertok(sparse_test_check_op(uts, &disk, 3, true,
+					 SPARSE_TEST_ERASE_GRP,
+					 SPARSE_TEST_ERASE_GRP));
+	ut_assertok(sparse_test_check_op(uts, &disk, 4, false,
+					 SPARSE_TEST_ERASE_GRP * 2, tail));
+	ut_assertok(sparse_test_check_op(uts, &disk, 5, false,
+					 zero_start + zero_blks, big));
+
+	/* Check what ended up on the disk */
+	for (i = 0; i < total * SPARSE_TEST_BLKSZ; i++) {
+		uint blk = i / SPARSE_TEST_BLKSZ;
+		int expect;
+
+		if (blk < 2)
+			expect = 'a';
+		else if (blk < 5)
+			expect = 'b';
+		else if (blk < 9)
+			expect = 0xff;
+		else if (blk < zero_start)
+			expect = ((u8 *)&fill)[i & 3];
+		else if (blk < zero_start + zero_blks)
+			expect = 0;
+		else
+			expect = 'c';
+		ut_asserteq(expect, data[i]);
+	}
+
+	/* Without erase, the zero-filled chunk is written in pieces */
+	memset(&disk, '\0', sizeof(disk));
+	disk.data = data;
+	info.erase = NULL;
+	info.erase_grp = 0;
+	ut_assertok(write_sparse_image(&info, "test", image, NULL));
+	ut_asserteq(6, disk.op_count);
+	ut_assertok(sparse_test_check_op(uts, &disk, 2, false, zero_start,
+					 big));
+	ut_assertok(sparse_test_check_op(uts, &disk, 4, false,
+					 zero_start + big * 2, 52));
+
+	/* An image which does not fit is rejected */
+	info.size = total - 1;
+	ut_asserteq(-1, write_sparse_image(&info, "test", image, NULL));
+
+	free(data);
+	free(image);
+
+	return 0;
+}
+LIB_TEST(lib_test_sparse_write, 0);
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for running work items with mp_work_run()
+ */
+
+#include <common.h>
+#include <mp_work.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define MP_TEST_ITEMS	50
+
+struct mp_test {
+	int runs[MP_TEST_ITEMS];
+	int fail_index;
+	int bad_cpu;
+};
+
+static int mp_test_item(void *arg, int index, int cpu)
+{
+	struct mp_test *test = arg;
+
+	test->runs[index]++;
+	if (cpu < 0 || cpu >= mp_work_max_cpus())
+		test->bad_cpu = 1;
+	if (index == test->fail_index)
+		return -EIO;
+
+	return 0;
+}
+
+static int lib_test_mp_work(struct unit_test_state *uts)
+{
+	struct mp_test test;
+	int i;
+
+	ut_assert(mp_work_max_cpus() >= 1);
+
+	/* Each item runs once, on a valid CPU */
+	memset(&test, '\0', sizeof(test));
+	test.fail_index = -1;
+	ut_assertok(mp_work_run(mp_test_item, &test, MP_TEST_ITEMS));
+	for (i = 0; i < MP_TEST_ITEMS; i++)
+		ut_asserteq(1, test.runs[i]);
+	ut_assert(!test.bad_cpu);
+
+	/* An error in one item is returned, but the others still run */
+	memset(&test, '\0', sizeof(test));
+	test.fail_index = 10;
+	ut_asserteq(-EIO, mp_work_run(mp_test_item, &test, MP_TEST_ITEMS));
+	for (i = 0; i < MP_TEST_ITEMS; i++)
+		ut_asserteq(1, test.runs[i]);
+
+	/* Nothing to do */
+	ut_assertok(mp_work_run(mp_test_item, &test, 0));
+
+	return 0;
+}
+LIB_TEST(lib_test_mp_work, 0);
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the implementations of the SHA-1 and SHA-256 block functions
+ */
+
+#include <common.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+/* Enough for several blocks, and not a whole number of them */
+#define SHA_TEST_LEN	1000
+
+/* SHA-1 and SHA-256 of "abc" */
+#ifdef CONFIG_SHA1
+static const uint8_t abc_sha1[SHA1_SUM_LEN] = {
+	0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+	0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d,
+};
+#endif
+
+static const uint8_t abc_sha256[SHA256_SUM_LEN] = {
+	0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+	0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+	0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+	0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+};
+
+static void sha_test_fill(uint8_t *buf)
+{
+	int i;
+
+	for (i = 0; i < SHA_TEST_LEN; i++)
+		buf[i] = i * 7 + (i >> 8);
+}
+
+#ifdef CONFIG_SHA1
+/* Each implementation must agree with the C code, whatever the chunking */
+static int lib_test_sha1_backends(struct unit_test_state *uts)
+{
+	uint8_t buf[SHA_TEST_LEN], expect[SHA1_SUM_LEN], out[SHA1_SUM_LEN];
+	const struct sha_backend *backend;
+	sha1_context ctx;
+	int i;
+
+	sha_test_fill(buf);
+	sha1_csum(buf, SHA_TEST_LEN, expect);
+
+	for (i = 0; (backend = sha1_get_backend(i)); i++) {
+		if (backend->probe && !backend->probe())
+			continue;
+
+		sha1_starts_backend(&ctx, backend);
+		sha1_update(&ctx, (uint8_t *)"abc", 3);
+		sha1_finish(&ctx, out);
+		ut_asserteq_mem(abc_sha1, out, SHA1_SUM_LEN);
+
+		sha1_starts_backend(&ctx, backend);
+		sha1_update(&ctx, buf, 10);
+		sha1_update(&ctx, buf + 10, 300);
+		sha1_update(&ctx, buf + 310, SHA_TEST_LEN - 310);
+		sha1_finish(&ctx, out);
+		ut_asserteq_mem(expect, out, SHA1_SUM_LEN);
+	}
+
+	/* the C code comes last */
+	ut_assert(i > 0);
+	ut_asserteq_str("generic", sha1_get_backend(i - 1)->name);
+
+	return 0;
+}
+LIB_TEST(lib_test_sha1_backends, 0);
+#endif
+
+static int lib_test_sha256_backends(struct unit_test_state *uts)
+{
+	uint8_t buf[SHA_TEST_LEN], expect[SHA256_SUM_LEN];
+	uint8_t out[SHA256_SUM_LEN];
+	const struct sha_backend *backend;
+	sha256_context ctx;
+	int i;
+
+	sha_test_fill(buf);
+	sha256_csum_wd(buf, SHA_TEST_LEN, expect, CHUNKSZ_SHA256);
+
+	for (i = 0; (backend = sha256_get_backend(i)); i++) {
+		if (backend->probe && !backend->probe())
+			continue;
+
+		sha256_starts_backend(&ctx, backend);
+		sha256_update(&ctx, (uint8_t *)"abc", 3);
+		sha256_finish(&ctx, out);
+		ut_asserteq_mem(abc_sha256, out, SHA256_SUM_LEN);
+
+		sha256_starts_backend(&ctx, backend);
+		sha256_update(&ctx, buf, 10);
+		sha256_update(&ctx, buf + 10, 300);
+		sha256_update(&ctx, buf + 310, SHA_TEST_LEN - 310);
+		sha256_finish(&ctx, out);
+		ut_asserteq_mem(expect, out, SHA256_SUM_LEN);
+	}
+
+	ut_assert(i > 0);
+	ut_asserteq_str("generic", sha256_get_backend(i - 1)->name);
+
+	return 0;
+}
+LIB_TEST(lib_test_sha256_backends, 0);
@@ -264,6 +264,7 @@ def fs_obj_basic(request, u_boot_config):
 
     small_file = mount_dir + '/' + SMALL_FILE
     big_file = mount_dir + '/' + BIG_FILE
+    frag_file = mount_dir + '/' + FRAG_FILE
 
     try:
 
@@ -292,6 +293,13 @@ def fs_obj_basic(request, u_boot_config):
         check_call('dd if=/dev/urandom of=%s bs=1M count=1'
 	    % small_file, shell=True)
 
+        # Create a file with a hole after each 4KB block, so that on ext4
+        # its extents do not fit in a single leaf block of the extent tree.
+        with open(frag_file, 'wb') as fd:
+            for i in range(1000):
+                fd.seek(i * 3 * 4096)
+                fd.write(os.urandom(4096))
+
         # Delete the small file copies which possibly are written as part of a
         # previous test.
         # check_call('rm -f "%s.w"' % MB1, shell=True)
@@ -334,6 +342,10 @@ def fs_obj_basic(request, u_boot_config):
 	    % big_file, shell=True).decode()
         md5val.append(out.split()[0])
 
+        # The whole fragmented file
+        out = check_output('md5sum %s' % frag_file, shell=True).decode()
+        md5val.append(out.split()[0])
+
         umount_fs(mount_dir)
     except CalledProcessError:
         pytest.skip('Setup failed for filesystem: ' + fs_type)
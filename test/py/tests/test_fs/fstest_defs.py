@@ -12,5 +12,8 @@ MEDIUM_FILE='10MB.file'
 # $BIG_FILE is the name of the 2.5GB file in the file system image
 BIG_FILE='2.5GB.file'
 
+# $FRAG_FILE is the name of a sparse file with one extent per 4KB block
+FRAG_FILE='frag.file'
+
 ADDR=0x01000008
 LENGTH=0x00100000
@@ -290,3 +290,18 @@ class TestFsBasic(object):
                 'setenv filesize'])
             assert(md5val[0] in ''.join(output))
             assert_fs_integrity(fs_type, fs_img)
+
+    def test_fs14(self, u_boot_console, fs_obj_basic):
+        """
+        Test Case 14 - load a file with holes between many extents
+        """
+        fs_type,fs_img,md5val = fs_obj_basic
+        with u_boot_console.log.section('Test Case 14 - load (fragmented)'):
+            # The holes must read as zeroes and the data after each hole,
+            # including in the next extent leaf on ext4, must be intact
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                '%sload host 0:0 %x /%s' % (fs_type, ADDR, FRAG_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[6] in ''.join(output))